@@ -0,0 +1,164 @@
+#include <string.h>
+#include <SDL.h>
+
+#include "asset_prefetch.h"
+#include "util.h"
+#include "logging.h"
+
+enum {
+  kAssetPrefetchEnt_Pending,
+  kAssetPrefetchEnt_Decoding,
+  kAssetPrefetchEnt_Done,
+};
+
+typedef struct AssetPrefetchEnt {
+  uint32 src;
+  uint32 size;
+  uint8 state;
+  uint8 *data;
+} AssetPrefetchEnt;
+
+struct AssetPrefetch {
+  AssetPrefetchDecodeFunc *decode;
+  SDL_Thread *thread;
+  SDL_mutex *mutex;
+  SDL_cond *cond;  // broadcast on new work, a finished decode and quit
+  bool quit;
+  int count;
+  AssetPrefetchEnt ents[kAssetPrefetch_MaxEntries];  // in request order
+  uint8 *buf;  // worker thread only
+};
+
+AssetPrefetch *g_asset_prefetch;
+
+static int FindEnt(AssetPrefetch *ap, uint32 src) {
+  for (int i = 0; i < ap->count; i++)
+    if (ap->ents[i].src == src)
+      return i;
+  return -1;
+}
+
+static int FindState(AssetPrefetch *ap, uint8 state) {
+  for (int i = 0; i < ap->count; i++)
+    if (ap->ents[i].state == state)
+      return i;
+  return -1;
+}
+
+static void RemoveEnt(AssetPrefetch *ap, int i) {
+  ap->count--;
+  memmove(&ap->ents[i], &ap->ents[i + 1], (ap->count - i) * sizeof(AssetPrefetchEnt));
+}
+
+static int SDLCALL AssetPrefetchThread(void *userdata) {
+  AssetPrefetch *ap = (AssetPrefetch *)userdata;
+  SDL_LockMutex(ap->mutex);
+  while (!ap->quit) {
+    int i = FindState(ap, kAssetPrefetchEnt_Pending);
+    if (i < 0) {
+      SDL_CondWait(ap->cond, ap->mutex);
+      continue;
+    }
+    // The entry can move while unlocked but isn't removed, nothing else
+    // touches one that is being decoded
+    uint32 src = ap->ents[i].src;
+    ap->ents[i].state = kAssetPrefetchEnt_Decoding;
+    SDL_UnlockMutex(ap->mutex);
+    uint32 size = ap->decode(src, ap->buf, kAssetPrefetch_BufferSize);
+    uint8 *data = NULL;
+    if (size) {
+      data = (uint8 *)xmalloc(size);
+      memcpy(data, ap->buf, size);
+    }
+    SDL_LockMutex(ap->mutex);
+    i = FindState(ap, kAssetPrefetchEnt_Decoding);
+    if (data) {
+      ap->ents[i].state = kAssetPrefetchEnt_Done;
+      ap->ents[i].size = size;
+      ap->ents[i].data = data;
+    } else {
+      RemoveEnt(ap, i);
+    }
+    SDL_CondBroadcast(ap->cond);
+  }
+  SDL_UnlockMutex(ap->mutex);
+  return 0;
+}
+
+AssetPrefetch *AssetPrefetch_Create(AssetPrefetchDecodeFunc *decode) {
+  AssetPrefetch *ap = (AssetPrefetch *)xmalloc(sizeof(AssetPrefetch));
+  memset(ap, 0, sizeof(AssetPrefetch));
+  ap->decode = decode;
+  ap->buf = (uint8 *)xmalloc(kAssetPrefetch_BufferSize);
+  ap->mutex = SDL_CreateMutex();
+  ap->cond = SDL_CreateCond();
+  if (!ap->mutex || !ap->cond) Die("No mutex");
+  ap->thread = SDL_CreateThread(&AssetPrefetchThread, "asset prefetch", ap);
+  if (!ap->thread) {
+    LogError("Failed to create asset prefetch thread: %s", SDL_GetError());
+    SDL_DestroyMutex(ap->mutex);
+    SDL_DestroyCond(ap->cond);
+    free(ap->buf);
+    free(ap);
+    return NULL;
+  }
+  return ap;
+}
+
+void AssetPrefetch_Request(AssetPrefetch *ap, const uint32 *srcs, int n) {
+  SDL_LockMutex(ap->mutex);
+  for (int i = ap->count - 1; i >= 0; i--) {
+    AssetPrefetchEnt *e = &ap->ents[i];
+    if (e->state == kAssetPrefetchEnt_Decoding)
+      continue;
+    int j = 0;
+    while (j < n && srcs[j] != e->src)
+      j++;
+    if (j == n) {
+      free(e->data);
+      RemoveEnt(ap, i);
+    }
+  }
+  for (int i = 0; i < n && ap->count < kAssetPrefetch_MaxEntries; i++) {
+    if (FindEnt(ap, srcs[i]) < 0) {
+      AssetPrefetchEnt *e = &ap->ents[ap->count++];
+      e->src = srcs[i];
+      e->size = 0;
+      e->state = kAssetPrefetchEnt_Pending;
+      e->data = NULL;
+    }
+  }
+  SDL_CondBroadcast(ap->cond);
+  SDL_UnlockMutex(ap->mutex);
+}
+
+uint8 *AssetPrefetch_Take(AssetPrefetch *ap, uint32 src, uint32 *size) {
+  uint8 *data = NULL;
+  SDL_LockMutex(ap->mutex);
+  int i;
+  while ((i = FindEnt(ap, src)) >= 0 && ap->ents[i].state == kAssetPrefetchEnt_Decoding)
+    SDL_CondWait(ap->cond, ap->mutex);
+  if (i >= 0) {
+    data = ap->ents[i].data;
+    *size = ap->ents[i].size;
+    RemoveEnt(ap, i);
+  }
+  SDL_UnlockMutex(ap->mutex);
+  return data;
+}
+
+void AssetPrefetch_Destroy(AssetPrefetch *ap) {
+  if (ap == NULL)
+    return;
+  SDL_LockMutex(ap->mutex);
+  ap->quit = true;
+  SDL_CondBroadcast(ap->cond);
+  SDL_UnlockMutex(ap->mutex);
+  SDL_WaitThread(ap->thread, NULL);
+  for (int i = 0; i < ap->count; i++)
+    free(ap->ents[i].data);
+  SDL_DestroyMutex(ap->mutex);
+  SDL_DestroyCond(ap->cond);
+  free(ap->buf);
+  free(ap);
+}
@@ -0,0 +1,50 @@
+/**
+ * @file asset_prefetch.h
+ * @brief Decompresses rom assets on a worker thread ahead of their use
+ *
+ * The game lists the compressed streams it is about to load, like the level
+ * data and tileset of the room behind a door, a few frames before the load
+ * runs. A worker thread decodes them into staging buffers in the meantime,
+ * and the load then takes the finished output instead of decoding it. Only
+ * streams whose output depends on nothing but the rom are kept, so taking an
+ * entry gives the same bytes as decoding it on the spot.
+ */
+#ifndef SM_ASSET_PREFETCH_H_
+#define SM_ASSET_PREFETCH_H_
+
+#include "types.h"
+
+enum {
+  kAssetPrefetch_MaxEntries = 40,  // a door asks for up to 2 + 4 per room state
+  kAssetPrefetch_BufferSize = 0x20000,  // power of two
+};
+
+// Decodes the stream at src into dst, returning the size of the output or 0
+// if it can't be prefetched. Called on the worker thread.
+typedef uint32 AssetPrefetchDecodeFunc(uint32 src, uint8 *dst, uint32 dst_size);
+
+typedef struct AssetPrefetch AssetPrefetch;
+
+extern AssetPrefetch *g_asset_prefetch;
+
+/** Start the worker thread. @return NULL on failure */
+AssetPrefetch *AssetPrefetch_Create(AssetPrefetchDecodeFunc *decode);
+
+/**
+ * Queue streams for decoding, in order. Whatever is left over from an
+ * earlier request and isn't listed again is dropped. Only the first
+ * kAssetPrefetch_MaxEntries streams are taken.
+ */
+void AssetPrefetch_Request(AssetPrefetch *ap, const uint32 *srcs, int n);
+
+/**
+ * Take the output for src out of the prefetcher, waiting if the worker is on
+ * it right now. Streams that weren't decoded yet are dropped from the queue.
+ * @return a buffer for the caller to free, or NULL
+ */
+uint8 *AssetPrefetch_Take(AssetPrefetch *ap, uint32 src, uint32 *size);
+
+/** Stop the worker thread and free everything */
+void AssetPrefetch_Destroy(AssetPrefetch *ap);
+
+#endif  // SM_ASSET_PREFETCH_H_
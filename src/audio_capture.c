@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <string.h>
+#include <SDL.h>
+
+#include "audio_capture.h"
+#include "util.h"
+#include "logging.h"
+
+typedef struct AudioCaptureBlock {
+  int frame_counter;
+  int frames;  // -1 ends the writer thread
+  uint32 dropped;  // blocks dropped right before this one
+  int16 samples[kAudioCapture_MaxBlock * 2];
+} AudioCaptureBlock;
+
+struct AudioCapture {
+  FILE *f, *frames_file;
+  bool wav;
+  bool wait_when_full;
+  SDL_Thread *thread;
+  SDL_sem *used_slots, *free_slots;
+  AudioCaptureBlock *queue;
+  uint32 read_pos;  // writer thread only
+  uint32 write_pos, dropped;  // producer only
+  uint64 samples_written;
+};
+
+AudioCapture *g_audio_capture;
+
+static void PutLE16(uint8 *p, uint32 v) {
+  p[0] = v, p[1] = v >> 8;
+}
+
+static void PutLE32(uint8 *p, uint32 v) {
+  p[0] = v, p[1] = v >> 8, p[2] = v >> 16, p[3] = v >> 24;
+}
+
+static void WriteWavHeader(FILE *f, uint32 data_bytes) {
+  uint8 hdr[44];
+  memcpy(hdr, "RIFF", 4);
+  PutLE32(hdr + 4, 36 + data_bytes);
+  memcpy(hdr + 8, "WAVEfmt ", 8);
+  PutLE32(hdr + 16, 16);
+  PutLE16(hdr + 20, 1);  // pcm
+  PutLE16(hdr + 22, 2);
+  PutLE32(hdr + 24, kAudioCapture_Freq);
+  PutLE32(hdr + 28, kAudioCapture_Freq * 4);
+  PutLE16(hdr + 32, 4);
+  PutLE16(hdr + 34, 16);
+  memcpy(hdr + 36, "data", 4);
+  PutLE32(hdr + 40, data_bytes);
+  fwrite(hdr, 1, sizeof(hdr), f);
+}
+
+static int SDLCALL AudioCaptureThread(void *userdata) {
+  AudioCapture *ac = (AudioCapture *)userdata;
+  for (;;) {
+    SDL_SemWait(ac->used_slots);
+    AudioCaptureBlock *b = &ac->queue[ac->read_pos++ % kAudioCapture_QueueBlocks];
+    if (b->frames < 0)
+      break;
+    if (b->dropped)
+      fprintf(ac->frames_file, "# dropped %u blocks\n", b->dropped);
+    fprintf(ac->frames_file, "%d %llu\n", b->frame_counter, (unsigned long long)ac->samples_written);
+    fwrite(b->samples, 4, b->frames, ac->f);
+    ac->samples_written += b->frames;
+    SDL_SemPost(ac->free_slots);
+  }
+  return 0;
+}
+
+AudioCapture *AudioCapture_Open(const char *filename, bool wait_when_full) {
+  size_t len = strlen(filename);
+  char *frames_name = (char *)xmalloc(len + 8);
+  memcpy(frames_name, filename, len);
+  memcpy(frames_name + len, ".frames", 8);
+
+  AudioCapture *ac = (AudioCapture *)xmalloc(sizeof(AudioCapture));
+  memset(ac, 0, sizeof(AudioCapture));
+  ac->wav = len >= 4 && SDL_strcasecmp(filename + len - 4, ".wav") == 0;
+  ac->wait_when_full = wait_when_full;
+  ac->f = fopen(filename, "wb");
+  ac->frames_file = fopen(frames_name, "w");
+  free(frames_name);
+  if (ac->f == NULL || ac->frames_file == NULL) {
+    LogError("Unable to open audio capture file: %s", filename);
+    goto fail;
+  }
+  if (ac->wav)
+    WriteWavHeader(ac->f, 0);
+  fprintf(ac->frames_file, "# snes_frame_counter first_sample (%d Hz stereo)\n", kAudioCapture_Freq);
+
+  ac->queue = (AudioCaptureBlock *)xmalloc(sizeof(AudioCaptureBlock) * kAudioCapture_QueueBlocks);
+  ac->used_slots = SDL_CreateSemaphore(0);
+  ac->free_slots = SDL_CreateSemaphore(kAudioCapture_QueueBlocks);
+  if (!ac->used_slots || !ac->free_slots) Die("No semaphore");
+  ac->thread = SDL_CreateThread(&AudioCaptureThread, "audio capture", ac);
+  if (!ac->thread) {
+    LogError("Failed to create audio capture thread: %s", SDL_GetError());
+    SDL_DestroySemaphore(ac->used_slots);
+    SDL_DestroySemaphore(ac->free_slots);
+    free(ac->queue);
+    goto fail;
+  }
+  return ac;
+fail:
+  if (ac->f) fclose(ac->f);
+  if (ac->frames_file) fclose(ac->frames_file);
+  free(ac);
+  return NULL;
+}
+
+void AudioCapture_Write(AudioCapture *ac, const int16 *samples, int frames, int frame_counter) {
+  if ((ac->wait_when_full ? SDL_SemWait(ac->free_slots) : SDL_SemTryWait(ac->free_slots)) != 0) {
+    ac->dropped++;
+    return;
+  }
+  AudioCaptureBlock *b = &ac->queue[ac->write_pos++ % kAudioCapture_QueueBlocks];
+  b->frame_counter = frame_counter;
+  b->frames = IntMin(frames, kAudioCapture_MaxBlock);
+  b->dropped = ac->dropped;
+  ac->dropped = 0;
+  memcpy(b->samples, samples, b->frames * 4);
+  SDL_SemPost(ac->used_slots);
+}
+
+void AudioCapture_Close(AudioCapture *ac) {
+  if (ac == NULL)
+    return;
+  // The end marker goes through the queue after everything still pending
+  SDL_SemWait(ac->free_slots);
+  ac->queue[ac->write_pos++ % kAudioCapture_QueueBlocks].frames = -1;
+  SDL_SemPost(ac->used_slots);
+  SDL_WaitThread(ac->thread, NULL);
+  if (ac->dropped)
+    fprintf(ac->frames_file, "# dropped %u blocks\n", ac->dropped);
+  if (ac->wav) {
+    uint64 bytes = ac->samples_written * 4;
+    fseek(ac->f, 0, SEEK_SET);
+    WriteWavHeader(ac->f, bytes > 0xffffffd0 ? 0xffffffd0 : (uint32)bytes);
+  }
+  fclose(ac->f);
+  fclose(ac->frames_file);
+  SDL_DestroySemaphore(ac->used_slots);
+  SDL_DestroySemaphore(ac->free_slots);
+  free(ac->queue);
+  free(ac);
+}
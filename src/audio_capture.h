@@ -0,0 +1,44 @@
+/**
+ * @file audio_capture.h
+ * @brief Streams the 32 kHz DSP output to a WAV or raw PCM file
+ *
+ * Blocks are handed over to a writer thread through a bounded queue, so the
+ * thread producing audio never waits on the disk. Next to the audio a
+ * <file>.frames text file lists, for every block, the snes_frame_counter at
+ * the time and the index of its first sample, so captures from two builds
+ * can be lined up and diffed.
+ */
+#ifndef SM_AUDIO_CAPTURE_H_
+#define SM_AUDIO_CAPTURE_H_
+
+#include "types.h"
+
+enum {
+  kAudioCapture_Freq = 32000,
+  kAudioCapture_MaxBlock = 534,  // stereo frames
+  kAudioCapture_QueueBlocks = 64,
+};
+
+typedef struct AudioCapture AudioCapture;
+
+extern AudioCapture *g_audio_capture;
+
+/**
+ * Start a capture. Files ending in .wav get a WAV header, anything else is
+ * written as raw 16-bit little endian stereo.
+ * @param wait_when_full Block the producer instead of dropping audio when the
+ *        queue is full, for headless runs where nothing is real time
+ * @return NULL on failure
+ */
+AudioCapture *AudioCapture_Open(const char *filename, bool wait_when_full);
+
+/**
+ * Queue one block of interleaved stereo samples. Never touches the disk.
+ * Dropped blocks are recorded in the .frames file.
+ */
+void AudioCapture_Write(AudioCapture *ac, const int16 *samples, int frames, int frame_counter);
+
+/** Flush the queue, finish the WAV header and close the files */
+void AudioCapture_Close(AudioCapture *ac);
+
+#endif  // SM_AUDIO_CAPTURE_H_
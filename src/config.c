@@ -15,6 +15,7 @@ enum {
   kKeymapGrowSize = 256,
   kMaxJoypadMapSize = 1000,
   kJoypadMapGrowSize = 64,
+  kMaxDecompressCacheKB = 1024 * 1024,  // keeps the size in bytes within uint32
 };
 
 Config g_config;
@@ -376,6 +377,9 @@ static bool HandleIniConfig(int section, const char *key, char *value) {
       return ParseBool(value, &g_config.linear_filtering);
     } else if (StringEqualsNoCase(key, "NoSpriteLimits")) {
       return ParseBool(value, &g_config.no_sprite_limits);
+    } else if (StringEqualsNoCase(key, "RenderThreads")) {
+      g_config.render_threads = (uint8)strtol(value, (char**)NULL, 10);
+      return true;
     } else if (StringEqualsNoCase(key, "LinkGraphics")) {
       g_config.link_graphics = value;
       return true;
@@ -448,6 +452,11 @@ static bool HandleIniConfig(int section, const char *key, char *value) {
     } else if (StringEqualsNoCase(key, "AudioSamples")) {
       g_config.audio_samples = (uint16)strtol(value, (char**)NULL, 10);
       return true;
+    } else if (StringEqualsNoCase(key, "LinearResampling")) {
+      return ParseBool(value, &g_config.linear_resampling);
+    } else if (StringEqualsNoCase(key, "AudioLookahead")) {
+      g_config.audio_lookahead = (uint16)strtol(value, (char**)NULL, 10);
+      return true;
     } else if (StringEqualsNoCase(key, "EnableMSU")) {
         if (StringEqualsNoCase(value, "opuz"))
         g_config.enable_msu = kMsuEnabled_Opuz;
@@ -477,6 +486,29 @@ static bool HandleIniConfig(int section, const char *key, char *value) {
       return ParseBool(value, &g_config.debug_display);
     } else if (StringEqualsNoCase(key, "DisableFrameDelay")) {
       return ParseBool(value, &g_config.disable_frame_delay);
+    } else if (StringEqualsNoCase(key, "DecompressCacheKB")) {
+      long kb = strtol(value, (char**)NULL, 10);
+      if (kb < 0 || kb > kMaxDecompressCacheKB) {
+        kb = kb < 0 ? 0 : kMaxDecompressCacheKB;
+        fprintf(stderr, "Warning: DecompressCacheKB must be 0 to %d, using %ld\n",
+                kMaxDecompressCacheKB, kb);
+      }
+      g_config.decompress_cache_kb = (uint32)kb;
+      return true;
+    } else if (StringEqualsNoCase(key, "PrefetchRoomAssets")) {
+      return ParseBool(value, &g_config.prefetch_room_assets);
+    } else if (StringEqualsNoCase(key, "VerifyFrames")) {
+      // Comma-separated frame interval and/or "transitions" (e.g., "60, transitions")
+      char *s;
+      g_config.verify_interval = 0;
+      g_config.verify_transitions = false;
+      while ((s = NextDelim(&value, ',')) != NULL) {
+        if (StringEqualsNoCase(s, "transitions"))
+          g_config.verify_transitions = true;
+        else if (*s != 0)
+          g_config.verify_interval = (uint16)strtol(s, (char**)NULL, 10);
+      }
+      return true;
     }
   } else if (section == 4) {
   }
@@ -525,6 +557,9 @@ static bool ParseOneConfigFile(const char *filename, int depth) {
 
 void ParseConfigFile(const char *filename) {
   g_config.msuvolume = 100;  // default msu volume, 100%
+  g_config.verify_interval = 1;  // verify every frame
+  g_config.decompress_cache_kb = 4096;
+  g_config.prefetch_room_assets = true;
 
   if (filename != NULL || !ParseOneConfigFile("sm.user.ini", 0)) {
     if (filename == NULL)
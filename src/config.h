@@ -56,15 +56,22 @@ typedef struct Config {
   uint16 audio_freq;
   uint8 audio_channels;
   uint16 audio_samples;
+  bool linear_resampling;
+  uint16 audio_lookahead;
   bool autosave;
   uint8 extended_aspect_ratio;
   bool extend_y;
   bool no_sprite_limits;
+  uint8 render_threads;
   bool display_perf_title;
   bool debug_display;
   uint8 enable_msu;
   bool resume_msu;
   bool disable_frame_delay;
+  bool verify_transitions;
+  uint16 verify_interval;
+  uint32 decompress_cache_kb;
+  bool prefetch_room_assets;
   uint8 msuvolume;
   uint32 features0;
 
@@ -41,6 +41,7 @@ void ConfigureMode7RotationMatrix(void);
 void CopySuperMetroidString(void);
 void DebugScrollPosSaveLoad(void);
 void DecompressToMem(uint32 src, uint8 *decompress_dst);
+uint32 DecompressToBuffer(uint32 src, uint8 *dst, uint32 dst_size);
 void DecompressToVRAM(uint32 src, uint16 dst_addr);
 void DisableIrqInterrupts(void);
 void DisableNMI(void);
@@ -1006,6 +1007,7 @@ uint16 RoomDefStateSelect_MorphBallMissiles(uint16 k);
 uint16 RoomDefStateSelect_PowerBombs(uint16 k);
 uint16 RoomDefStateSelect_TourianBoss01(uint16 k);
 void HandleRoomDefStateSelect(uint16 k);
+int GetRoomDefStates(uint16 k, uint16 *states, int max_states);
 void PauseHook_DraygonRoom(void);
 void RunDoorSetupCode(void);
 void RunRoomMainCode(void);
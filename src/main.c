@@ -23,6 +23,9 @@
 #include "util.h"
 #include "spc_player.h"
 #include "logging.h"
+#include "audio_capture.h"
+#include "asset_prefetch.h"
+#include "funcs.h"
 
 #ifdef __SWITCH__
 #include "switch_impl.h"
@@ -54,6 +57,7 @@ enum {
   kDefaultFreq = 44100,
   kDefaultChannels = 2,
   kDefaultSamples = 2048,
+  kMaxAudioLookahead = 500,
   // Frame timing for 60 FPS (17ms, 17ms, 16ms pattern averages to 16.67ms)
   kFrameDelayMs_60fps_0 = 17,
   kFrameDelayMs_60fps_1 = 17,
@@ -169,21 +173,209 @@ static SDL_HitTestResult HitTestCallback(SDL_Window *win, const SDL_Point *pt, v
   return SDL_HITTEST_NORMAL;
 }
 
+static Ppu *GetDisplayedPpu(void) {
+  return g_game_ctx.other_image ? g_game_ctx.snes->my_ppu : g_game_ctx.snes->snes_ppu;
+}
+
+static uint8 *GetPpuPixels(void) {
+  return g_game_ctx.other_image ? g_render_ctx.my_pixels : g_render_ctx.pixels;
+}
+
+enum {
+  kMaxRenderThreads = 8,
+};
+
+// Threads that draw the lines captured by the ppus during the last frame.
+// Thread i draws lines i + 1, i + 1 + num_threads, ... with its own Ppu.
+typedef struct RenderPool {
+  int num_threads;
+  SDL_Thread *threads[kMaxRenderThreads];
+  Ppu *ppus[kMaxRenderThreads];
+  PpuCapturedFrame *frames[2];
+  int num_frames;
+  SDL_mutex *mutex;
+  SDL_cond *start_cond, *done_cond;
+  uint32 generation;
+  int busy;
+  bool quit;
+  // A submitted frame that hasn't been presented yet, and its render scale
+  bool pending;
+  int pending_scale;
+} RenderPool;
+
+static RenderPool g_render_pool;
+
+static int SDLCALL RenderPoolThread(void *userdata) {
+  RenderPool *pool = &g_render_pool;
+  int index = (int)(intptr_t)userdata;
+  uint32 generation = 0;
+  SDL_LockMutex(pool->mutex);
+  for (;;) {
+    while (!pool->quit && pool->generation == generation)
+      SDL_CondWait(pool->start_cond, pool->mutex);
+    if (pool->quit)
+      break;
+    generation = pool->generation;
+    SDL_UnlockMutex(pool->mutex);
+    for (int i = 0; i < pool->num_frames; i++)
+      PpuDrawCapturedLines(pool->ppus[index], pool->frames[i], index + 1, pool->num_threads);
+    SDL_LockMutex(pool->mutex);
+    if (--pool->busy == 0)
+      SDL_CondSignal(pool->done_cond);
+  }
+  SDL_UnlockMutex(pool->mutex);
+  return 0;
+}
+
+static void RenderPoolWait(void) {
+  RenderPool *pool = &g_render_pool;
+  if (pool->num_threads == 0)
+    return;
+  SDL_LockMutex(pool->mutex);
+  while (pool->busy)
+    SDL_CondWait(pool->done_cond, pool->mutex);
+  SDL_UnlockMutex(pool->mutex);
+}
+
+// Hand the lines captured during the last frame to the render threads.
+// The game can run the next frame while they draw, RenderPoolWait must be
+// called before the pixels are used.
+static void RenderPoolSubmit(void) {
+  RenderPool *pool = &g_render_pool;
+  if (pool->num_threads == 0)
+    return;
+  RenderPoolWait();
+  Ppu *ppus[2] = { g_game_ctx.snes->snes_ppu, g_game_ctx.snes->my_ppu };
+  int n = 0;
+  for (int i = 0; i < 2; i++)
+    n += PpuFinishLineCapture(ppus[i], pool->frames[n]);
+  if (n == 0)
+    return;
+  pool->pending = true;
+  pool->pending_scale = PpuGetCurrentRenderScale(GetDisplayedPpu(), g_render_ctx.ppu_render_flags);
+  SDL_LockMutex(pool->mutex);
+  pool->num_frames = n;
+  pool->busy = pool->num_threads;
+  pool->generation++;
+  SDL_CondBroadcast(pool->start_cond);
+  SDL_UnlockMutex(pool->mutex);
+}
+
+static void SetupRenderPool(int num_threads) {
+  RenderPool *pool = &g_render_pool;
+  num_threads = IntMin(num_threads, kMaxRenderThreads);
+  if (num_threads <= 0)
+    return;
+  pool->mutex = SDL_CreateMutex();
+  pool->start_cond = SDL_CreateCond();
+  pool->done_cond = SDL_CreateCond();
+  if (!pool->mutex || !pool->start_cond || !pool->done_cond) Die("No mutex");
+  for (int i = 0; i < 2; i++)
+    pool->frames[i] = (PpuCapturedFrame *)xmalloc(sizeof(PpuCapturedFrame));
+  for (int i = 0; i < num_threads; i++) {
+    pool->ppus[i] = ppu_init(g_game_ctx.snes);
+    ppu_reset(pool->ppus[i]);
+    pool->threads[i] = SDL_CreateThread(&RenderPoolThread, "render", (void *)(intptr_t)i);
+    if (!pool->threads[i]) {
+      LogError("Failed to create render thread: %s", SDL_GetError());
+      ppu_free(pool->ppus[i]);
+      break;
+    }
+    pool->num_threads++;
+  }
+  if (pool->num_threads == 0)
+    return;
+  PpuSetLineCapture(g_game_ctx.snes->snes_ppu, true);
+  PpuSetLineCapture(g_game_ctx.snes->my_ppu, true);
+}
+
+static void DestroyRenderPool(void) {
+  RenderPool *pool = &g_render_pool;
+  if (pool->num_threads == 0)
+    return;
+  RenderPoolWait();
+  PpuSetLineCapture(g_game_ctx.snes->snes_ppu, false);
+  PpuSetLineCapture(g_game_ctx.snes->my_ppu, false);
+  SDL_LockMutex(pool->mutex);
+  pool->quit = true;
+  SDL_CondBroadcast(pool->start_cond);
+  SDL_UnlockMutex(pool->mutex);
+  for (int i = 0; i < pool->num_threads; i++) {
+    SDL_WaitThread(pool->threads[i], NULL);
+    ppu_free(pool->ppus[i]);
+  }
+  pool->num_threads = 0;
+}
+
+// Set while the displayed ppu draws straight into the renderer's buffer
+static Ppu *g_in_place_ppu;
+static uint8 *g_in_place_pixels;
+static int g_in_place_pitch;
+
+// Lock the renderer's buffer before running the frame so the displayed ppu
+// can draw into it directly, without a copy in RtlDrawPpuFrame. Upscaled
+// mode 7 decides the frame size mid frame, and the old renderer doesn't
+// draw the side margins, so those still go through the ppu's own buffer.
+static void BeginDrawInPlace(void) {
+  if (!g_new_ppu || (g_render_ctx.ppu_render_flags & kPpuRenderFlags_4x4Mode7))
+    return;
+  // The render threads draw a frame while the next one runs, so the
+  // renderer's buffer can't stay locked for them.
+  if (g_render_pool.num_threads != 0)
+    return;
+  uint8 *pixels = NULL;
+  int pitch = 0;
+  g_renderer_funcs.BeginDraw(g_render_ctx.snes_width, g_render_ctx.snes_height, &pixels, &pitch);
+  if (pixels == NULL)
+    return;
+  // The ppu only reaches the bottom lines on overscan frames
+  for (int y = 224; y < g_render_ctx.snes_height; y++)
+    memset(pixels + y * pitch, 0, g_render_ctx.snes_width * 4);
+  g_in_place_ppu = GetDisplayedPpu();
+  g_in_place_pixels = pixels;
+  g_in_place_pitch = pitch;
+  PpuBeginDrawing(g_in_place_ppu, pixels, pitch, g_render_ctx.ppu_render_flags);
+}
+
+// The scale of the frame about to be presented. With the render pool that is
+// the previous frame, the displayed ppu has already moved on to the next one.
+static int GetPresentedRenderScale(void) {
+  if (g_render_pool.num_threads != 0)
+    return g_render_pool.pending_scale;
+  return PpuGetCurrentRenderScale(GetDisplayedPpu(), g_render_ctx.ppu_render_flags);
+}
+
+static void EndDrawInPlace(void) {
+  if (g_in_place_ppu == NULL)
+    return;
+  uint8 *pixels = (g_in_place_ppu == g_game_ctx.snes->my_ppu) ? g_render_ctx.my_pixels : g_render_ctx.pixels;
+  PpuBeginDrawing(g_in_place_ppu, pixels, g_render_ctx.snes_width * 4, g_render_ctx.ppu_render_flags);
+  g_in_place_ppu = NULL;
+  g_in_place_pixels = NULL;
+}
+
 void RtlDrawPpuFrame(uint8 *pixel_buffer, size_t pitch, uint32 render_flags) {
-  uint8 *ppu_pixels = g_game_ctx.other_image ? g_render_ctx.my_pixels : g_render_ctx.pixels;
-  size_t row_bytes = g_render_ctx.snes_width * 4;
-  for (size_t y = 0; y < g_render_ctx.snes_height; y++)
+  RenderPoolWait();
+  g_render_pool.pending = false;
+  if (pixel_buffer == g_in_place_pixels)
+    return;  // already drawn in place
+  uint8 *ppu_pixels = GetPpuPixels();
+  size_t render_scale = GetPresentedRenderScale();
+  size_t row_bytes = g_render_ctx.snes_width * 4 * render_scale;
+  for (size_t y = 0; y < g_render_ctx.snes_height * render_scale; y++)
     memcpy((uint8_t *)pixel_buffer + y * pitch, ppu_pixels + y * row_bytes, row_bytes);
 }
 
 static void DrawPpuFrameWithPerf(void) {
-  int render_scale = PpuGetCurrentRenderScale(g_game_ctx.snes->ppu, g_render_ctx.ppu_render_flags);
-  uint8 *pixel_buffer = 0;
-  int pitch = 0;
-
-  g_renderer_funcs.BeginDraw(g_render_ctx.snes_width * render_scale,
-                             g_render_ctx.snes_height * render_scale,
-                             &pixel_buffer, &pitch);
+  int render_scale = GetPresentedRenderScale();
+  uint8 *pixel_buffer = g_in_place_pixels;
+  int pitch = g_in_place_pitch;
+
+  if (pixel_buffer == NULL) {
+    g_renderer_funcs.BeginDraw(g_render_ctx.snes_width * render_scale,
+                               g_render_ctx.snes_height * render_scale,
+                               &pixel_buffer, &pitch);
+  }
   if (g_render_ctx.display_perf || g_config.display_perf_title) {
     static float history[64], average;
     static int history_pos;
@@ -205,6 +397,7 @@ static void DrawPpuFrameWithPerf(void) {
     RenderNumber(pixel_buffer + pitch * render_scale, pitch, g_game_ctx.got_mismatch_count, render_scale == 4);
 
   g_renderer_funcs.EndDraw();
+  EndDrawInPlace();
 }
 
 // Audio globals migrated to g_audio_ctx
@@ -217,7 +410,128 @@ void RtlApuUnlock(void) {
   SDL_UnlockMutex(g_audio_ctx.mutex);
 }
 
+uint64 RtlGetPerfCounter(void) {
+  return SDL_GetPerformanceCounter();
+}
+
+// With AudioLookahead set, samples are synthesised ahead on a separate thread
+// into a ring buffer that the audio callback only copies out of. The thread
+// makes one block per game frame. The size of the block is adjusted by up to
+// 0.5% to keep the ring at the lookahead when the video and audio clocks drift.
+typedef struct AudioSynth {
+  SDL_Thread *thread;
+  SDL_sem *frame_sem;
+  int16 *ring;
+  uint32 ring_mask;
+  SDL_atomic_t read_pos, write_pos;  // in stereo frames
+  uint32 target, low_water;
+  double fill, frac;
+  SDL_atomic_t quit;
+} AudioSynth;
+
+static AudioSynth g_audio_synth;
+
+static void AudioSynthRenderBlock(AudioSynth *as, uint32 fill) {
+  // Make smaller blocks when the ring fills up, larger when it drains
+  as->fill += (fill - as->fill) * (1.0 / 16);
+  double error = (as->fill - as->target) / as->target;
+  error = error < -1.0 ? -1.0 : error > 1.0 ? 1.0 : error;
+  double frames = g_audio_ctx.frames_per_block * (1.0 - 0.005 * error) + as->frac;
+  int n = (int)frames;
+  as->frac = frames - n;
+
+  int16 *buf = (int16 *)g_audio_ctx.buffer;
+  RtlRenderAudio(buf, n, 2);
+  uint32 pos = SDL_AtomicGet(&as->write_pos);
+  for (int i = 0; i < n; i++, pos++) {
+    as->ring[(pos & as->ring_mask) * 2 + 0] = buf[i * 2 + 0];
+    as->ring[(pos & as->ring_mask) * 2 + 1] = buf[i * 2 + 1];
+  }
+  SDL_AtomicSet(&as->write_pos, pos);
+}
+
+static int SDLCALL AudioSynthThread(void *userdata) {
+  AudioSynth *as = &g_audio_synth;
+  // Wake up at least twice per block to catch up if the game stalls
+  uint32 timeout = IntMax(500 * g_audio_ctx.frames_per_block / g_config.audio_freq, 1);
+  while (!SDL_AtomicGet(&as->quit)) {
+    bool frame = SDL_SemWaitTimeout(as->frame_sem, timeout) == 0;
+    uint32 fill = (uint32)SDL_AtomicGet(&as->write_pos) - (uint32)SDL_AtomicGet(&as->read_pos);
+    // Drop the block when far behind, e.g. without frame delay on a fast display.
+    // Always make one when close to running dry.
+    if ((frame && fill < as->target * 2) || fill < as->low_water)
+      AudioSynthRenderBlock(as, fill);
+  }
+  return 0;
+}
+
+static void SetupAudioSynth(int device_samples) {
+  AudioSynth *as = &g_audio_synth;
+  if (g_config.audio_lookahead == 0)
+    return;
+  as->target = IntMax(g_config.audio_lookahead * g_config.audio_freq / 1000, device_samples);
+  as->low_water = device_samples;
+  as->fill = as->target;
+  uint32 size = 1;
+  while (size < as->target * 2 + g_audio_ctx.frames_per_block * 2)
+    size <<= 1;
+  as->ring = (int16 *)xmalloc(size * 2 * sizeof(int16));
+  as->ring_mask = size - 1;
+  as->frame_sem = SDL_CreateSemaphore(0);
+  if (!as->frame_sem) Die("No semaphore");
+  as->thread = SDL_CreateThread(&AudioSynthThread, "audio", NULL);
+  if (!as->thread) {
+    LogError("Failed to create audio thread: %s", SDL_GetError());
+    free(as->ring);
+    as->ring = NULL;
+  }
+}
+
+static void DestroyAudioSynth(void) {
+  AudioSynth *as = &g_audio_synth;
+  if (as->thread == NULL)
+    return;
+  SDL_AtomicSet(&as->quit, 1);
+  SDL_SemPost(as->frame_sem);
+  SDL_WaitThread(as->thread, NULL);
+  SDL_DestroySemaphore(as->frame_sem);
+  free(as->ring);
+  as->thread = NULL;
+}
+
+static void AudioSynthFrame(void) {
+  if (g_audio_synth.thread)
+    SDL_SemPost(g_audio_synth.frame_sem);
+}
+
+static void AudioOutput(Uint8 *stream, const void *src, int n) {
+  if (g_audio_ctx.mixer_volume == SDL_MIX_MAXVOLUME) {
+    memcpy(stream, src, n);
+  } else {
+    SDL_memset(stream, 0, n);
+    SDL_MixAudioFormat(stream, src, AUDIO_S16, n, g_audio_ctx.mixer_volume);
+  }
+}
+
+static void AudioSynthCallback(Uint8 *stream, int len) {
+  AudioSynth *as = &g_audio_synth;
+  uint32 pos = SDL_AtomicGet(&as->read_pos);
+  uint32 frames = UintMin(len / 4, (uint32)SDL_AtomicGet(&as->write_pos) - pos);
+  while (frames != 0) {
+    uint32 n = UintMin(frames, as->ring_mask + 1 - (pos & as->ring_mask));
+    AudioOutput(stream, &as->ring[(pos & as->ring_mask) * 2], n * 4);
+    stream += n * 4, len -= n * 4, pos += n, frames -= n;
+  }
+  SDL_AtomicSet(&as->read_pos, pos);
+  // Underrun
+  SDL_memset(stream, 0, len);
+}
+
 static void SDLCALL AudioCallback(void *userdata, Uint8 *stream, int len) {
+  if (g_audio_synth.thread) {
+    AudioSynthCallback(stream, len);
+    return;
+  }
   if (SDL_LockMutex(g_audio_ctx.mutex)) Die("Mutex lock failed!");
   while (len != 0) {
     if (g_audio_ctx.buffer_end - g_audio_ctx.buffer_cur == 0) {
@@ -227,12 +541,7 @@ static void SDLCALL AudioCallback(void *userdata, Uint8 *stream, int len) {
       g_audio_ctx.buffer_end = g_audio_ctx.buffer + g_audio_ctx.frames_per_block * g_audio_ctx.channels * sizeof(int16);
     }
     int n = IntMin(len, g_audio_ctx.buffer_end - g_audio_ctx.buffer_cur);
-    if (g_audio_ctx.mixer_volume == SDL_MIX_MAXVOLUME) {
-      memcpy(stream, g_audio_ctx.buffer_cur, n);
-    } else {
-      SDL_memset(stream, 0, n);
-      SDL_MixAudioFormat(stream, g_audio_ctx.buffer_cur, AUDIO_S16, n, g_audio_ctx.mixer_volume);
-    }
+    AudioOutput(stream, g_audio_ctx.buffer_cur, n);
     g_audio_ctx.buffer_cur += n;
     stream += n;
     len -= n;
@@ -316,9 +625,14 @@ static void Cleanup(void) {
   if (g_config.autosave)
     HandleCommand(kKeys_Save + 0, true);
 
+  DestroyRenderPool();
+
   // clean sdl
   SDL_PauseAudioDevice(g_audio_ctx.device, 1);
+  DestroyAudioSynth();
   SDL_CloseAudioDevice(g_audio_ctx.device);
+  AudioCapture_Close(g_audio_capture);
+  AssetPrefetch_Destroy(g_asset_prefetch);
   SDL_DestroyMutex(g_audio_ctx.mutex);
   free(g_audio_ctx.buffer);
 
@@ -406,12 +720,26 @@ static void RunGameLoop(void) {
       g_gamepad_buttons = 0;
     inputs |= g_gamepad_buttons;
 
+    // Present the frames that get drawn, disableRender applies to the frame about to run
+    bool draw_frame = !g_game_ctx.snes->disableRender;
+    if (draw_frame)
+      BeginDrawInPlace();
+
     uint8 is_replay = RtlRunFrame(inputs);
+    if (g_render_pool.num_threads != 0) {
+      // Present the frame the render threads drew while this one ran, then
+      // hand this one to them so they draw it during the next RtlRunFrame.
+      draw_frame = g_render_pool.pending;
+      if (draw_frame)
+        DrawPpuFrameWithPerf();
+      RenderPoolSubmit();
+    }
+    AudioSynthFrame();
 
     frameCtr++;
     g_game_ctx.snes->disableRender = (g_turbo ^ (is_replay & g_replay_turbo)) && (frameCtr & (g_turbo ? 0xf : 0x7f)) != 0;
 
-    if (!g_game_ctx.snes->disableRender)
+    if (draw_frame && g_render_pool.num_threads == 0)
       DrawPpuFrameWithPerf();
 
     bool want_bug_in_title = (g_game_ctx.got_mismatch_count != 0);
@@ -429,7 +757,7 @@ static void RunGameLoop(void) {
     // if vsync isn't working, delay manually
     curTick = SDL_GetTicks();
 
-    if (!g_game_ctx.snes->disableRender && !g_config.disable_frame_delay) {
+    if (draw_frame && !g_config.disable_frame_delay) {
       static const uint8 delays[3] = { kFrameDelayMs_60fps_0, kFrameDelayMs_60fps_1, kFrameDelayMs_60fps_2 };
       lastTick += delays[frameCtr % 3];
 
@@ -448,23 +776,29 @@ static void RunGameLoop(void) {
   }
 }
 
-// Setup audio system (mutex, SPC player, audio device)
-static bool SetupAudio(void) {
-  // Initialize audio context
+// Setup the audio mutex, SPC player and dsp options, shared by the windowed and headless modes
+static void SetupSpcPlayer(void) {
   g_audio_ctx.mutex = SDL_CreateMutex();
   if (!g_audio_ctx.mutex) Die("No mutex");
   g_audio_ctx.mixer_volume = SDL_MIX_MAXVOLUME;
 
   g_spc_player = SpcPlayer_Create();
   SpcPlayer_Initialize(g_spc_player);
+  dsp_setLinearResampling(g_game_ctx.snes->apu->dsp, g_config.linear_resampling);
+  dsp_setLinearResampling(g_spc_player->dsp, g_config.linear_resampling);
+}
+
+// Setup audio system (mutex, SPC player, audio device)
+static bool SetupAudio(void) {
+  SetupSpcPlayer();
 
   bool enable_audio = true;
   if (enable_audio) {
     SDL_AudioSpec want = { 0 }, have;
-    want.freq = 44100;
+    want.freq = g_config.audio_freq;
     want.format = AUDIO_S16;
     want.channels = 2;
-    want.samples = 2048;
+    want.samples = g_config.audio_samples;
     want.callback = &AudioCallback;
     g_audio_ctx.device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
     if (g_audio_ctx.device == 0) {
@@ -473,34 +807,18 @@ static bool SetupAudio(void) {
     }
     g_audio_ctx.channels = 2;
     g_audio_ctx.frames_per_block = (534 * have.freq) / 32000;
-    g_audio_ctx.buffer = (uint8 *)xmalloc(g_audio_ctx.frames_per_block * have.channels * sizeof(int16));
+    // Room for blocks made larger by the rate control of the synth thread
+    g_audio_ctx.buffer = (uint8 *)xmalloc((g_audio_ctx.frames_per_block + g_audio_ctx.frames_per_block / 64 + 2) * have.channels * sizeof(int16));
     g_audio_ctx.buffer_cur = g_audio_ctx.buffer;
     g_audio_ctx.buffer_end = g_audio_ctx.buffer;
+    SetupAudioSynth(have.samples);
   }
 
   return true;
 }
 
-// Setup SDL, window, renderer, and load ROM
-static bool SetupWindowAndRenderer(const char *rom_filename) {
-  // set up SDL
-  if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER) != 0) {
-    LogError("Failed to init SDL: %s", SDL_GetError());
-    return false;
-  }
-
-  bool custom_size = g_config.window_width != 0 && g_config.window_height != 0;
-  int window_width = custom_size ? g_config.window_width : g_render_ctx.current_window_scale * g_render_ctx.snes_width;
-  int window_height = custom_size ? g_config.window_height : g_render_ctx.current_window_scale * g_render_ctx.snes_height;
-
-  if (g_config.output_method == kOutputMethod_OpenGL) {
-    g_render_ctx.win_flags |= SDL_WINDOW_OPENGL;
-    OpenGLRenderer_Create(&g_renderer_funcs);
-  } else {
-    g_renderer_funcs = kSdlRendererFuncs;
-  }
-
-  // init snes, load rom
+// Init snes, load rom and apply the widescreen settings
+static bool LoadRom(const char *rom_filename) {
   const char* filename = rom_filename ? rom_filename : "sm.smc";
   g_game_ctx.snes = g_snes = SnesInit(filename);
 
@@ -524,6 +842,30 @@ static bool SetupWindowAndRenderer(const char *rom_filename) {
   g_game_ctx.snes->snes_ppu->extraRightCur = extra_pixels;
   g_game_ctx.snes->my_ppu->extraLeftCur = extra_pixels;
   g_game_ctx.snes->my_ppu->extraRightCur = extra_pixels;
+  return true;
+}
+
+// Setup SDL, window, renderer, and load ROM
+static bool SetupWindowAndRenderer(const char *rom_filename) {
+  // set up SDL
+  if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER) != 0) {
+    LogError("Failed to init SDL: %s", SDL_GetError());
+    return false;
+  }
+
+  bool custom_size = g_config.window_width != 0 && g_config.window_height != 0;
+  int window_width = custom_size ? g_config.window_width : g_render_ctx.current_window_scale * g_render_ctx.snes_width;
+  int window_height = custom_size ? g_config.window_height : g_render_ctx.current_window_scale * g_render_ctx.snes_height;
+
+  if (g_config.output_method == kOutputMethod_OpenGL) {
+    g_render_ctx.win_flags |= SDL_WINDOW_OPENGL;
+    OpenGLRenderer_Create(&g_renderer_funcs);
+  } else {
+    g_renderer_funcs = kSdlRendererFuncs;
+  }
+
+  if (!LoadRom(rom_filename))
+    return false;
 
   g_render_ctx.window = SDL_CreateWindow(kWindowTitle, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, g_render_ctx.win_flags);
   if(g_render_ctx.window == NULL) {
@@ -540,6 +882,50 @@ static bool SetupWindowAndRenderer(const char *rom_filename) {
   return true;
 }
 
+// Run a replay as fast as possible without a window or audio device and
+// print the throughput with a per-phase breakdown.
+static int RunHeadlessReplay(const char *replay_file, int max_frames) {
+  if (!RtlLoadSnapshot(replay_file, true))
+    return 1;
+  if (!RtlIsReplaying() && max_frames == 0) {
+    LogError("%s has no replay data, pass --frames", replay_file);
+    return 1;
+  }
+
+  int16 audio_buffer[(534 * 48000 / 32000) * 2];
+  int audio_frames = (534 * g_config.audio_freq) / 32000;
+  int frames = 0;
+
+  memset(&g_rtl_perf, 0, sizeof(g_rtl_perf));
+  g_rtl_perf.enabled = true;
+  uint64 start = g_rtl_perf.last = RtlGetPerfCounter();
+  while (max_frames ? frames < max_frames : RtlIsReplaying()) {
+    RtlRunFrame(0);
+    RenderPoolSubmit();
+    RtlRenderAudio(audio_buffer, audio_frames, 2);
+    frames++;
+  }
+  RenderPoolWait();
+  uint64 end = RtlGetPerfCounter();
+  g_rtl_perf.enabled = false;
+
+  static const char *const kPhaseNames[kRtlPerf_Count] = {
+    "other", "game logic", "ppu", "dsp", "verification",
+  };
+  double freq = (double)SDL_GetPerformanceFrequency();
+  double total = (end - start) / freq;
+  printf("%d frames in %.3f s, %.1f fps\n", frames, total, frames / (total > 0 ? total : 1));
+  for (int i = 1; i <= kRtlPerf_Count; i++) {
+    int phase = i % kRtlPerf_Count;
+    double t = g_rtl_perf.ticks[phase] / freq;
+    printf("  %-13s %8.3f ms/frame %5.1f%%\n", kPhaseNames[phase],
+           frames ? t * 1000 / frames : 0, total > 0 ? t * 100 / total : 0);
+  }
+  if (g_game_ctx.got_mismatch_count)
+    printf("Verification mismatch detected\n");
+  return 0;
+}
+
 // Initialize game and render contexts with validated configuration
 static void InitializeContexts(void) {
   // Validate that extended aspect ratio doesn't exceed PPU maximum
@@ -560,8 +946,10 @@ static void InitializeContexts(void) {
     g_config.extend_y * kPpuRenderFlags_Height240 |
     g_config.no_sprite_limits * kPpuRenderFlags_NoSpriteLimits;
 
-  // Allocate pixel buffers based on configured width/height
+  // Allocate pixel buffers based on configured width/height, mode7 may be drawn at 4x4
   size_t pixel_buffer_size = g_render_ctx.snes_width * 4 * g_render_ctx.snes_height;
+  if (g_render_ctx.ppu_render_flags & kPpuRenderFlags_4x4Mode7)
+    pixel_buffer_size *= 16;
   g_render_ctx.pixels = (uint8_t *)xmalloc(pixel_buffer_size);
   g_render_ctx.my_pixels = (uint8_t *)xmalloc(pixel_buffer_size);
   memset(g_render_ctx.pixels, 0, pixel_buffer_size);
@@ -588,6 +976,10 @@ static void InitializeContexts(void) {
   // audio_samples: power of 2
   if (g_config.audio_samples <= 0 || ((g_config.audio_samples & (g_config.audio_samples - 1)) != 0))
     g_config.audio_samples = kDefaultSamples;
+
+  // audio_lookahead: milliseconds
+  if (g_config.audio_lookahead > kMaxAudioLookahead)
+    g_config.audio_lookahead = kMaxAudioLookahead;
 }
 
 
@@ -609,19 +1001,68 @@ int main(int argc, char** argv) {
     g_game_ctx.emulator_debug_flag = true;
     argc -= 1, argv += 1;
   }
+  bool headless = false;
+  const char *replay_file = NULL;
+  const char *capture_audio_file = NULL;
+  int max_frames = 0;
+  for (;;) {
+    if (argc >= 1 && strcmp(argv[0], "--headless") == 0) {
+      headless = true;
+      argc -= 1, argv += 1;
+    } else if (argc >= 2 && strcmp(argv[0], "--replay") == 0) {
+      replay_file = argv[1];
+      argc -= 2, argv += 2;
+    } else if (argc >= 2 && strcmp(argv[0], "--frames") == 0) {
+      max_frames = atoi(argv[1]);
+      argc -= 2, argv += 2;
+    } else if (argc >= 2 && strcmp(argv[0], "--capture-audio") == 0) {
+      capture_audio_file = argv[1];
+      argc -= 2, argv += 2;
+    } else {
+      break;
+    }
+  }
   ParseConfigFile(config_file);
   InitializeContexts();
+  RtlSetDecompCacheSize(g_config.decompress_cache_kb * 1024);
+  if (g_config.prefetch_room_assets)
+    g_asset_prefetch = AssetPrefetch_Create(&DecompressToBuffer);
+
+  if (headless) {
+    if (replay_file == NULL) {
+      LogError("--headless requires --replay <file>");
+      return 1;
+    }
+    if (!LoadRom(argv[0]))
+      return 1;
+    SetupSpcPlayer();
+    // Nothing is real time here, so wait for the writer instead of dropping audio
+    if (capture_audio_file && !(g_audio_capture = AudioCapture_Open(capture_audio_file, true)))
+      return 1;
+    PpuBeginDrawing(g_game_ctx.snes->snes_ppu, g_render_ctx.pixels, g_render_ctx.snes_width * 4, g_render_ctx.ppu_render_flags);
+    PpuBeginDrawing(g_game_ctx.snes->my_ppu, g_render_ctx.my_pixels, g_render_ctx.snes_width * 4, g_render_ctx.ppu_render_flags);
+    SetupRenderPool(g_config.render_threads);
+    int result = RunHeadlessReplay(replay_file, max_frames);
+    DestroyRenderPool();
+    AudioCapture_Close(g_audio_capture);
+    AssetPrefetch_Destroy(g_asset_prefetch);
+    return result;
+  }
 
   if (!SetupWindowAndRenderer(argv[0])) {
     return 1;
   }
 
+  if (capture_audio_file && !(g_audio_capture = AudioCapture_Open(capture_audio_file, false)))
+    return 1;
+
   if (!SetupAudio()) {
     return 1;
   }
 
-  PpuBeginDrawing(g_game_ctx.snes->snes_ppu, g_render_ctx.pixels, g_render_ctx.snes_width * 4, 0);
-  PpuBeginDrawing(g_game_ctx.snes->my_ppu, g_render_ctx.my_pixels, g_render_ctx.snes_width * 4, 0);
+  PpuBeginDrawing(g_game_ctx.snes->snes_ppu, g_render_ctx.pixels, g_render_ctx.snes_width * 4, g_render_ctx.ppu_render_flags);
+  PpuBeginDrawing(g_game_ctx.snes->my_ppu, g_render_ctx.my_pixels, g_render_ctx.snes_width * 4, g_render_ctx.ppu_render_flags);
+  SetupRenderPool(g_config.render_threads);
 
 #if defined(_WIN32)
   _mkdir("saves");
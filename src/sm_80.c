@@ -478,17 +478,12 @@ void NMI_ProcessMode7QueueInner(const uint8 *p) {  // 0x808BD3
 void NMI_ProcessVramWriteQueue(void) {  // 0x808C83
   if (vram_write_queue_tail) {
     gVramWriteEntry(vram_write_queue_tail)->size = 0;
-    WriteRegWord(DMAP1, 0x1801);
     for (int i = 0; ; i += 7) {
       VramWriteEntry *e = gVramWriteEntry(i);
       if (!e->size)
         break;
-      WriteRegWord(DAS1L, e->size);
-      WriteRegWord(A1T1L, e->src.addr);
-      WriteReg(A1B1, e->src.bank);
-      WriteRegWord(VMAIN, sign16(e->vram_dst) ? 0x81 : 0x80);
-      WriteRegWord(VMADDL, e->vram_dst);
-      WriteReg(MDMAEN, 2);
+      const uint8 *src = RtlReadBus(e->src.bank << 16 | e->src.addr, e->size);
+      PpuVramWrite(e->vram_dst, src, e->size, sign16(e->vram_dst) ? 0x81 : 0x80);
     }
   }
   vram_write_queue_tail = 0;
@@ -500,56 +495,24 @@ void Nmi_ProcessHorizScrollingDma(void) {  // 0x808CD8
   WriteReg(VMAIN, 0x81);
   if ((uint8)bg1_update_col_enable) {
     LOBYTE(bg1_update_col_enable) = 0;
-    uint16 v0 = bg1_update_col_unwrapped_dst;
-    WriteRegWord(VMADDL, bg1_update_col_unwrapped_dst);
-    WriteRegWord(DMAP1, 0x1801);
-    WriteRegWord(A1T1L, ADDR16_OF_RAM(*bg1_column_update_tilemap_left_halves));
-    WriteReg(A1B1, 0x7E);
-    uint16 v1 = bg1_update_col_unwrapped_size;
-    WriteRegWord(DAS1L, bg1_update_col_unwrapped_size);
-    WriteReg(MDMAEN, 2);
-    WriteRegWord(VMADDL, v0 + 1);
-    WriteRegWord(DAS1L, v1);
-    WriteRegWord(A1T1L, ADDR16_OF_RAM(*bg1_column_update_tilemap_right_halves));
-    WriteReg(MDMAEN, 2);
-    WriteRegWord(A1T1L, bg1_update_col_wrapped_left_src);
-    uint16 v2 = bg1_update_col_wrapped_size;
+    uint16 dst = bg1_update_col_unwrapped_dst, size = bg1_update_col_unwrapped_size;
+    PpuVramWrite(dst, (uint8 *)bg1_column_update_tilemap_left_halves, size, 0x81);
+    PpuVramWrite(dst + 1, (uint8 *)bg1_column_update_tilemap_right_halves, size, 0x81);
     if (bg1_update_col_wrapped_size) {
-      WriteRegWord(DAS1L, bg1_update_col_wrapped_size);
-      uint16 v3 = bg1_update_col_wrapped_dst;
-      WriteRegWord(VMADDL, bg1_update_col_wrapped_dst);
-      WriteReg(MDMAEN, 2);
-      WriteRegWord(VMADDL, v3 + 1);
-      WriteRegWord(DAS1L, v2);
-      WriteRegWord(A1T1L, bg1_update_col_wrapped_right_src);
-      WriteReg(MDMAEN, 2);
+      dst = bg1_update_col_wrapped_dst, size = bg1_update_col_wrapped_size;
+      PpuVramWrite(dst, g_ram + bg1_update_col_wrapped_left_src, size, 0x81);
+      PpuVramWrite(dst + 1, g_ram + bg1_update_col_wrapped_right_src, size, 0x81);
     }
   }
   if ((uint8)bg2_update_col_enable) {
     LOBYTE(bg2_update_col_enable) = 0;
-    uint16 v4 = bg2_update_col_unwrapped_dst;
-    WriteRegWord(VMADDL, bg2_update_col_unwrapped_dst);
-    WriteRegWord(DMAP1, 0x1801);
-    WriteRegWord(A1T1L, ADDR16_OF_RAM(*bg2_column_update_tilemap_left_halves));
-    WriteReg(A1B1, 0x7E);
-    uint16 v5 = bg2_update_col_unwrapped_size;
-    WriteRegWord(DAS1L, bg2_update_col_unwrapped_size);
-    WriteReg(MDMAEN, 2);
-    WriteRegWord(VMADDL, v4 + 1);
-    WriteRegWord(DAS1L, v5);
-    WriteRegWord(A1T1L, ADDR16_OF_RAM(*bg2_column_update_tilemap_right_halves));
-    WriteReg(MDMAEN, 2);
-    WriteRegWord(A1T1L, bg2_update_col_wrapped_left_src);
-    uint16 v6 = bg2_update_col_wrapped_size;
+    uint16 dst = bg2_update_col_unwrapped_dst, size = bg2_update_col_unwrapped_size;
+    PpuVramWrite(dst, (uint8 *)bg2_column_update_tilemap_left_halves, size, 0x81);
+    PpuVramWrite(dst + 1, (uint8 *)bg2_column_update_tilemap_right_halves, size, 0x81);
     if (bg2_update_col_wrapped_size) {
-      WriteRegWord(DAS1L, bg2_update_col_wrapped_size);
-      uint16 v7 = bg2_update_col_wrapped_dst;
-      WriteRegWord(VMADDL, bg2_update_col_wrapped_dst);
-      WriteReg(MDMAEN, 2);
-      WriteRegWord(VMADDL, v7 + 1);
-      WriteRegWord(DAS1L, v6);
-      WriteRegWord(A1T1L, bg2_update_col_wrapped_right_src);
-      WriteReg(MDMAEN, 2);
+      dst = bg2_update_col_wrapped_dst, size = bg2_update_col_wrapped_size;
+      PpuVramWrite(dst, g_ram + bg2_update_col_wrapped_left_src, size, 0x81);
+      PpuVramWrite(dst + 1, g_ram + bg2_update_col_wrapped_right_src, size, 0x81);
     }
   }
 }
@@ -558,56 +521,24 @@ void Nmi_ProcessVertScrollingDma(void) {  // 0x808DAC
   WriteReg(VMAIN, 0x80);
   if ((uint8)bg1_update_row_enable) {
     LOBYTE(bg1_update_row_enable) = 0;
-    uint16 v0 = bg1_update_row_unwrapped_dst;
-    WriteRegWord(VMADDL, bg1_update_row_unwrapped_dst);
-    WriteRegWord(DMAP1, 0x1801);
-    WriteRegWord(A1T1L, ADDR16_OF_RAM(*bg1_column_update_tilemap_top_halves));
-    WriteReg(A1B1, 0x7E);
-    uint16 v1 = bg1_update_row_unwrapped_size;
-    WriteRegWord(DAS1L, bg1_update_row_unwrapped_size);
-    WriteReg(MDMAEN, 2);
-    WriteRegWord(VMADDL, v0 | 0x20);
-    WriteRegWord(DAS1L, v1);
-    WriteRegWord(A1T1L, ADDR16_OF_RAM(*bg1_column_update_tilemap_bottom_halves));
-    WriteReg(MDMAEN, 2);
-    WriteRegWord(A1T1L, bg1_update_row_wrapped_top_src);
-    uint16 v2 = bg1_update_row_wrapped_size;
+    uint16 dst = bg1_update_row_unwrapped_dst, size = bg1_update_row_unwrapped_size;
+    PpuVramWrite(dst, (uint8 *)bg1_column_update_tilemap_top_halves, size, 0x80);
+    PpuVramWrite(dst | 0x20, (uint8 *)bg1_column_update_tilemap_bottom_halves, size, 0x80);
     if (bg1_update_row_wrapped_size) {
-      WriteRegWord(DAS1L, bg1_update_row_wrapped_size);
-      uint16 v3 = bg1_update_row_wrapped_dst;
-      WriteRegWord(VMADDL, bg1_update_row_wrapped_dst);
-      WriteReg(MDMAEN, 2);
-      WriteRegWord(VMADDL, v3 | 0x20);
-      WriteRegWord(DAS1L, v2);
-      WriteRegWord(A1T1L, bg1_update_row_wrapped_bottom_src);
-      WriteReg(MDMAEN, 2);
+      dst = bg1_update_row_wrapped_dst, size = bg1_update_row_wrapped_size;
+      PpuVramWrite(dst, g_ram + bg1_update_row_wrapped_top_src, size, 0x80);
+      PpuVramWrite(dst | 0x20, g_ram + bg1_update_row_wrapped_bottom_src, size, 0x80);
     }
   }
   if ((uint8)bg2_update_row_enable) {
     LOBYTE(bg2_update_row_enable) = 0;
-    uint16 v4 = bg2_update_row_unwrapped_dst;
-    WriteRegWord(VMADDL, bg2_update_row_unwrapped_dst);
-    WriteRegWord(DMAP1, 0x1801);
-    WriteRegWord(A1T1L, ADDR16_OF_RAM(*bg2_column_update_tilemap_top_halves));
-    WriteReg(A1B1, 0x7E);
-    uint16 v5 = bg2_update_row_unwrapped_size;
-    WriteRegWord(DAS1L, bg2_update_row_unwrapped_size);
-    WriteReg(MDMAEN, 2);
-    WriteRegWord(VMADDL, v4 | 0x20);
-    WriteRegWord(DAS1L, v5);
-    WriteRegWord(A1T1L, ADDR16_OF_RAM(*bg2_column_update_tilemap_bottom_halves));
-    WriteReg(MDMAEN, 2);
-    WriteRegWord(A1T1L, bg2_update_row_wrapped_top_src);
-    uint16 v6 = bg2_update_row_wrapped_size;
+    uint16 dst = bg2_update_row_unwrapped_dst, size = bg2_update_row_unwrapped_size;
+    PpuVramWrite(dst, (uint8 *)bg2_column_update_tilemap_top_halves, size, 0x80);
+    PpuVramWrite(dst | 0x20, (uint8 *)bg2_column_update_tilemap_bottom_halves, size, 0x80);
     if (bg2_update_row_wrapped_size) {
-      WriteRegWord(DAS1L, bg2_update_row_wrapped_size);
-      uint16 v7 = bg2_update_row_wrapped_dst;
-      WriteRegWord(VMADDL, bg2_update_row_wrapped_dst);
-      WriteReg(MDMAEN, 2);
-      WriteRegWord(VMADDL, v7 | 0x20);
-      WriteRegWord(DAS1L, v6);
-      WriteRegWord(A1T1L, bg2_update_row_wrapped_bottom_src);
-      WriteReg(MDMAEN, 2);
+      dst = bg2_update_row_wrapped_dst, size = bg2_update_row_wrapped_size;
+      PpuVramWrite(dst, g_ram + bg2_update_row_wrapped_top_src, size, 0x80);
+      PpuVramWrite(dst | 0x20, g_ram + bg2_update_row_wrapped_bottom_src, size, 0x80);
     }
   }
 }
@@ -905,50 +836,25 @@ void NmiUpdateIoRegisters(void) {  // 0x8091EE
 }
 
 void NmiUpdatePalettesAndOam(void) {  // 0x80933A
-  WriteRegWord(DMAP0, 0x400);
-  WriteRegWord(A1T0L, ADDR16_OF_RAM(*oam_ent));
-  WriteReg(A1B0, 0);
-  WriteRegWord(DAS0L, 0x220);
-  WriteRegWord(OAMADDL, 0);
-  WriteRegWord(DMAP1, 0x2200);
-  WriteRegWord(A1T1L, ADDR16_OF_RAM(*palette_buffer));
-  WriteReg(A1B1, 0x7E);
-  WriteRegWord(DAS1L, 0x200);
-  WriteReg(CGADD, 0);
-  WriteReg(MDMAEN, 3);
+  PpuOamWrite(0, (uint8 *)oam_ent, 0x220);
+  PpuCgramWrite(0, (uint8 *)palette_buffer, 0x200);
 }
 
 void NmiTransferSamusToVram(void) {  // 0x809376
   WriteReg(VMAIN, 0x80);
   if ((uint8)nmi_copy_samus_halves) {
     SamusTileAnimationTileDefs *td = (SamusTileAnimationTileDefs *)RomPtr_92(nmi_copy_samus_top_half_src);
-    WriteRegWord(VMADDL, 0x6000);
-    WriteRegWord(DMAP1, 0x1801);
-    WriteRegWord(A1T1L, td->src.addr);
-    WriteReg(A1B1, td->src.bank);
-    WriteRegWord(DAS1L, td->part1_size);
-    WriteReg(MDMAEN, 2);
-    WriteRegWord(VMADDL, 0x6100);
-    WriteRegWord(A1T1L, td->src.addr + td->part1_size);
-    if (td->part2_size) {
-      WriteRegWord(DAS1L, td->part2_size);
-      WriteReg(MDMAEN, 2);
-    }
+    uint32 src = td->src.bank << 16 | td->src.addr;
+    PpuVramWrite(0x6000, RtlReadBus(src, td->part1_size), td->part1_size, 0x80);
+    src = (src & 0xff0000) | (uint16)(src + td->part1_size);
+    PpuVramWrite(0x6100, RtlReadBus(src, td->part2_size), td->part2_size, 0x80);
   }
   if (HIBYTE(nmi_copy_samus_halves)) {
     SamusTileAnimationTileDefs *td = (SamusTileAnimationTileDefs *)RomPtr_92(nmi_copy_samus_bottom_half_src);
-    WriteRegWord(VMADDL, 0x6080);
-    WriteRegWord(DMAP1, 0x1801);
-    WriteRegWord(A1T1L, td->src.addr);
-    WriteReg(A1B1, td->src.bank);
-    WriteRegWord(DAS1L, td->part1_size);
-    WriteReg(MDMAEN, 2);
-    WriteRegWord(VMADDL, 0x6180);
-    WriteRegWord(A1T1L, td->src.addr + td->part1_size);
-    if (td->part2_size) {
-      WriteRegWord(DAS1L, td->part2_size);
-      WriteReg(MDMAEN, 2);
-    }
+    uint32 src = td->src.bank << 16 | td->src.addr;
+    PpuVramWrite(0x6080, RtlReadBus(src, td->part1_size), td->part1_size, 0x80);
+    src = (src & 0xff0000) | (uint16)(src + td->part1_size);
+    PpuVramWrite(0x6180, RtlReadBus(src, td->part2_size), td->part2_size, 0x80);
   }
 }
 
@@ -958,13 +864,8 @@ void NmiProcessAnimtilesVramTransfers(void) {  // 0x809416
       int v1 = i >> 1;
       if (animtiles_ids[v1]) {
         if (animtiles_src_ptr[v1]) {
-          WriteRegWord(A1T0L, animtiles_src_ptr[v1]);
-          WriteReg(A1B0, 0x87);
-          WriteRegWord(DMAP0, 0x1801);
-          WriteRegWord(DAS0L, animtiles_sizes[v1]);
-          WriteRegWord(VMADDL, animtiles_vram_ptr[v1]);
-          WriteReg(VMAIN, 0x80);
-          WriteReg(MDMAEN, 1);
+          const uint8 *src = RtlReadBus(0x870000 | animtiles_src_ptr[v1], animtiles_sizes[v1]);
+          PpuVramWrite(animtiles_vram_ptr[v1], src, animtiles_sizes[v1], 0x80);
           animtiles_src_ptr[v1] = 0;
         }
       }
@@ -2476,150 +2377,164 @@ void ConfigureMode7RotationMatrix(void) {  // 0x80B0C2
   }
 }
 
-static uint32 decompress_src;
+// State of one decode, kept on the stack so the asset prefetcher can decode
+// on its own thread while the game does
+typedef struct Decompressor {
+  uint32 src;
+  bool reads_old;  // a back reference read bytes it didn't write
+} Decompressor;
 
-static uint8 DecompNextByte() {
-  uint8 b = *RomPtr(decompress_src);
-  if ((decompress_src++ & 0xffff) == 0xffff)
-    decompress_src += 0x8000;
+static uint8 DecompNextByte(Decompressor *dec) {
+  uint8 b = *RomPtr(dec->src);
+  if ((dec->src++ & 0xffff) == 0xffff)
+    dec->src += 0x8000;
   return b;
 }
 
-void DecompressToMem(uint32 src, uint8 *decompress_dst) {  // 0x80B119
-  decompress_src = src;
-
-  int src_pos, dst_pos = 0;
+// Same as n calls to DecompNextByte, a bank at a time
+static void DecompNextBytes(Decompressor *dec, uint8 *dst, uint32 n) {
+  while (n) {
+    uint32 chunk = IntMin(n, 0x10000 - (dec->src & 0xffff));
+    memcpy(dst, RomPtr(dec->src), chunk);
+    dst += chunk, n -= chunk;
+    dec->src += chunk;
+    if (!(dec->src & 0xffff))
+      dec->src += 0x8000;
+  }
+}
+
+// What the port accesses of the last back reference left in the vram latches
+typedef struct DecompVramLatch {
+  bool valid;
+  uint16 read_buffer;
+  uint8 open_bus;
+} DecompVramLatch;
+
+// Decodes the stream at dec->src into buf[pos & mask] starting at
+// pos = base, back references being relative to base. The output of each
+// command is produced in one go, spilling through a temporary when it wraps
+// around the mask. With |latch| set buf is the vram and gets prepared for
+// every write. Returns the end position.
+static uint32 DecompressLz(Decompressor *dec, uint8 *buf, uint32 base, uint32 mask, DecompVramLatch *latch) {
+  uint32 src_pos, dst_pos = base;
   while (1) {
-    int len;
-    uint8 cmd, b;
-    b = DecompNextByte();
+    uint32 len;
+    uint8 b = DecompNextByte(dec), cmd;
     if (b == 0xFF)
       break;
     if ((b & 0xE0) == 0xE0) {
       cmd = (8 * b) & 0xE0;
-      len = ((b & 3) << 8 | DecompNextByte()) + 1;
+      len = ((b & 3) << 8 | DecompNextByte(dec)) + 1;
     } else {
       cmd = b & 0xE0;
       len = (b & 0x1F) + 1;
     }
+    if (latch)
+      PpuPrepareVramBytes(dst_pos, len);
+    uint32 d = dst_pos & mask;
+    bool wraps = ((dst_pos + len - 1) & mask) < d;
     if (cmd & 0x80) {
       uint8 want_xor = cmd & 0x20 ? 0xff : 0;
       if (cmd >= 0xC0) {
-        src_pos = dst_pos - DecompNextByte();
+        src_pos = dst_pos - DecompNextByte(dec);
+      } else {
+        src_pos = DecompNextByte(dec);
+        src_pos += DecompNextByte(dec) * 256;
+        src_pos += base;
+      }
+      if (src_pos < base || src_pos >= dst_pos)
+        dec->reads_old = true;
+      uint32 s = src_pos & mask;
+      uint8 last_old = buf[(dst_pos + len - 1) & mask];
+      if (!wraps && ((s + len - 1) & mask) >= s && (s + len <= d || d + len <= s)) {
+        uint8 *p = buf + d;
+        const uint8 *q = buf + s;
+        for (uint32 i = 0; i < len; i++)
+          p[i] = q[i] ^ want_xor;
+        dst_pos += len, src_pos += len;
       } else {
-        src_pos = DecompNextByte();
-        src_pos += DecompNextByte() * 256;
+        // overlapping, repeats what it just wrote
+        do {
+          buf[dst_pos++ & mask] = buf[src_pos++ & mask] ^ want_xor;
+        } while (--len);
+      }
+      if (latch) {
+        // VMADDL was set to the last byte before writing it, after reading the
+        // word of the last source byte
+        d = (dst_pos - 1) & mask, s = (src_pos - 1) & mask;
+        uint8 lo = buf[d & ~1], hi = buf[d | 1];
+        if (d & 1)
+          hi = last_old;
+        else
+          lo = last_old;
+        latch->valid = true;
+        latch->read_buffer = lo | hi << 8;
+        latch->open_bus = (s | 1) == d ? last_old : buf[s | 1];
       }
-      do {
-        b = decompress_dst[src_pos++] ^ want_xor;
-        decompress_dst[dst_pos++] = b;
-      } while (--len);
     } else {
+      uint8 tmp[1024], *p = wraps ? tmp : buf + d;
       switch (cmd) {
       case 0x20:
-        b = DecompNextByte();
-        do {
-          decompress_dst[dst_pos++] = b;
-        } while (--len);
+        memset(p, DecompNextByte(dec), len);
         break;
       case 0x40: {
-        b = DecompNextByte();
-        uint8 b2 = DecompNextByte();
-        do {
-          decompress_dst[dst_pos++] = b;
-          if (!--len)
-            break;
-          decompress_dst[dst_pos++] = b2;
-        } while (--len);
+        b = DecompNextByte(dec);
+        uint8 b2 = DecompNextByte(dec);
+        for (uint32 i = 0; i < len; i++)
+          p[i] = (i & 1) ? b2 : b;
         break;
       }
       case 0x60:
-        b = DecompNextByte();
-        do {
-          decompress_dst[dst_pos++] = b++;
-        } while (--len);
+        b = DecompNextByte(dec);
+        for (uint32 i = 0; i < len; i++)
+          p[i] = b + i;
         break;
       default:
-        do {
-          b = DecompNextByte();
-          decompress_dst[dst_pos++] = b;
-        } while (--len);
+        DecompNextBytes(dec, p, len);
         break;
       }
+      if (wraps) {
+        for (uint32 i = 0; i < len; i++)
+          buf[(dst_pos + i) & mask] = tmp[i];
+      }
+      dst_pos += len;
     }
   }
+  return dst_pos;
 }
 
-static uint8 ReadPpuByte(uint16 addr) {
-  WriteRegWord(VMADDL, addr >> 1);
-  ReadRegWord(RDVRAML);  // latch
-  uint16 data = ReadRegWord(RDVRAML);
-  return (addr & 1) ? GET_HIBYTE(data) : data;
+void DecompressToMem(uint32 src, uint8 *decompress_dst) {  // 0x80B119
+  uint32 size;
+  const uint8 *cached = RtlDecompCacheFind(src, &size);
+  if (cached) {
+    memcpy(decompress_dst, cached, size);
+    return;
+  }
+  Decompressor dec = { src };
+  size = DecompressLz(&dec, decompress_dst, 0, 0xffffffff, NULL);
+  // the output only depends on the rom, unless it copies what was there before
+  if (!dec.reads_old)
+    RtlDecompCacheAdd(src, decompress_dst, size);
+}
+
+uint32 DecompressToBuffer(uint32 src, uint8 *dst, uint32 dst_size) {
+  Decompressor dec = { src };
+  uint32 size = DecompressLz(&dec, dst, 0, dst_size - 1, NULL);
+  return (dec.reads_old || size > dst_size) ? 0 : size;
 }
 
 void DecompressToVRAM(uint32 src, uint16 dst_addr) {  // 0x80B271
-  decompress_src = src;
-  int src_pos, dst_pos = dst_addr;
-  while (1) {
-    int len;
-    uint8 b = DecompNextByte(), cmd;
-    if (b == 0xFF)
-      break;
-    if ((b & 0xE0) == 0xE0) {
-      cmd = (8 * b) & 0xE0;
-      len = ((b & 3) << 8 | DecompNextByte()) + 1;
-    } else {
-      cmd = b & 0xE0;
-      len = (b & 0x1F) + 1;
-    }
-    if (cmd & 0x80) {
-      uint8 want_xor = cmd & 0x20 ? 0xff : 0;
-      if (cmd >= 0xC0) {
-        src_pos = dst_pos - DecompNextByte();
-      } else {
-        src_pos = DecompNextByte();
-        src_pos += DecompNextByte() * 256;
-        src_pos += dst_addr;
-      }
-      do {
-        b = ReadPpuByte(src_pos++) ^ want_xor;
-        WriteRegWord(VMADDL, dst_pos >> 1);
-        WriteReg(VMDATAL + (dst_pos++ & 1), b);
-      } while (--len);
-    } else {
-      switch (cmd) {
-      case 0x20:
-        b = DecompNextByte();
-        do {
-          WriteReg(VMDATAL + (dst_pos++ & 1), b);
-        } while (--len);
-        break;
-      case 0x40: {
-        b = DecompNextByte();
-        uint8 b2 = DecompNextByte();
-        do {
-          WriteReg(VMDATAL + (dst_pos++ & 1), b);
-          if (!--len)
-            break;
-          WriteReg(VMDATAL + (dst_pos++ & 1), b2);
-        } while (--len);
-        break;
-      }
-      case 0x60:
-        b = DecompNextByte();
-        do {
-          WriteReg(VMDATAL + (dst_pos++ & 1), b++);
-        } while (--len);
-        break;
-      default:
-        do {
-          b = DecompNextByte();
-          WriteReg(VMDATAL + (dst_pos++ & 1), b++);
-        } while (--len);
-        break;
-      }
-    }
-  }
+  // The original goes through the vram ports a byte at a time, with VMAIN set
+  // to 0x80 and VMADDL to dst_addr / 2 by the caller. This decodes straight
+  // into the vram and sets the latches the way the ports would have at the
+  // end: the address past the output and, from the last back reference, the
+  // read buffer and open bus.
+  DecompVramLatch latch = { 0 };
+  Decompressor dec = { src };
+  uint32 end = DecompressLz(&dec, PpuGetVramBytes(), dst_addr, 0xffff, &latch);
+  PpuSetVramPointer(end >> 1);
+  if (latch.valid)
+    PpuSetVramReadLatch(latch.read_buffer, latch.open_bus);
 }
 
 
@@ -4,6 +4,7 @@
 #include "variables.h"
 #include "funcs.h"
 #include "enemy_types.h"
+#include "asset_prefetch.h"
 
 #define kDemoRoomData ((uint16*)RomFixedPtr(0x82876c))
 #define kPauseScreenSpriteAnimationData_0 (*(PauseScreenSpriteAnimationData*)RomFixedPtr(0x82c0b2))
@@ -3597,6 +3598,31 @@ CoroutineRet GameState_25_SamusNoHealth_BlackOut(void) {  // 0x82DDC7
   return kCoroutineNone;
 }
 
+// Called when the door is touched. What the room behind it will decompress
+// gets decoded in the background while the screen fades out. Its state isn't
+// selected until then, so the assets of all of them are requested.
+static void PrefetchDestinationRoomAssets(void) {
+  uint16 room_definition_ptr = get_DoorDef(door_def_ptr)->room_definition_ptr;
+  uint16 states[8];
+  uint32 srcs[kAssetPrefetch_MaxEntries];
+  int n = 0;
+  if (cre_bitset & 2)
+    srcs[n++] = 0xb98000;
+  int num_states = GetRoomDefStates(room_definition_ptr, states, 8);
+  // The default state goes first, it is the most likely one
+  for (int i = num_states - 1; i >= 0; i--) {
+    RoomDefRoomstate *RD = get_RoomDefRoomstate(states[i]);
+    TileSet *TS = get_TileSet(kStateHeaderTileSets[RD->graphics_set]);
+    srcs[n++] = Load24(&RD->compressed_room_map_ptr);
+    srcs[n++] = Load24(&TS->tiles_ptr);
+    srcs[n++] = Load24(&TS->palette_ptr);
+    srcs[n++] = Load24(&TS->tile_table_ptr);
+  }
+  srcs[n++] = 0xb9a09d;
+  assert(n <= kAssetPrefetch_MaxEntries);
+  RtlPrefetchAssets(srcs, n);
+}
+
 void LoaadDesinationRoomCreBitset(void) {  // 0x82DDF1
   uint16 room_definition_ptr = get_DoorDef(door_def_ptr)->room_definition_ptr;
   previous_cre_bitset = cre_bitset;
@@ -3828,6 +3854,7 @@ CoroutineRet GameState_10_LoadingNextRoom_Async(void) {  // 0x82E1B7
   DrawSamusEnemiesAndProjectiles();
   EnsureSamusDrawnEachFrame();
   LoaadDesinationRoomCreBitset();
+  PrefetchDestinationRoomAssets();
   for (int i = 254; i >= 0; i -= 2) {
     int v1 = i >> 1;
     target_palettes[v1] = 0;
@@ -700,6 +700,35 @@ void HandleRoomDefStateSelect(uint16 k) {  // 0x8FE5D2
   } while (v1);
 }
 
+// Lists every state room k can select, without checking the conditions.
+// The default state is last. Returns how many were stored in states.
+int GetRoomDefStates(uint16 k, uint16 *states, int max_states) {
+  int n = 0;
+  for (uint16 v1 = k + 11; n < max_states; ) {
+    uint16 event_pointer = get_RoomDefStateSelect_E6E5_Finish(v1)->code_ptr;
+    const uint8 *arg = RomPtr_8F(v1 + 2);
+    switch (event_pointer | 0x8F0000) {
+    case fnRoomDefStateSelect_Finish:
+      states[n++] = v1 + 2;
+      return n;
+    case fnRoomDefStateSelect_TourianBoss01:
+    case fnRoomDefStateSelect_MorphBallMissiles:
+    case fnRoomDefStateSelect_PowerBombs:
+      states[n++] = GET_WORD(arg);
+      v1 += 4;
+      break;
+    case fnRoomDefStateSelect_IsEventSet:
+    case fnRoomDefStateSelect_IsBossDead:
+      states[n++] = GET_WORD(arg + 1);
+      v1 += 5;
+      break;
+    default:
+      return n;
+    }
+  }
+  return n;
+}
+
 uint16 RoomDefStateSelect_Finish(uint16 k) {  // 0x8FE5E6
   roomdefroomstate_ptr = k;
   return 0;
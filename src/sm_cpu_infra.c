@@ -20,6 +20,7 @@ uint8 g_runmode = RM_BOTH;
 
 enum {
   kBugCountdownFrames = 300,  // 5 seconds at 60 FPS (5 * 60)
+  kVerifyTransitionTailFrames = 60,  // keep verifying for 1 second after a room transition
 };
 
 extern GameContext g_game_ctx;
@@ -46,6 +47,14 @@ typedef struct Snapshot {
 } Snapshot;
 
 static Snapshot g_snapshot_mine, g_snapshot_theirs, g_snapshot_before;
+// False while an unverified frame left the C code inside a multi-frame
+// routine that the emulated cpu never entered.
+static bool g_emulated_cpu_synced = true;
+// True when my_ppu missed register writes from unverified frames.
+static bool g_my_ppu_stale;
+static uint32 g_verify_transition_frames;
+// vramSerial of snes_ppu and my_ppu when their vrams were last known equal
+static uint32 g_synced_vram_serial[2];
 static uint32 hookmode, hookcnt, hookadr;
 static uint32 hooked_func_pc;
 static uint8 hook_orgbyte[1024];
@@ -538,17 +547,20 @@ bool HookedFunctionRts(int is_long) {
   return false;
 }
 
-// Compare byte-based memory regions (RAM, SRAM) with smart byte/word formatting
+// Compare byte-based memory regions (RAM, SRAM) with smart byte/word formatting.
+// Bytes where |mask| is zero are not compared.
 static void CompareByteRegion(const char *region_name, const uint8 *mine, const uint8 *theirs,
-                               const uint8 *prev, size_t size, int max_diffs) {
+                               const uint8 *prev, const uint8 *mask, size_t size, int max_diffs) {
+#define DIFFERS(i) (((mine[i] ^ theirs[i]) & (mask ? mask[i] : 0xff)) != 0)
   if (memcmp(mine, theirs, size)) {
-    LogError("@%d: %s compare failed (mine != theirs, prev):", snes_frame_counter, region_name);
     int j = 0;
     for (size_t i = 0; i < size; i++) {
-      if (theirs[i] != mine[i]) {
+      if (DIFFERS(i)) {
+        if (j == 0)
+          LogError("@%d: %s compare failed (mine != theirs, prev):", snes_frame_counter, region_name);
         if (++j < max_diffs) {
           // Smart formatting: print as word if both bytes differ and properly aligned
-          if (((i & 1) == 0 || i < 0x10000) && i + 1 < size && theirs[i + 1] != mine[i + 1]) {
+          if (((i & 1) == 0 || i < 0x10000) && i + 1 < size && DIFFERS(i + 1)) {
             LogError("0x%.6X: %.4X != %.4X (%.4X)", (int)i,
                     WORD(mine[i]), WORD(theirs[i]), WORD(prev[i]));
             i++, j++;
@@ -558,10 +570,12 @@ static void CompareByteRegion(const char *region_name, const uint8 *mine, const
         }
       }
     }
-    if (j)
+    if (j) {
       g_fail = true;
-    LogError("  total of %d failed bytes", (int)j);
+      LogError("  total of %d failed bytes", (int)j);
+    }
   }
+#undef DIFFERS
 }
 
 // Compare word-based memory regions (VRAM, OAM)
@@ -580,69 +594,144 @@ static void CompareWordRegion(const char *region_name, const uint16 *mine, const
   }
 }
 
+typedef struct VerifyRange {
+  uint32 addr, size;
+} VerifyRange;
+
+// Variables that are allowed to differ, the original version's value is kept
+static const VerifyRange kVerifyIgnoredVars[] = {
+  {0x0, 0x51},  // r18, r20, R22 etc
+  {0x1f5b, 0x100 - 0x5b},  // stacck
+  {0xad, 4},  // ptr_to_retaddr_parameters etc
+  {0x5e7, 14},  // bitmask, mult_tmp, mult_product_lo etc
+  {0x5BC, 9},  // door_transition_vram_update etc
+  {0x641, 2},  // apu_attempts_countdown
+  {0xA82, 2},  // xray_angle
+  {0xB24, 4},  // xray_angle
+  {0x1966, 6},  // current_fx_entry_offset etc
+  {0x1993, 2},  // eproj_init_param
+  {0x19b3, 2},  // mode7_spawn_param
+  {0x1a93, 2},  // cinematic_spawn_param
+  {0x1B9D, 2},  // cinematic_spawn_param
+};
+
+// Variables that are allowed to differ, my version's value is kept
+static const VerifyRange kVerifyKeepMineVars[] = {
+  {0x60B, 6},  // eproj_init_param_2, remaining_enemy_hitbox_entries, REMOVED_num_projectiles_to_check_enemy_coll
+  {0x611, 6},  // coroutine_state (copy from mine to theirs)
+  {0x77e, 5},  // my counter
+  {0x78F, 2},  // door_bts
+  {0x7b7, 2},  // event_pointer
+  {0x933, 10},  // var933 etc
+  {0xd1e, 2},  // grapple_beam_unkD1E
+  {0xd82, 8},  // grapple_beam_tmpD82
+  {0xd9c, 2},  // grapple_beam_tmpD82
+  {0xdd2, 6},  // temp_collision_DD2 etc
+  {0xd8a, 6},  // grapple_beam_tmpD8A
+  {0xe20, 0xe46 - 0xe20},  // temp vars
+  {0xe54, 2},  // cur_enemy_index
+  {0xe02, 2},  // samus_bottom_boundary_position
+  {0xe4a, 2},  // new_enemy_index
+  {0xe56, 4},  // REMOVED_cur_enemy_index_backup etc
+  {0x1784, 8},  // enemy_ai_pointer etc
+  {0x1790, 4},  // set_to_rtl_when_loading_enemies_unused etc
+  {0x17a8, 4},  // interactive_enemy_indexes_index
+  {0x1834, 8},  // distance_to_enemy_colliding_dirs
+  {0x184A, 18},  // samus_x_pos_colliding_solid etc
+  {0x186E, 16+8},  // REMOVED_enemy_spritemap_entry_pointer etc
+  {0x18A6, 2},  // collision_detection_index
+  {0x189A, 12},  // samus_target_x_pos etc
+  {0x1E77, 2},  // current_slope_bts
+  {0x9100, 0x1cc + 2},  // XrayHdmaFunc has some bug that i couldn't fix in asm
+  {0x9800, 0x1cc+2},  // XrayHdmaFunc has some bug that i couldn't fix in asm
+  {0x99cc, 2},  // XrayHdmaFunc_BeamAimedL writes outside
+  {0xEF74, 4},  // next_enemy_tiles_index
+  {0xF37A, 6},  // word_7EF37A etc
+};
+
+// 0xff for bytes that are compared, 0 for the ones above. Only pages with
+// ignored bytes need the mask, the others compare as a plain memcmp.
+static uint8 g_verify_ram_mask[0x20000];
+static bool g_verify_ram_page_masked[0x20000 >> 8];
+
+static void InitVerifyRamMask(void) {
+  memset(g_verify_ram_mask, 0xff, sizeof(g_verify_ram_mask));
+  for (int k = 0; k < 2; k++) {
+    const VerifyRange *r = k ? kVerifyKeepMineVars : kVerifyIgnoredVars;
+    size_t n = k ? countof(kVerifyKeepMineVars) : countof(kVerifyIgnoredVars);
+    for (size_t i = 0; i < n; i++) {
+      memset(&g_verify_ram_mask[r[i].addr], 0, r[i].size);
+      for (uint32 a = r[i].addr; a < r[i].addr + r[i].size; a++)
+        g_verify_ram_page_masked[a >> 8] = true;
+    }
+  }
+}
+
+static bool IsRamPageEq(const uint8 *mine, const uint8 *theirs, const uint8 *mask) {
+  uint64 diff = 0;
+  for (int i = 0; i < 256; i += 8)
+    diff |= (*(uint64 *)&mine[i] ^ *(uint64 *)&theirs[i]) & *(uint64 *)&mask[i];
+  return diff == 0;
+}
+
+static bool IsRamEq(const uint8 *mine, const uint8 *theirs) {
+  for (size_t i = 0; i < 0x20000; i += 256) {
+    if (g_verify_ram_page_masked[i >> 8] ? !IsRamPageEq(mine + i, theirs + i, g_verify_ram_mask + i) :
+                                           memcmp(mine + i, theirs + i, 256) != 0)
+      return false;
+  }
+  return true;
+}
+
 static void VerifySnapshotsEq(Snapshot *b, Snapshot *a, Snapshot *prev) {
-  memcpy(&b->ram[0x0], &a->ram[0x0], 0x51);  // r18, r20, R22 etc
-  memcpy(&b->ram[0x1f5b], &a->ram[0x1f5b], 0x100 - 0x5b);  // stacck
-  memcpy(&b->ram[0xad], &a->ram[0xad], 4);  // ptr_to_retaddr_parameters etc 
-  memcpy(&b->ram[0x5e7], &a->ram[0x5e7], 14);  // bitmask, mult_tmp, mult_product_lo etc
-
-  memcpy(&b->ram[0x5BC], &a->ram[0x5BC], 9);  // door_transition_vram_update etc
-  memcpy(&a->ram[0x60B], &b->ram[0x60B], 6);  // eproj_init_param_2, remaining_enemy_hitbox_entries, REMOVED_num_projectiles_to_check_enemy_coll
-  memcpy(&a->ram[0x611], &b->ram[0x611], 6);  // coroutine_state (copy from mine to theirs)
-  memcpy(&b->ram[0x641], &a->ram[0x641], 2);  // apu_attempts_countdown
-  memcpy(&a->ram[0x77e], &b->ram[0x77e], 5);  // my counter
-  memcpy(&a->ram[0x78F], &b->ram[0x78F], 2);  // door_bts
-  
-  memcpy(&a->ram[0x7b7], &b->ram[0x7b7], 2);  // event_pointer
-  memcpy(&a->ram[0x933], &b->ram[0x933], 10);  // var933 etc
-  memcpy(&b->ram[0xA82], &a->ram[0xA82], 2);  // xray_angle
-  memcpy(&b->ram[0xB24], &a->ram[0xB24], 4);  // xray_angle
-  memcpy(&a->ram[0xd1e], &b->ram[0xd1e], 2);  // grapple_beam_unkD1E
-  memcpy(&a->ram[0xd82], &b->ram[0xd82], 8);  // grapple_beam_tmpD82
-
-  memcpy(&a->ram[0xd9c], &b->ram[0xd9c], 2);  // grapple_beam_tmpD82
-  memcpy(&a->ram[0xdd2], &b->ram[0xdd2], 6);  // temp_collision_DD2 etc
-  memcpy(&a->ram[0xd8a], &b->ram[0xd8a], 6);  // grapple_beam_tmpD8A
-  memcpy(&a->ram[0xe20], &b->ram[0xe20], 0xe46 - 0xe20);  // temp vars
-  memcpy(&a->ram[0xe54], &b->ram[0xe54], 2);  // cur_enemy_index
-  
-  memcpy(&a->ram[0xe02], &b->ram[0xe02], 2);  // samus_bottom_boundary_position
-  memcpy(&a->ram[0xe4a], &b->ram[0xe4a], 2);  // new_enemy_index
-  memcpy(&a->ram[0xe56], &b->ram[0xe56], 4);  // REMOVED_cur_enemy_index_backup etc
-  
-  
-  memcpy(&a->ram[0x1784], &b->ram[0x1784], 8);  // enemy_ai_pointer etc
-  memcpy(&a->ram[0x1790], &b->ram[0x1790], 4);  // set_to_rtl_when_loading_enemies_unused etc
-  memcpy(&a->ram[0x17a8], &b->ram[0x17a8], 4);  // interactive_enemy_indexes_index
-  
-  memcpy(&a->ram[0x1834], &b->ram[0x1834], 8);  // distance_to_enemy_colliding_dirs
-  memcpy(&a->ram[0x184A], &b->ram[0x184A], 18);  // samus_x_pos_colliding_solid etc
-  memcpy(&a->ram[0x186E], &b->ram[0x186E], 16+8);  // REMOVED_enemy_spritemap_entry_pointer etc
-  memcpy(&a->ram[0x18A6], &b->ram[0x18A6], 2);  // collision_detection_index
-  memcpy(&a->ram[0x189A], &b->ram[0x189A], 12);  // samus_target_x_pos etc
-  
-  memcpy(&b->ram[0x1966], &a->ram[0x1966], 6);  // current_fx_entry_offset etc
-  memcpy(&b->ram[0x1993], &a->ram[0x1993], 2);  // eproj_init_param
-  memcpy(&b->ram[0x19b3], &a->ram[0x19b3], 2);  // mode7_spawn_param
-  memcpy(&b->ram[0x1a93], &a->ram[0x1a93], 2);  // cinematic_spawn_param
-  memcpy(&b->ram[0x1B9D], &a->ram[0x1B9D], 2);  // cinematic_spawn_param
-  memcpy(&a->ram[0x1E77], &b->ram[0x1E77], 2);  // current_slope_bts
-
-  memcpy(&a->ram[0x9100], &b->ram[0x9100], 0x1cc + 2);  // XrayHdmaFunc has some bug that i couldn't fix in asm
-  memcpy(&a->ram[0x9800], &b->ram[0x9800], 0x1cc+2);  // XrayHdmaFunc has some bug that i couldn't fix in asm
-  memcpy(&a->ram[0x99cc], &b->ram[0x99cc], 2);  // XrayHdmaFunc_BeamAimedL writes outside
-  memcpy(&a->ram[0xEF74], &b->ram[0xEF74], 4);  // next_enemy_tiles_index
-  memcpy(&a->ram[0xF37A], &b->ram[0xF37A], 6);  // word_7EF37A etc
+  for (size_t i = 0; i < countof(kVerifyKeepMineVars); i++)
+    memcpy(&a->ram[kVerifyKeepMineVars[i].addr], &b->ram[kVerifyKeepMineVars[i].addr], kVerifyKeepMineVars[i].size);
 
   // Compare all memory regions and report differences
-  CompareByteRegion("Memory", b->ram, a->ram, prev->ram, 0x20000, 256);
-  CompareByteRegion("SRAM", b->sram, a->sram, prev->sram, 0x2000, 128);
-#if 1
-  CompareWordRegion("VRAM", b->vram, a->vram, prev->vram, 0x8000, 32);
+  if (!IsRamEq(b->ram, a->ram))
+    CompareByteRegion("Memory", b->ram, a->ram, prev->ram, g_verify_ram_mask, 0x20000, 256);
+  CompareByteRegion("SRAM", b->sram, a->sram, prev->sram, NULL, 0x2000, 128);
   CompareWordRegion("VRAM OAM", b->oam, a->oam, prev->oam, 0x120, 16);
-#endif
 }
 
+// Compare the vram pages that either version wrote to this frame
+static void CompareVram(Ppu *mine, Ppu *theirs, const uint16 *prev) {
+  int j = 0;
+  for (int page = 0; page < kPpuVramPages; page++) {
+    if (!PpuIsVramPageDirty(mine, page) && !PpuIsVramPageDirty(theirs, page))
+      continue;
+    size_t base = page * kPpuVramPageWords;
+    if (!memcmp(&mine->vram[base], &theirs->vram[base], kPpuVramPageWords * sizeof(uint16)))
+      continue;
+    if (j == 0)
+      LogError("@%d: VRAM compare failed (mine != theirs, prev):", snes_frame_counter);
+    g_fail = true;
+    for (size_t i = base; i < base + kPpuVramPageWords && j < 32; i++) {
+      if (theirs->vram[i] != mine->vram[i]) {
+        LogError("0x%.6X: %.4X != %.4X (%.4X)", (int)i, mine->vram[i], theirs->vram[i], prev[i]);
+        j++;
+      }
+    }
+  }
+}
+
+// Restore vram from the snapshot, either fully or only the pages written since
+// PpuClearVramDirty (the snapshot holds their backups).
+static void RestoreVram(Ppu *ppu, const Snapshot *s, bool only_dirty) {
+  if (!only_dirty) {
+    memcpy(ppu->vram, s->vram, sizeof(uint16) * 0x8000);
+    PpuInvalidateTileCache(ppu, 0, 0x8000);
+    return;
+  }
+  for (int page = 0; page < kPpuVramPages; page++) {
+    if (PpuIsVramPageDirty(ppu, page)) {
+      memcpy(&ppu->vram[page * kPpuVramPageWords], &s->vram[page * kPpuVramPageWords], kPpuVramPageWords * sizeof(uint16));
+      PpuInvalidateTileCache(ppu, page * kPpuVramPageWords, kPpuVramPageWords);
+    }
+  }
+}
+
+// Vram is not part of this, see RestoreVram.
 static void MakeSnapshot(Snapshot *s) {
   Cpu *c = g_cpu;
   s->a = c->a, s->x = c->x, s->y = c->y;
@@ -652,7 +741,6 @@ static void MakeSnapshot(Snapshot *s) {
   s->vTimer = g_snes->vTimer;
   memcpy(s->ram, g_snes->ram, 0x20000);
   memcpy(s->sram, g_snes->cart->ram, g_snes->cart->ramSize);
-  memcpy(s->vram, g_snes->ppu->vram, sizeof(uint16) * 0x8000);
   memcpy(s->oam, g_snes->ppu->oam, sizeof(uint16) * 0x120);
 }
 
@@ -672,7 +760,6 @@ static void RestoreSnapshot(Snapshot *s) {
   cpu_setFlags(c, s->flags);
   memcpy(g_snes->ram, s->ram, 0x20000);
   memcpy(g_snes->cart->ram, s->sram, 0x2000);
-  memcpy(g_snes->ppu->vram, s->vram, sizeof(uint16) * 0x8000);
   memcpy(g_snes->ppu->oam, s->oam, sizeof(uint16) * 0x120);
 }
 
@@ -709,10 +796,8 @@ int RunAsmCode(uint32 pc, uint16 a, uint16 x, uint16 y, int flags) {
     while (g_snes->dma->dmaBusy)
       dma_doDma(g_snes->dma);
 
-    if (flags & 1) {
-      for(int i = 0; i < 10; i++)
-        apu_cycle(g_snes->apu);
-    }
+    if (flags & 1)
+      apu_runCycles(g_snes->apu, 10);
   }
   g_cpu->dp = org_dp;
   g_cpu->sp = org_sp;
@@ -778,6 +863,7 @@ Snes *SnesInit(const char *filename) {
   g_rom = g_snes->cart->rom;
 
   RtlSetupEmuCallbacks(NULL, &RtlRunFrameCompare, NULL);
+  InitVerifyRamMask();
 
   // Ensure it will run reset first.
   coroutine_state_0 = 1;
@@ -1030,12 +1116,55 @@ void SaveBugSnapshot() {
   g_game_ctx.got_mismatch_count = kBugCountdownFrames;
 }
 
+static bool ShouldVerifyFrame(void) {
+  // The emulated cpu can only start verifying at the top of the main loop,
+  // and once inside a multi-frame routine it must see every frame of it.
+  if (coroutine_state_0 != 0)
+    return g_emulated_cpu_synced;
+  g_emulated_cpu_synced = true;
+
+  // Door transitions (hit door block, loading next room)
+  if (g_config.verify_transitions && game_state >= 9 && game_state <= 11)
+    g_verify_transition_frames = kVerifyTransitionTailFrames;
+  if (g_verify_transition_frames != 0) {
+    g_verify_transition_frames--;
+    return true;
+  }
+  return g_config.verify_interval != 0 && (uint32)snes_frame_counter % g_config.verify_interval == 0;
+}
+
 void RunOneFrameOfGame_Both(void) {
-  g_snes->ppu = g_snes->snes_ppu;
+  if (!ShouldVerifyFrame()) {
+    // Only run my version, the emulated cpu stays parked in the main loop.
+    g_snes->ppu = g_snes->snes_ppu;
+    g_snes->runningWhichVersion = 0xff;
+    RunOneFrameOfGame();
+    RtlPerfMark(kRtlPerf_GameLogic);
+    DrawFrameToPpu();
+    RtlPerfMark(kRtlPerf_DrawPpu);
+    g_emulated_cpu_synced = (coroutine_state_0 == 0);
+    g_my_ppu_stale = true;
+    goto getout;
+  }
+  if (g_my_ppu_stale) {
+    ppu_copy(g_snes->my_ppu, g_snes->snes_ppu);
+    g_my_ppu_stale = false;
+  }
+
+  Ppu *theirs_ppu = g_snes->snes_ppu, *mine_ppu = g_snes->my_ppu;
+  // When both vrams are known to be identical, the pages are backed up into
+  // the before snapshot on their first write and only those get compared
+  // and restored. Otherwise take a full copy.
+  bool vram_synced = theirs_ppu->vramSerial == g_synced_vram_serial[0] &&
+                     mine_ppu->vramSerial == g_synced_vram_serial[1];
+  g_snes->ppu = theirs_ppu;
   MakeSnapshot(&g_snapshot_before);
+  if (!vram_synced)
+    memcpy(g_snapshot_before.vram, theirs_ppu->vram, sizeof(uint16) * 0x8000);
 
   // Run orig version then snapshot
 again_theirs:
+  PpuClearVramDirty(theirs_ppu, g_snapshot_before.vram);
   g_snes->runningWhichVersion = 1;
   RunOneFrameOfGame_Emulated();
   DrawFrameToPpu();
@@ -1043,26 +1172,34 @@ again_theirs:
 
   // Run my version and snapshot
 //again_mine:
-  g_snes->ppu = g_snes->my_ppu;
+  g_snes->ppu = mine_ppu;
   RestoreSnapshot(&g_snapshot_before);
+  RestoreVram(mine_ppu, &g_snapshot_before, vram_synced);
+  PpuClearVramDirty(mine_ppu, g_snapshot_before.vram);
+  RtlPerfMark(kRtlPerf_Verify);
 
   g_snes->runningWhichVersion = 2;
   RunOneFrameOfGame();
+  RtlPerfMark(kRtlPerf_GameLogic);
   DrawFrameToPpu();
+  RtlPerfMark(kRtlPerf_DrawPpu);
   MakeSnapshot(&g_snapshot_mine);
 
   g_snes->runningWhichVersion = 0xff;
 
   // Compare both snapshots
   VerifySnapshotsEq(&g_snapshot_mine, &g_snapshot_theirs, &g_snapshot_before);
+  CompareVram(mine_ppu, theirs_ppu, g_snapshot_before.vram);
 
   if (g_fail) {
     g_fail = false;
 
     printf("Verify failure!\n");
 
-    g_snes->ppu = g_snes->snes_ppu;
+    g_snes->ppu = theirs_ppu;
     RestoreSnapshot(&g_snapshot_before);
+    RestoreVram(theirs_ppu, &g_snapshot_before, true);
+    g_synced_vram_serial[0] = 0;
 
     if (g_game_ctx.emulator_debug_flag)
       goto again_theirs;
@@ -1072,9 +1209,14 @@ again_theirs:
     goto getout;
   }
 
-  g_snes->ppu = g_snes->snes_ppu;
+  g_snes->ppu = theirs_ppu;
   RestoreSnapshot(&g_snapshot_theirs);
+  g_synced_vram_serial[0] = theirs_ppu->vramSerial;
+  g_synced_vram_serial[1] = mine_ppu->vramSerial;
 getout:
+  PpuClearVramDirty(g_snes->snes_ppu, NULL);
+  PpuClearVramDirty(g_snes->my_ppu, NULL);
+  RtlPerfMark(kRtlPerf_Verify);
   g_snes->ppu = g_game_ctx.other_image ? g_snes->my_ppu : g_snes->snes_ppu;
   g_snes->runningWhichVersion = 0;
 
@@ -1162,14 +1304,18 @@ void RtlRunFrameCompare(uint16 input, int run_what) {
 
   if (g_runmode == RM_THEIRS) {
     RunOneFrameOfGame_Emulated();
+    RtlPerfMark(kRtlPerf_GameLogic);
     DrawFrameToPpu();
+    RtlPerfMark(kRtlPerf_DrawPpu);
 
   } else if (g_runmode == RM_MINE) {
     g_use_my_apu_code = true;
 
     g_snes->runningWhichVersion = 0xff;
     RunOneFrameOfGame();
+    RtlPerfMark(kRtlPerf_GameLogic);
     DrawFrameToPpu();
+    RtlPerfMark(kRtlPerf_DrawPpu);
     g_snes->runningWhichVersion = 0;
   } else {
     g_use_my_apu_code = true;
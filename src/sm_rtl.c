@@ -6,6 +6,8 @@
 #include "funcs.h"
 #include "spc_player.h"
 #include "util.h"
+#include "audio_capture.h"
+#include "asset_prefetch.h"
 
 struct StateRecorder;
 
@@ -20,6 +22,17 @@ static uint8 *g_rtl_memory_ptr;
 static RunFrameFunc *g_rtl_runframe;
 static SyncAllFunc *g_rtl_syncall;
 
+RtlPerfStats g_rtl_perf;
+
+// Attribute the time since the previous mark to |phase|.
+void RtlPerfMark(int phase) {
+  if (!g_rtl_perf.enabled)
+    return;
+  uint64 now = RtlGetPerfCounter();
+  g_rtl_perf.ticks[phase] += now - g_rtl_perf.last;
+  g_rtl_perf.last = now;
+}
+
 void RtlSetupEmuCallbacks(uint8 *emu_ram, RunFrameFunc *func, SyncAllFunc *sync_all) {
   g_rtl_memory_ptr = emu_ram;
   g_rtl_runframe = func;
@@ -386,6 +399,10 @@ void RtlStopReplay(void) {
   StateRecorder_StopReplay(&state_recorder);
 }
 
+bool RtlIsReplaying(void) {
+  return state_recorder.replay_mode;
+}
+
 enum {
   // Version was bumped to 1 after I fixed bug #1
   kCurrentBugFixCounter = 1,
@@ -423,11 +440,13 @@ bool RtlRunFrame(int inputs) {
   if (bug_fix_counter != currently_installed_bug_fix_counter)
     RtlUpdateSnesPatchForBugfix();
 
+  RtlPerfMark(kRtlPerf_Other);
   g_rtl_runframe(inputs, 0);
 
   snes_frame_counter++;
 
   RtlPushApuState();
+  RtlPerfMark(kRtlPerf_Other);
   return is_replay;
 }
 
@@ -445,6 +464,34 @@ static const char *const kBugSaves[] = {
   "Before Golden Torizo", "After Crocomire", "Baby Metroid", "Tourian Statue", "Before Ridley", "Enter Mother Brain",
 };
 
+bool RtlLoadSnapshot(const char *filename, bool replay) {
+  FILE *f = fopen(filename, "rb");
+  if (f == NULL) {
+    printf("Failed fopen: %s\n", filename);
+    return false;
+  }
+  RtlApuLock();
+  StateRecorder_Load(&state_recorder, f, replay);
+  ppu_copy(g_snes->my_ppu, g_snes->ppu);
+  RtlApuUnlock();
+  RtlSynchronizeWholeState();
+  fclose(f);
+
+  if (coroutine_state_0 | coroutine_state_1 | coroutine_state_2 | coroutine_state_3 | coroutine_state_4) {
+    printf("Coroutine state: %d, %d, %d, %d, %d\n",
+      coroutine_state_0, coroutine_state_1, coroutine_state_2, coroutine_state_3, coroutine_state_4);
+  }
+
+  // Earlier versions used coroutine_state_0 differently
+  if (coroutine_state_0 == 4)
+    coroutine_state_0 = 10 + game_state;
+
+  // bug_fix_counter_BAD didn't actually belong to free ram...
+  if (bug_fix_counter == 0)
+    bug_fix_counter = bug_fix_counter_BAD;
+  return true;
+}
+
 void RtlSaveLoad(int cmd, int slot) {
   char name[128];
   if (slot >= 256) {
@@ -458,32 +505,7 @@ void RtlSaveLoad(int cmd, int slot) {
   printf("*** %s slot %d\n",
     cmd == kSaveLoad_Save ? "Saving" : cmd == kSaveLoad_Load ? "Loading" : "Replaying", slot);
   if (cmd != kSaveLoad_Save) {
-
-    FILE *f = fopen(name, "rb");
-    if (f == NULL) {
-      printf("Failed fopen: %s\n", name);
-      return;
-    }
-    RtlApuLock();
-    StateRecorder_Load(&state_recorder, f, cmd == kSaveLoad_Replay);
-    ppu_copy(g_snes->my_ppu, g_snes->ppu);
-    RtlApuUnlock();
-    RtlSynchronizeWholeState();
-    fclose(f);
-
-    if (coroutine_state_0 | coroutine_state_1 | coroutine_state_2 | coroutine_state_3 | coroutine_state_4) {
-      printf("Coroutine state: %d, %d, %d, %d, %d\n",
-        coroutine_state_0, coroutine_state_1, coroutine_state_2, coroutine_state_3, coroutine_state_4);
-    }
-
-    // Earlier versions used coroutine_state_0 differently
-    if (coroutine_state_0 == 4)
-      coroutine_state_0 = 10 + game_state;
-
-    // bug_fix_counter_BAD didn't actually belong to free ram...
-    if (bug_fix_counter == 0)
-      bug_fix_counter = bug_fix_counter_BAD;
-
+    RtlLoadSnapshot(name, cmd == kSaveLoad_Replay);
   } else {
     RtlSaveSnapshot(name, false);
   }
@@ -554,6 +576,159 @@ void WriteRegWord(uint16 reg, uint16 value) {
   WriteReg(reg + 1, value >> 8);
 }
 
+const uint8 *RtlReadBus(uint32 addr, uint32 len) {
+  static uint8 buf[0x10000];
+  uint8 *const *map = g_snes->readMap;
+  uint32 page = addr & ~0xfff;
+  const uint8 *p = map[page >> 12];
+  if (p != NULL && (addr & 0xffff) + len <= 0x10000) {
+    uint32 a = page + 0x1000;
+    while (a < addr + len && map[a >> 12] == p + (a - page))
+      a += 0x1000;
+    if (a >= addr + len)
+      return p + (addr & 0xfff);
+  }
+  for (uint32 i = 0; i < len; i++)
+    buf[i] = snes_read(g_snes, (addr & 0xff0000) | ((addr + i) & 0xffff));
+  return buf;
+}
+
+static const uint8 kVramDataPorts[4] = { 0x18, 0x19, 0x18, 0x19 };
+
+void PpuVramWrite(uint16 dst, const uint8 *src, uint32 len, uint8 vmain) {
+  Ppu *ppu = g_snes->ppu;
+  ppu_write(ppu, 0x15, vmain);
+  ppu_write(ppu, 0x16, (uint8)dst);
+  ppu_write(ppu, 0x17, dst >> 8);
+  ppu_writeDma(ppu, kVramDataPorts, 0, src, len);
+}
+
+void PpuVramRead(uint16 src, uint8 *dst, uint32 len) {
+  Ppu *ppu = g_snes->ppu;
+  ppu_write(ppu, 0x16, (uint8)src);
+  ppu_write(ppu, 0x17, src >> 8);
+  for (uint32 i = 0; i < len; i++)
+    dst[i] = ppu_read(ppu, 0x39 + (i & 1));
+}
+
+void PpuCgramWrite(uint8 dst, const uint8 *src, uint32 len) {
+  static const uint8 kPorts[4] = { 0x22, 0x22, 0x22, 0x22 };
+  Ppu *ppu = g_snes->ppu;
+  ppu_write(ppu, 0x21, dst);
+  ppu_writeDma(ppu, kPorts, 0, src, len);
+}
+
+void PpuOamWrite(uint16 dst, const uint8 *src, uint32 len) {
+  static const uint8 kPorts[4] = { 0x04, 0x04, 0x04, 0x04 };
+  Ppu *ppu = g_snes->ppu;
+  ppu_write(ppu, 0x02, (uint8)dst);
+  ppu_write(ppu, 0x03, dst >> 8);
+  ppu_writeDma(ppu, kPorts, 0, src, len);
+}
+
+uint8 *PpuGetVramBytes(void) {
+  return (uint8 *)g_snes->ppu->vram;
+}
+
+void PpuPrepareVramBytes(uint32 adr, uint32 len) {
+  if (len)
+    PpuPrepareVramWrite(g_snes->ppu, (adr & 0xffff) >> 1, (((adr & 0xffff) + len - 1) >> 1) - ((adr & 0xffff) >> 1) + 1);
+}
+
+void PpuSetVramPointer(uint16 pointer) {
+  g_snes->ppu->vramPointer = pointer;
+}
+
+void PpuSetVramReadLatch(uint16 read_buffer, uint8 open_bus) {
+  g_snes->ppu->vramReadBuffer = read_buffer;
+  g_snes->ppu->ppu1openBus = open_bus;
+}
+
+// Decompressed rom data, keyed by its rom address. The rom doesn't change so
+// entries stay valid until the least recently used ones are dropped to stay
+// under the budget.
+typedef struct DecompCacheEnt {
+  uint32 src;
+  uint32 size;
+  uint32 last_use;
+  uint8 *data;
+} DecompCacheEnt;
+
+static struct {
+  DecompCacheEnt *ents;
+  int count, capacity;
+  uint32 budget, used, use_counter;
+  uint8 *taken;
+} g_decomp_cache;
+
+void RtlSetDecompCacheSize(uint32 bytes) {
+  g_decomp_cache.budget = bytes;
+  for (int i = 0; i < g_decomp_cache.count; i++)
+    free(g_decomp_cache.ents[i].data);
+  g_decomp_cache.count = 0;
+  g_decomp_cache.used = 0;
+}
+
+const uint8 *RtlDecompCacheFind(uint32 src, uint32 *size) {
+  for (int i = 0; i < g_decomp_cache.count; i++) {
+    DecompCacheEnt *e = &g_decomp_cache.ents[i];
+    if (e->src == src) {
+      e->last_use = ++g_decomp_cache.use_counter;
+      *size = e->size;
+      return e->data;
+    }
+  }
+  // Output the prefetcher decoded ahead of time moves into the cache. It is
+  // also kept here until the next lookup, for when the cache is off or full.
+  free(g_decomp_cache.taken);
+  g_decomp_cache.taken = NULL;
+  if (g_asset_prefetch && (g_decomp_cache.taken = AssetPrefetch_Take(g_asset_prefetch, src, size)) != NULL) {
+    RtlDecompCacheAdd(src, g_decomp_cache.taken, *size);
+    return g_decomp_cache.taken;
+  }
+  return NULL;
+}
+
+void RtlDecompCacheAdd(uint32 src, const uint8 *data, uint32 size) {
+  if (size > g_decomp_cache.budget)
+    return;
+  while (g_decomp_cache.used + size > g_decomp_cache.budget) {
+    int oldest = 0;
+    for (int i = 1; i < g_decomp_cache.count; i++)
+      if (g_decomp_cache.ents[i].last_use < g_decomp_cache.ents[oldest].last_use)
+        oldest = i;
+    g_decomp_cache.used -= g_decomp_cache.ents[oldest].size;
+    free(g_decomp_cache.ents[oldest].data);
+    g_decomp_cache.ents[oldest] = g_decomp_cache.ents[--g_decomp_cache.count];
+  }
+  if (g_decomp_cache.count == g_decomp_cache.capacity) {
+    g_decomp_cache.capacity = g_decomp_cache.capacity ? g_decomp_cache.capacity * 2 : 64;
+    g_decomp_cache.ents = xrealloc(g_decomp_cache.ents, g_decomp_cache.capacity * sizeof(DecompCacheEnt));
+  }
+  DecompCacheEnt *e = &g_decomp_cache.ents[g_decomp_cache.count++];
+  e->src = src;
+  e->size = size;
+  e->last_use = ++g_decomp_cache.use_counter;
+  e->data = xmalloc(size ? size : 1);
+  memcpy(e->data, data, size);
+  g_decomp_cache.used += size;
+}
+
+void RtlPrefetchAssets(const uint32 *srcs, int n) {
+  if (g_asset_prefetch == NULL)
+    return;
+  uint32 missing[kAssetPrefetch_MaxEntries];
+  int num_missing = 0;
+  for (int i = 0; i < n && num_missing < kAssetPrefetch_MaxEntries; i++) {
+    int j = 0;
+    while (j < g_decomp_cache.count && g_decomp_cache.ents[j].src != srcs[i])
+      j++;
+    if (j == g_decomp_cache.count)
+      missing[num_missing++] = srcs[i];
+  }
+  AssetPrefetch_Request(g_asset_prefetch, missing, num_missing);
+}
+
 // Maintain a queue cause the snes and audio callback are not in sync.
 // If an entry is 255, it means unset.
 typedef struct ApuWriteEnt {
@@ -564,8 +739,21 @@ enum {
   kApuMaxQueueSize = 16,
 };
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AtomicLoadAcquire(p) ((uint32)_InterlockedOr((volatile long *)(p), 0))
+#define AtomicStoreRelease(p, v) _InterlockedExchange((volatile long *)(p), (long)(v))
+#else
+#define AtomicLoadAcquire(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define AtomicStoreRelease(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+// The game thread is the only one advancing g_apu_queue_write and the audio
+// callback the only one advancing g_apu_queue_read, so pushing a frame doesn't
+// need the apu lock. Resetting the queue still does.
 static struct ApuWriteEnt g_apu_write_ents[kApuMaxQueueSize], g_apu_write;
-static uint8 g_apu_write_ent_pos, g_apu_queue_size, g_apu_time_since_empty;
+static uint32 g_apu_queue_write, g_apu_queue_read;
+static uint8 g_apu_time_since_empty;
 
 void RtlApuWrite(uint32 adr, uint8 val) {
   assert(adr >= APUI00 && adr <= APUI03);
@@ -586,54 +774,49 @@ static bool IsFrameEmpty(ApuWriteEnt *w) {
 }
 
 void RtlPushApuState(void) {
-  RtlApuLock();
-  if (!is_uploading_apu) {
-    // Strive for the queue to be empty.
-    if (g_apu_queue_size == 0) {
-        g_apu_time_since_empty = 0;
-    } else {
-      if (g_apu_time_since_empty >= 32 && IsFrameEmpty(&g_apu_write)) {
-        g_apu_time_since_empty -= 4;
-        RtlApuUnlock();
-        return;
-      }
-      g_apu_time_since_empty++;
-    }
-
-    // Merge the two oldest to make space
-    ApuWriteEnt *w0 = &g_apu_write_ents[g_apu_write_ent_pos++ & (kApuMaxQueueSize - 1)];
-    if (g_apu_queue_size == kApuMaxQueueSize) {
-      ApuWriteEnt *w1 = &g_apu_write_ents[g_apu_write_ent_pos & (kApuMaxQueueSize - 1)];
-      for (int i = 0; i < 4; i++)
-        if (w1->ports[i] == 255)
-          w1->ports[i] = w0->ports[i];
-    } else {
-      g_apu_queue_size++;
-    }
-    *w0 = g_apu_write;
-    memset(&g_apu_write, 0xff, sizeof(g_apu_write));
+  // The audio side drops the queue while uploading
+  if (is_uploading_apu)
+    return;
+  uint32 pos = g_apu_queue_write;
+  uint32 size = pos - AtomicLoadAcquire(&g_apu_queue_read);
+  // Strive for the queue to be empty.
+  if (size == 0) {
+      g_apu_time_since_empty = 0;
   } else {
-    g_apu_queue_size = 0;
+    if (g_apu_time_since_empty >= 32 && IsFrameEmpty(&g_apu_write)) {
+      g_apu_time_since_empty -= 4;
+      return;
+    }
+    g_apu_time_since_empty++;
   }
-  RtlApuUnlock();
+  // When full, keep collecting into g_apu_write so newer writes replace older ones
+  if (size == kApuMaxQueueSize)
+    return;
+  g_apu_write_ents[pos & (kApuMaxQueueSize - 1)] = g_apu_write;
+  AtomicStoreRelease(&g_apu_queue_write, pos + 1);
+  memset(&g_apu_write, 0xff, sizeof(g_apu_write));
 }
 
 static void RtlPopApuState_Locked(void) {
-  if (is_uploading_apu)
+  uint32 pos = g_apu_queue_read;
+  if (is_uploading_apu) {
+    AtomicStoreRelease(&g_apu_queue_read, AtomicLoadAcquire(&g_apu_queue_write));
     return;
+  }
 
   uint8 *input_ports = g_use_my_apu_code ? g_spc_player->input_ports : g_snes->apu->inPorts;
-  if (g_apu_queue_size != 0) {
-    ApuWriteEnt *w = &g_apu_write_ents[(g_apu_write_ent_pos - g_apu_queue_size--) & (kApuMaxQueueSize - 1)];
+  if (pos != AtomicLoadAcquire(&g_apu_queue_write)) {
+    ApuWriteEnt *w = &g_apu_write_ents[pos & (kApuMaxQueueSize - 1)];
     for (int i = 0; i != 4; i++) {
       if (w->ports[i] != 255)
         input_ports[i] = w->ports[i];
     }
+    AtomicStoreRelease(&g_apu_queue_read, pos + 1);
   }
 }
 
 static void RtlResetApuQueue(void) {
-  g_apu_write_ent_pos = g_apu_time_since_empty = g_apu_queue_size = 0;
+  g_apu_queue_write = g_apu_queue_read = g_apu_time_since_empty = 0;
   memset(&g_apu_write, 0xff, sizeof(g_apu_write));
 }
 
@@ -662,8 +845,8 @@ void RtlSaveMusicStateToRam_Locked(void) {
   if (g_use_my_apu_code) {
     // Apply the whole contents of the queue to input ports
     SpcPlayer *spc_player = g_spc_player;
-    for (int i = g_apu_queue_size; i; i--) {
-      ApuWriteEnt *we = &g_apu_write_ents[(g_apu_write_ent_pos - i) & (kApuMaxQueueSize - 1)];
+    for (uint32 i = g_apu_queue_read; i != g_apu_queue_write; i++) {
+      ApuWriteEnt *we = &g_apu_write_ents[i & (kApuMaxQueueSize - 1)];
       for (int j = 0; j < 4; j++) {
         if (we->ports[j] != 255)
           spc_player->input_ports[j] = we->ports[j];
@@ -680,16 +863,24 @@ void RtlRenderAudio_Locked(int16 *audio_buffer, int samples, int channels) {
 
   RtlPopApuState_Locked();
 
+  Dsp *dsp = NULL;
   if (!g_use_my_apu_code) {
     if (!is_uploading_apu) {
+      // run up to and including the next cycle that makes a sample
       while (g_snes->apu->dsp->sampleOffset < 534)
-        apu_cycle(g_snes->apu);
-      dsp_getSamples(g_snes->apu->dsp, audio_buffer, samples);
+        apu_runCycles(g_snes->apu, ((0 - g_snes->apu->cycles) & 0x1f) + 1);
+      dsp = g_snes->apu->dsp;
     }
   } else {
     SpcPlayer_GenerateSamples(g_spc_player);
-    dsp_getSamples(g_spc_player->dsp, audio_buffer, samples);
+    dsp = g_spc_player->dsp;
+  }
+  if (dsp) {
+    if (g_audio_capture)
+      AudioCapture_Write(g_audio_capture, dsp->sampleBuffer, dsp->sampleOffset, snes_frame_counter);
+    dsp_getSamples(dsp, audio_buffer, samples);
   }
+  RtlPerfMark(kRtlPerf_Audio);
 }
 
 void RtlRenderAudio(int16 *audio_buffer, int samples, int channels) {
@@ -93,6 +93,40 @@ void WriteRegWord(uint16 reg, uint16 value);
 uint16 ReadRegWord(uint16 reg);
 uint8 ReadReg(uint16 reg);
 
+// Points at len bytes of the cpu bus at addr, wrapping inside the bank like a
+// dma. Anything that isn't one flat block of ram or rom is first copied out
+// through snes_read into a scratch buffer that the next call overwrites.
+const uint8 *RtlReadBus(uint32 addr, uint32 len);
+
+// Direct access to the ppu ports, without going through the bus. Each one
+// leaves the vram, cgram and oam and the ppu latches exactly like writing the
+// address registers and then a dma of len bytes through the data port(s)
+// would: VMAIN = vmain, VMADDL/H = dst and a mode 1 dma into VMDATAL/H;
+// VMADDL/H = src and a mode 1 dma out of RDVRAML/H; CGADD = dst and a dma into
+// CGDATA; OAMADDL/H = dst and a dma into OAMDATA.
+void PpuVramWrite(uint16 dst, const uint8 *src, uint32 len, uint8 vmain);
+void PpuVramRead(uint16 src, uint8 *dst, uint32 len);
+void PpuCgramWrite(uint8 dst, const uint8 *src, uint32 len);
+void PpuOamWrite(uint16 dst, const uint8 *src, uint32 len);
+
+// For decoding straight into the vram. It is seen as 64k of little endian
+// bytes, and bytes [adr, adr + len) (wrapping around) have to be prepared
+// before they change. The latches are then set to what the equivalent port
+// accesses would have left in them.
+uint8 *PpuGetVramBytes(void);
+void PpuPrepareVramBytes(uint32 adr, uint32 len);
+void PpuSetVramPointer(uint16 pointer);
+void PpuSetVramReadLatch(uint16 read_buffer, uint8 open_bus);
+
+// Cache of DecompressToMem output, with a budget of |bytes| (0 = off).
+// Setting the size empties it.
+void RtlSetDecompCacheSize(uint32 bytes);
+const uint8 *RtlDecompCacheFind(uint32 src, uint32 *size);
+void RtlDecompCacheAdd(uint32 src, const uint8 *data, uint32 size);
+// Have the streams at srcs decoded in the background, for DecompressToMem
+// calls coming up soon. Streams that are already cached are skipped.
+void RtlPrefetchAssets(const uint32 *srcs, int n);
+
 typedef void RunFrameFunc(uint16 input, int run_what);
 typedef void SyncAllFunc();
 
@@ -107,7 +141,30 @@ enum {
   kSaveLoad_Replay = 3,
 };
 
+// Per-phase frame timing, used by the headless benchmark runner.
+enum {
+  kRtlPerf_Other,
+  kRtlPerf_GameLogic,
+  kRtlPerf_DrawPpu,
+  kRtlPerf_Audio,
+  kRtlPerf_Verify,
+  kRtlPerf_Count,
+};
+
+typedef struct RtlPerfStats {
+  bool enabled;
+  uint64 last;
+  uint64 ticks[kRtlPerf_Count];
+} RtlPerfStats;
+
+extern RtlPerfStats g_rtl_perf;
+
+uint64 RtlGetPerfCounter();
+void RtlPerfMark(int phase);
+
 void RtlSaveLoad(int cmd, int slot);
+bool RtlLoadSnapshot(const char *filename, bool replay);
+bool RtlIsReplaying();
 void RtlCheat(char c);
 void RtlApuLock();
 void RtlApuUnlock();
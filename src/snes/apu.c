@@ -96,6 +96,48 @@ void apu_cycle(Apu* apu) {
   apu->cycles++;
 }
 
+// Same as calling apu_cycle |cycles| times
+void apu_runCycles(Apu* apu, int cycles) {
+  if (g_debug_apu_cycles) {
+    while (cycles-- > 0)
+      apu_cycle(apu);
+    return;
+  }
+  // finish the opcode in progress
+  int n = cycles < apu->cpuCyclesLeft ? cycles : apu->cpuCyclesLeft;
+  apu_advance(apu, n);
+  apu->cpuCyclesLeft -= n;
+  if (cycles > n)
+    apu->cpuCyclesLeft = spc_runCycles(apu->spc, cycles - n);
+}
+
+// The dsp and timer part of apu_cycle for |cycles| cycles at once
+void apu_advance(Apu* apu, int cycles) {
+  // every 32 cycles
+  for(uint32_t c = (apu->cycles + 0x1f) & ~0x1f; c - apu->cycles < (uint32_t)cycles; c += 0x20) {
+    dsp_cycle(apu->dsp);
+  }
+  for(int i = 0; i < 3; i++) {
+    Timer* timer = &apu->timer[i];
+    int left = cycles;
+    while(left > timer->cycles) {
+      // counts down to 0, reloads on the next cycle
+      left -= timer->cycles + 1;
+      timer->cycles = (i == 2 ? 16 : 128) - 1;
+      if(timer->enabled) {
+        timer->divider++;
+        if(timer->divider == timer->target) {
+          timer->divider = 0;
+          timer->counter++;
+          timer->counter &= 0xf;
+        }
+      }
+    }
+    timer->cycles -= left;
+  }
+  apu->cycles += cycles;
+}
+
 uint8_t apu_cpuRead(Apu* apu, uint16_t adr) {
   switch(adr) {
     case 0xf0:
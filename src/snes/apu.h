@@ -46,6 +46,8 @@ Apu* apu_init();
 void apu_free(Apu* apu);
 void apu_reset(Apu* apu);
 void apu_cycle(Apu* apu);
+void apu_runCycles(Apu* apu, int cycles);
+void apu_advance(Apu* apu, int cycles);
 uint8_t apu_cpuRead(Apu* apu, uint16_t adr);
 void apu_cpuWrite(Apu* apu, uint16_t adr, uint8_t val);
 void apu_saveload(Apu *apu, SaveLoadFunc *func, void *ctx);
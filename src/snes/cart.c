@@ -12,6 +12,8 @@ static uint8_t cart_readLorom(Cart* cart, uint8_t bank, uint16_t adr);
 static void cart_writeLorom(Cart* cart, uint8_t bank, uint16_t adr, uint8_t val);
 static uint8_t cart_readHirom(Cart* cart, uint8_t bank, uint16_t adr);
 static void cart_writeHirom(Cart* cart, uint8_t bank, uint16_t adr, uint8_t val);
+static uint8_t* cart_getPageLorom(Cart* cart, uint8_t bank, uint16_t adr, bool write);
+static uint8_t* cart_getPageHirom(Cart* cart, uint8_t bank, uint16_t adr, bool write);
 
 Cart* cart_init(Snes* snes) {
   Cart* cart = xmalloc(sizeof(Cart));
@@ -72,6 +74,14 @@ void cart_write(Cart* cart, uint8_t bank, uint16_t adr, uint8_t val) {
   }
 }
 
+uint8_t* cart_getPage(Cart* cart, uint8_t bank, uint16_t adr, bool write) {
+  switch(cart->type) {
+    case 1: return cart_getPageLorom(cart, bank, adr, write);
+    case 2: return cart_getPageHirom(cart, bank, adr, write);
+  }
+  return NULL;
+}
+
 void DumpCpuHistory();
 
 static uint8_t cart_readLorom(Cart* cart, uint8_t bank, uint16_t adr) {
@@ -118,3 +128,31 @@ static void cart_writeHirom(Cart* cart, uint8_t bank, uint16_t adr, uint8_t val)
     cart->ram[(((bank & 0x3f) << 13) | (adr & 0x1fff)) & (cart->ramSize - 1)] = val;
   }
 }
+
+// same decoding as cart_readLorom / cart_writeLorom, for a whole 4 KB page
+static uint8_t* cart_getPageLorom(Cart* cart, uint8_t bank, uint16_t adr, bool write) {
+  if(((bank >= 0x70 && bank < 0x7e) || (write ? bank > 0xf0 : bank >= 0xf0)) && adr < 0x8000 && cart->ramSize > 0) {
+    // sram smaller than a page repeats inside it
+    if(cart->ramSize < 0x1000) return NULL;
+    return &cart->ram[(((bank & 0xf) << 15) | adr) & (cart->ramSize - 1)];
+  }
+  if(write) return NULL;
+  bank &= 0x7f;
+  if(adr >= 0x8000 || bank >= 0x40) {
+    return &cart->rom[((bank << 15) | (adr & 0x7fff)) & (cart->romSize - 1)];
+  }
+  return NULL;
+}
+
+static uint8_t* cart_getPageHirom(Cart* cart, uint8_t bank, uint16_t adr, bool write) {
+  bank &= 0x7f;
+  if(bank < 0x40 && adr >= 0x6000 && adr < 0x8000 && cart->ramSize > 0) {
+    if(cart->ramSize < 0x1000) return NULL;
+    return &cart->ram[(((bank & 0x3f) << 13) | (adr & 0x1fff)) & (cart->ramSize - 1)];
+  }
+  if(write) return NULL;
+  if(adr >= 0x8000 || bank >= 0x40) {
+    return &cart->rom[(((bank & 0x3f) << 16) | adr) & (cart->romSize - 1)];
+  }
+  return NULL;
+}
@@ -30,5 +30,8 @@ void cart_reset(Cart* cart); // will reset special chips etc, general reading is
 void cart_load(Cart* cart, int type, uint8_t* rom, int romSize, int ramSize); // TODO: figure out how to handle (battery, cart-chips etc)
 uint8_t cart_read(Cart* cart, uint8_t bank, uint16_t adr);
 void cart_write(Cart* cart, uint8_t bank, uint16_t adr, uint8_t val);
+// host memory behind the 4 KB page at bank:adr, NULL if it has to go through
+// cart_read / cart_write
+uint8_t* cart_getPage(Cart* cart, uint8_t bank, uint16_t adr, bool write);
 void cart_saveload(Cart *cart, SaveLoadFunc *func, void *ctx);
 #endif
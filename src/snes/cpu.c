@@ -44,19 +44,36 @@ static uint16_t cpu_readWord(Cpu* cpu, uint32_t adrl, uint32_t adrh);
 static void cpu_writeWord(Cpu* cpu, uint32_t adrl, uint32_t adrh, uint16_t value, bool reversed);
 static void cpu_doInterrupt(Cpu* cpu, bool irq);
 static void cpu_doOpcode(Cpu* cpu, uint8_t opcode);
+static void cpu_execute(Cpu* cpu, uint8_t opcode);
 
 extern Snes *g_snes; // for debugging
 
 // addressing modes and opcode functions not declared, only used after defintions
 
+// the page map covers wram, rom and sram, only registers take the long way
 static uint8_t cpu_read(Cpu* cpu, uint32_t adr) {
   // assume mem is a pointer to a Snes
-  return snes_cpuRead((Snes*) cpu->mem, adr);
+  Snes* snes = (Snes*) cpu->mem;
+  const uint8_t* page = snes->readMap[(adr >> 12) & 0xfff];
+  if(page) {
+    snes->cpuMemOps++;
+    snes->cpuCyclesLeft += 8;
+    return page[adr & 0xfff];
+  }
+  return snes_cpuRead(snes, adr);
 }
 
 static void cpu_write(Cpu* cpu, uint32_t adr, uint8_t val) {
   // assume mem is a pointer to a Snes
-  snes_cpuWrite((Snes*) cpu->mem, adr, val);
+  Snes* snes = (Snes*) cpu->mem;
+  uint8_t* page = snes->writeMap[(adr >> 12) & 0xfff];
+  if(page) {
+    snes->cpuMemOps++;
+    snes->cpuCyclesLeft += 8;
+    page[adr & 0xfff] = val;
+    return;
+  }
+  snes_cpuWrite(snes, adr, val);
 }
 
 Cpu* cpu_init(void* mem, int memType) {
@@ -235,8 +252,8 @@ static void cpu_doInterrupt(Cpu* cpu, bool irq) {
 
 // addressing modes
 
-static uint32_t cpu_adrImm(Cpu* cpu, uint32_t* low, bool xFlag) {
-  if((xFlag && cpu->xf) || (!xFlag && cpu->mf)) {
+static uint32_t cpu_adrImm(Cpu* cpu, uint32_t* low, bool byte) {
+  if(byte) {
     *low = (cpu->k << 16) | cpu->pc++;
     return 0;
   } else {
@@ -282,11 +299,11 @@ static uint32_t cpu_adrIdx(Cpu* cpu, uint32_t* low) {
   return ((cpu->db << 16) + pointer + 1) & 0xffffff;
 }
 
-static uint32_t cpu_adrIdy(Cpu* cpu, uint32_t* low, bool write) {
+static uint32_t cpu_adrIdy(Cpu* cpu, uint32_t* low, bool write, bool xf) {
   uint8_t adr = cpu_readOpcode(cpu);
   if(cpu->dp & 0xff) cpu->cyclesUsed++; // dpr not 0: 1 extra cycle
   uint16_t pointer = cpu_readWord(cpu, (cpu->dp + adr) & 0xffff, (cpu->dp + adr + 1) & 0xffff);
-  if(write && (!cpu->xf || ((pointer >> 8) != ((pointer + cpu->y) >> 8)))) cpu->cyclesUsed++;
+  if(write && (!xf || ((pointer >> 8) != ((pointer + cpu->y) >> 8)))) cpu->cyclesUsed++;
   // x = 0 or page crossed, with writing opcode: 1 extra cycle
   *low = ((cpu->db << 16) + pointer + cpu->y) & 0xffffff;
   return ((cpu->db << 16) + pointer + cpu->y + 1) & 0xffffff;
@@ -329,17 +346,17 @@ static uint32_t cpu_adrAbs(Cpu* cpu, uint32_t* low) {
   return ((cpu->db << 16) + adr + 1) & 0xffffff;
 }
 
-static uint32_t cpu_adrAbx(Cpu* cpu, uint32_t* low, bool write) {
+static uint32_t cpu_adrAbx(Cpu* cpu, uint32_t* low, bool write, bool xf) {
   uint16_t adr = cpu_readOpcodeWord(cpu);
-  if(write && (!cpu->xf || ((adr >> 8) != ((adr + cpu->x) >> 8)))) cpu->cyclesUsed++;
+  if(write && (!xf || ((adr >> 8) != ((adr + cpu->x) >> 8)))) cpu->cyclesUsed++;
   // x = 0 or page crossed, with writing opcode: 1 extra cycle
   *low = ((cpu->db << 16) + adr + cpu->x) & 0xffffff;
   return ((cpu->db << 16) + adr + cpu->x + 1) & 0xffffff;
 }
 
-static uint32_t cpu_adrAby(Cpu* cpu, uint32_t* low, bool write) {
+static uint32_t cpu_adrAby(Cpu* cpu, uint32_t* low, bool write, bool xf) {
   uint16_t adr = cpu_readOpcodeWord(cpu);
-  if(write && (!cpu->xf || ((adr >> 8) != ((adr + cpu->y) >> 8)))) cpu->cyclesUsed++;
+  if(write && (!xf || ((adr >> 8) != ((adr + cpu->y) >> 8)))) cpu->cyclesUsed++;
   // x = 0 or page crossed, with writing opcode: 1 extra cycle
   *low = ((cpu->db << 16) + adr + cpu->y) & 0xffffff;
   return ((cpu->db << 16) + adr + cpu->y + 1) & 0xffffff;
@@ -366,8 +383,8 @@ static uint16_t cpu_adrIax(Cpu* cpu) {
 
 // opcode functions
 
-static void cpu_and(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+static void cpu_and(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
+  if(mf) {
     uint8_t value = cpu_read(cpu, low);
     cpu->a = (cpu->a & 0xff00) | ((cpu->a & value) & 0xff);
   } else {
@@ -375,11 +392,11 @@ static void cpu_and(Cpu* cpu, uint32_t low, uint32_t high) {
     uint16_t value = cpu_readWord(cpu, low, high);
     cpu->a &= value;
   }
-  cpu_setZN(cpu, cpu->a, cpu->mf);
+  cpu_setZN(cpu, cpu->a, mf);
 }
 
-static void cpu_ora(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+static void cpu_ora(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
+  if(mf) {
     uint8_t value = cpu_read(cpu, low);
     cpu->a = (cpu->a & 0xff00) | ((cpu->a | value) & 0xff);
   } else {
@@ -387,11 +404,11 @@ static void cpu_ora(Cpu* cpu, uint32_t low, uint32_t high) {
     uint16_t value = cpu_readWord(cpu, low, high);
     cpu->a |= value;
   }
-  cpu_setZN(cpu, cpu->a, cpu->mf);
+  cpu_setZN(cpu, cpu->a, mf);
 }
 
-static void cpu_eor(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+static void cpu_eor(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
+  if(mf) {
     uint8_t value = cpu_read(cpu, low);
     cpu->a = (cpu->a & 0xff00) | ((cpu->a ^ value) & 0xff);
   } else {
@@ -399,11 +416,11 @@ static void cpu_eor(Cpu* cpu, uint32_t low, uint32_t high) {
     uint16_t value = cpu_readWord(cpu, low, high);
     cpu->a ^= value;
   }
-  cpu_setZN(cpu, cpu->a, cpu->mf);
+  cpu_setZN(cpu, cpu->a, mf);
 }
 
-static void cpu_adc(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+static void cpu_adc(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
+  if(mf) {
     uint8_t value = cpu_read(cpu, low);
     int result = 0;
     if(cpu->d) {
@@ -437,11 +454,11 @@ static void cpu_adc(Cpu* cpu, uint32_t low, uint32_t high) {
     cpu->c = result > 0xffff;
     cpu->a = result;
   }
-  cpu_setZN(cpu, cpu->a, cpu->mf);
+  cpu_setZN(cpu, cpu->a, mf);
 }
 
-static void cpu_sbc(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+static void cpu_sbc(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
+  if(mf) {
     uint8_t value = cpu_read(cpu, low) ^ 0xff;
     int result = 0;
     if(cpu->d) {
@@ -475,12 +492,12 @@ static void cpu_sbc(Cpu* cpu, uint32_t low, uint32_t high) {
     cpu->c = result > 0xffff;
     cpu->a = result;
   }
-  cpu_setZN(cpu, cpu->a, cpu->mf);
+  cpu_setZN(cpu, cpu->a, mf);
 }
 
-static void cpu_cmp(Cpu* cpu, uint32_t low, uint32_t high) {
+static void cpu_cmp(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
   int result = 0;
-  if(cpu->mf) {
+  if(mf) {
     uint8_t value = cpu_read(cpu, low) ^ 0xff;
     result = (cpu->a & 0xff) + value + 1;
     cpu->c = result > 0xff;
@@ -490,12 +507,12 @@ static void cpu_cmp(Cpu* cpu, uint32_t low, uint32_t high) {
     result = cpu->a + value + 1;
     cpu->c = result > 0xffff;
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, mf);
 }
 
-static void cpu_cpx(Cpu* cpu, uint32_t low, uint32_t high) {
+static void cpu_cpx(Cpu* cpu, uint32_t low, uint32_t high, bool xf) {
   int result = 0;
-  if(cpu->xf) {
+  if(xf) {
     uint8_t value = cpu_read(cpu, low) ^ 0xff;
     result = (cpu->x & 0xff) + value + 1;
     cpu->c = result > 0xff;
@@ -505,12 +522,12 @@ static void cpu_cpx(Cpu* cpu, uint32_t low, uint32_t high) {
     result = cpu->x + value + 1;
     cpu->c = result > 0xffff;
   }
-  cpu_setZN(cpu, result, cpu->xf);
+  cpu_setZN(cpu, result, xf);
 }
 
-static void cpu_cpy(Cpu* cpu, uint32_t low, uint32_t high) {
+static void cpu_cpy(Cpu* cpu, uint32_t low, uint32_t high, bool xf) {
   int result = 0;
-  if(cpu->xf) {
+  if(xf) {
     uint8_t value = cpu_read(cpu, low) ^ 0xff;
     result = (cpu->y & 0xff) + value + 1;
     cpu->c = result > 0xff;
@@ -520,11 +537,11 @@ static void cpu_cpy(Cpu* cpu, uint32_t low, uint32_t high) {
     result = cpu->y + value + 1;
     cpu->c = result > 0xffff;
   }
-  cpu_setZN(cpu, result, cpu->xf);
+  cpu_setZN(cpu, result, xf);
 }
 
-static void cpu_bit(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+static void cpu_bit(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
+  if(mf) {
     uint8_t value = cpu_read(cpu, low);
     uint8_t result = (cpu->a & 0xff) & value;
     cpu->z = result == 0;
@@ -540,38 +557,38 @@ static void cpu_bit(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
-static void cpu_lda(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+static void cpu_lda(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
+  if(mf) {
     cpu->a = (cpu->a & 0xff00) | cpu_read(cpu, low);
   } else {
     cpu->cyclesUsed++; // m = 0: 1 extra cycle
     cpu->a = cpu_readWord(cpu, low, high);
   }
-  cpu_setZN(cpu, cpu->a, cpu->mf);
+  cpu_setZN(cpu, cpu->a, mf);
 }
 
-static void cpu_ldx(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->xf) {
+static void cpu_ldx(Cpu* cpu, uint32_t low, uint32_t high, bool xf) {
+  if(xf) {
     cpu->x = cpu_read(cpu, low);
   } else {
     cpu->cyclesUsed++; // x = 0: 1 extra cycle
     cpu->x = cpu_readWord(cpu, low, high);
   }
-  cpu_setZN(cpu, cpu->x, cpu->xf);
+  cpu_setZN(cpu, cpu->x, xf);
 }
 
-static void cpu_ldy(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->xf) {
+static void cpu_ldy(Cpu* cpu, uint32_t low, uint32_t high, bool xf) {
+  if(xf) {
     cpu->y = cpu_read(cpu, low);
   } else {
     cpu->cyclesUsed++; // x = 0: 1 extra cycle
     cpu->y = cpu_readWord(cpu, low, high);
   }
-  cpu_setZN(cpu, cpu->y, cpu->xf);
+  cpu_setZN(cpu, cpu->y, xf);
 }
 
-static void cpu_sta(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+static void cpu_sta(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
+  if(mf) {
     cpu_write(cpu, low, (uint8_t)cpu->a);
   } else {
     cpu->cyclesUsed++; // m = 0: 1 extra cycle
@@ -579,8 +596,8 @@ static void cpu_sta(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
-static void cpu_stx(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->xf) {
+static void cpu_stx(Cpu* cpu, uint32_t low, uint32_t high, bool xf) {
+  if(xf) {
     cpu_write(cpu, low, (uint8_t)cpu->x);
   } else {
     cpu->cyclesUsed++; // x = 0: 1 extra cycle
@@ -588,8 +605,8 @@ static void cpu_stx(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
-static void cpu_sty(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->xf) {
+static void cpu_sty(Cpu* cpu, uint32_t low, uint32_t high, bool xf) {
+  if(xf) {
     cpu_write(cpu, low, (uint8_t)cpu->y);
   } else {
     cpu->cyclesUsed++; // x = 0: 1 extra cycle
@@ -597,8 +614,8 @@ static void cpu_sty(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
-static void cpu_stz(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+static void cpu_stz(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
+  if(mf) {
     cpu_write(cpu, low, 0);
   } else {
     cpu->cyclesUsed++; // m = 0: 1 extra cycle
@@ -606,10 +623,10 @@ static void cpu_stz(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
-static void cpu_ror(Cpu* cpu, uint32_t low, uint32_t high) {
+static void cpu_ror(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
   bool carry = false;
   int result = 0;
-  if(cpu->mf) {
+  if(mf) {
     uint8_t value = cpu_read(cpu, low);
     carry = value & 1;
     result = (value >> 1) | (cpu->c << 7);
@@ -621,13 +638,13 @@ static void cpu_ror(Cpu* cpu, uint32_t low, uint32_t high) {
     result = (value >> 1) | (cpu->c << 15);
     cpu_writeWord(cpu, low, high, result, true);
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, mf);
   cpu->c = carry;
 }
 
-static void cpu_rol(Cpu* cpu, uint32_t low, uint32_t high) {
+static void cpu_rol(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
   int result = 0;
-  if(cpu->mf) {
+  if(mf) {
     result = (cpu_read(cpu, low) << 1) | cpu->c;
     cpu->c = result & 0x100;
     cpu_write(cpu, low, result);
@@ -637,12 +654,12 @@ static void cpu_rol(Cpu* cpu, uint32_t low, uint32_t high) {
     cpu->c = result & 0x10000;
     cpu_writeWord(cpu, low, high, result, true);
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, mf);
 }
 
-static void cpu_lsr(Cpu* cpu, uint32_t low, uint32_t high) {
+static void cpu_lsr(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
   int result = 0;
-  if(cpu->mf) {
+  if(mf) {
     uint8_t value = cpu_read(cpu, low);
     cpu->c = value & 1;
     result = value >> 1;
@@ -654,12 +671,12 @@ static void cpu_lsr(Cpu* cpu, uint32_t low, uint32_t high) {
     result = value >> 1;
     cpu_writeWord(cpu, low, high, result, true);
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, mf);
 }
 
-static void cpu_asl(Cpu* cpu, uint32_t low, uint32_t high) {
+static void cpu_asl(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
   int result = 0;
-  if(cpu->mf) {
+  if(mf) {
     result = cpu_read(cpu, low) << 1;
     cpu->c = result & 0x100;
     cpu_write(cpu, low, result);
@@ -669,12 +686,12 @@ static void cpu_asl(Cpu* cpu, uint32_t low, uint32_t high) {
     cpu->c = result & 0x10000;
     cpu_writeWord(cpu, low, high, result, true);
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, mf);
 }
 
-static void cpu_inc(Cpu* cpu, uint32_t low, uint32_t high) {
+static void cpu_inc(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
   int result = 0;
-  if(cpu->mf) {
+  if(mf) {
     result = cpu_read(cpu, low) + 1;
     cpu_write(cpu, low, result);
   } else {
@@ -682,12 +699,12 @@ static void cpu_inc(Cpu* cpu, uint32_t low, uint32_t high) {
     result = cpu_readWord(cpu, low, high) + 1;
     cpu_writeWord(cpu, low, high, result, true);
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, mf);
 }
 
-static void cpu_dec(Cpu* cpu, uint32_t low, uint32_t high) {
+static void cpu_dec(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
   int result = 0;
-  if(cpu->mf) {
+  if(mf) {
     result = cpu_read(cpu, low) - 1;
     cpu_write(cpu, low, result);
   } else {
@@ -695,11 +712,11 @@ static void cpu_dec(Cpu* cpu, uint32_t low, uint32_t high) {
     result = cpu_readWord(cpu, low, high) - 1;
     cpu_writeWord(cpu, low, high, result, true);
   }
-  cpu_setZN(cpu, result, cpu->mf);
+  cpu_setZN(cpu, result, mf);
 }
 
-static void cpu_tsb(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+static void cpu_tsb(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
+  if(mf) {
     uint8_t value = cpu_read(cpu, low);
     cpu->z = ((cpu->a & 0xff) & value) == 0;
     cpu_write(cpu, low, value | (cpu->a & 0xff));
@@ -711,8 +728,8 @@ static void cpu_tsb(Cpu* cpu, uint32_t low, uint32_t high) {
   }
 }
 
-static void cpu_trb(Cpu* cpu, uint32_t low, uint32_t high) {
-  if(cpu->mf) {
+static void cpu_trb(Cpu* cpu, uint32_t low, uint32_t high, bool mf) {
+  if(mf) {
     uint8_t value = cpu_read(cpu, low);
     cpu->z = ((cpu->a & 0xff) & value) == 0;
     cpu_write(cpu, low, value & ~(cpu->a & 0xff));
@@ -745,8 +762,20 @@ static void cpu_doOpcode(Cpu* cpu, uint8_t opcode) {
   if (cur_pc == pc_bp) {
     opcode += 0;
   }
+  cpu_execute(cpu, opcode);
+}
 
-restart:
+#if defined(__GNUC__) || defined(__clang__)
+#define CPU_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define CPU_ALWAYS_INLINE FORCEINLINE
+#endif
+
+// The opcode switch, written once. mf and xf are constants in each of the
+// four copies below, which folds away the width checks in the instructions,
+// addressing modes and opcode functions. Only rep, sep, plp, rti and xce
+// change the flags, as their last action, so the next opcode picks the copy.
+static CPU_ALWAYS_INLINE void cpu_doOpcodeMX(Cpu* cpu, uint8_t opcode, bool mf, bool xf) {
   switch(opcode) {
     case 0x00: { // brk imp
       uint32_t addr = (cpu->k << 16) | cpu->pc | 0x800000;
@@ -762,22 +791,23 @@ restart:
         break;
       case 0xe5:
       case 0xe9:
-      case 0xed: cpu->c = 1; goto restart;
+      case 0xed: cpu->c = 1; cpu_execute(cpu, opcode); return;
       case 0x65:
       case 0x6d: 
       case 0x69:
       case 0x7d:
-      case 0x7f: cpu->c = 0; goto restart;
+      case 0x7f: cpu->c = 0; cpu_execute(cpu, opcode); return;
       default:
 //        printf("Unk op 0x%x!\n", opcode);
-        goto restart;
+        cpu_execute(cpu, opcode); // the hook may have changed m or x
+        return;
       }
       break;
     }
     case 0x01: { // ora idx
       uint32_t low = 0;
       uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_ora(cpu, low, high);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x02: { // cop imm(s)
@@ -795,31 +825,31 @@ restart:
     case 0x03: { // ora sr
       uint32_t low = 0;
       uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_ora(cpu, low, high);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x04: { // tsb dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_tsb(cpu, low, high);
+      cpu_tsb(cpu, low, high, mf);
       break;
     }
     case 0x05: { // ora dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_ora(cpu, low, high);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x06: { // asl dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_asl(cpu, low, high);
+      cpu_asl(cpu, low, high, mf);
       break;
     }
     case 0x07: { // ora idl
       uint32_t low = 0;
       uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_ora(cpu, low, high);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x08: { // php imp
@@ -828,19 +858,19 @@ restart:
     }
     case 0x09: { // ora imm(m)
       uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_ora(cpu, low, high);
+      uint32_t high = cpu_adrImm(cpu, &low, mf);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x0a: { // asla imp
-      if(cpu->mf) {
+      if(mf) {
         cpu->c = cpu->a & 0x80;
         cpu->a = (cpu->a & 0xff00) | ((cpu->a << 1) & 0xff);
       } else {
         cpu->c = cpu->a & 0x8000;
         cpu->a <<= 1;
       }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
+      cpu_setZN(cpu, cpu->a, mf);
       break;
     }
     case 0x0b: { // phd imp
@@ -850,25 +880,25 @@ restart:
     case 0x0c: { // tsb abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_tsb(cpu, low, high);
+      cpu_tsb(cpu, low, high, mf);
       break;
     }
     case 0x0d: { // ora abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_ora(cpu, low, high);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x0e: { // asl abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_asl(cpu, low, high);
+      cpu_asl(cpu, low, high, mf);
       break;
     }
     case 0x0f: { // ora abl
       uint32_t low = 0;
       uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_ora(cpu, low, high);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x10: { // bpl rel
@@ -877,44 +907,44 @@ restart:
     }
     case 0x11: { // ora idy(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_ora(cpu, low, high);
+      uint32_t high = cpu_adrIdy(cpu, &low, false, xf);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x12: { // ora idp
       uint32_t low = 0;
       uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_ora(cpu, low, high);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x13: { // ora isy
       uint32_t low = 0;
       uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_ora(cpu, low, high);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x14: { // trb dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_trb(cpu, low, high);
+      cpu_trb(cpu, low, high, mf);
       break;
     }
     case 0x15: { // ora dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_ora(cpu, low, high);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x16: { // asl dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_asl(cpu, low, high);
+      cpu_asl(cpu, low, high, mf);
       break;
     }
     case 0x17: { // ora ily
       uint32_t low = 0;
       uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_ora(cpu, low, high);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x18: { // clc imp
@@ -923,17 +953,17 @@ restart:
     }
     case 0x19: { // ora aby(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_ora(cpu, low, high);
+      uint32_t high = cpu_adrAby(cpu, &low, false, xf);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x1a: { // inca imp
-      if(cpu->mf) {
+      if(mf) {
         cpu->a = (cpu->a & 0xff00) | ((cpu->a + 1) & 0xff);
       } else {
         cpu->a++;
       }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
+      cpu_setZN(cpu, cpu->a, mf);
       break;
     }
     case 0x1b: { // tcs imp
@@ -943,25 +973,25 @@ restart:
     case 0x1c: { // trb abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_trb(cpu, low, high);
+      cpu_trb(cpu, low, high, mf);
       break;
     }
     case 0x1d: { // ora abx(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_ora(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, false, xf);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x1e: { // asl abx
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_asl(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, true, xf);
+      cpu_asl(cpu, low, high, mf);
       break;
     }
     case 0x1f: { // ora alx
       uint32_t low = 0;
       uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_ora(cpu, low, high);
+      cpu_ora(cpu, low, high, mf);
       break;
     }
     case 0x20: { // jsr abs
@@ -973,7 +1003,7 @@ restart:
     case 0x21: { // and idx
       uint32_t low = 0;
       uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_and(cpu, low, high);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x22: { // jsl abl
@@ -988,31 +1018,31 @@ restart:
     case 0x23: { // and sr
       uint32_t low = 0;
       uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_and(cpu, low, high);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x24: { // bit dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_bit(cpu, low, high);
+      cpu_bit(cpu, low, high, mf);
       break;
     }
     case 0x25: { // and dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_and(cpu, low, high);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x26: { // rol dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_rol(cpu, low, high);
+      cpu_rol(cpu, low, high, mf);
       break;
     }
     case 0x27: { // and idl
       uint32_t low = 0;
       uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_and(cpu, low, high);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x28: { // plp imp
@@ -1021,20 +1051,20 @@ restart:
     }
     case 0x29: { // and imm(m)
       uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_and(cpu, low, high);
+      uint32_t high = cpu_adrImm(cpu, &low, mf);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x2a: { // rola imp
       int result = (cpu->a << 1) | cpu->c;
-      if(cpu->mf) {
+      if(mf) {
         cpu->c = result & 0x100;
         cpu->a = (cpu->a & 0xff00) | (result & 0xff);
       } else {
         cpu->c = result & 0x10000;
         cpu->a = result;
       }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
+      cpu_setZN(cpu, cpu->a, mf);
       break;
     }
     case 0x2b: { // pld imp
@@ -1045,25 +1075,25 @@ restart:
     case 0x2c: { // bit abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_bit(cpu, low, high);
+      cpu_bit(cpu, low, high, mf);
       break;
     }
     case 0x2d: { // and abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_and(cpu, low, high);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x2e: { // rol abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_rol(cpu, low, high);
+      cpu_rol(cpu, low, high, mf);
       break;
     }
     case 0x2f: { // and abl
       uint32_t low = 0;
       uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_and(cpu, low, high);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x30: { // bmi rel
@@ -1072,44 +1102,44 @@ restart:
     }
     case 0x31: { // and idy(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_and(cpu, low, high);
+      uint32_t high = cpu_adrIdy(cpu, &low, false, xf);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x32: { // and idp
       uint32_t low = 0;
       uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_and(cpu, low, high);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x33: { // and isy
       uint32_t low = 0;
       uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_and(cpu, low, high);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x34: { // bit dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_bit(cpu, low, high);
+      cpu_bit(cpu, low, high, mf);
       break;
     }
     case 0x35: { // and dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_and(cpu, low, high);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x36: { // rol dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_rol(cpu, low, high);
+      cpu_rol(cpu, low, high, mf);
       break;
     }
     case 0x37: { // and ily
       uint32_t low = 0;
       uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_and(cpu, low, high);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x38: { // sec imp
@@ -1118,17 +1148,17 @@ restart:
     }
     case 0x39: { // and aby(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_and(cpu, low, high);
+      uint32_t high = cpu_adrAby(cpu, &low, false, xf);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x3a: { // deca imp
-      if(cpu->mf) {
+      if(mf) {
         cpu->a = (cpu->a & 0xff00) | ((cpu->a - 1) & 0xff);
       } else {
         cpu->a--;
       }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
+      cpu_setZN(cpu, cpu->a, mf);
       break;
     }
     case 0x3b: { // tsc imp
@@ -1138,26 +1168,26 @@ restart:
     }
     case 0x3c: { // bit abx(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_bit(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, false, xf);
+      cpu_bit(cpu, low, high, mf);
       break;
     }
     case 0x3d: { // and abx(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_and(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, false, xf);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x3e: { // rol abx
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_rol(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, true, xf);
+      cpu_rol(cpu, low, high, mf);
       break;
     }
     case 0x3f: { // and alx
       uint32_t low = 0;
       uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_and(cpu, low, high);
+      cpu_and(cpu, low, high, mf);
       break;
     }
     case 0x40: { // rti imp
@@ -1170,7 +1200,7 @@ restart:
     case 0x41: { // eor idx
       uint32_t low = 0;
       uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_eor(cpu, low, high);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x42: { // wdm imm(s)
@@ -1180,7 +1210,7 @@ restart:
     case 0x43: { // eor sr
       uint32_t low = 0;
       uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_eor(cpu, low, high);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x44: { // mvp bm
@@ -1194,7 +1224,7 @@ restart:
       if(cpu->a != 0xffff) {
         cpu->pc -= 3;
       }
-      if(cpu->xf) {
+      if(xf) {
         cpu->x &= 0xff;
         cpu->y &= 0xff;
       }
@@ -1203,23 +1233,23 @@ restart:
     case 0x45: { // eor dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_eor(cpu, low, high);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x46: { // lsr dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_lsr(cpu, low, high);
+      cpu_lsr(cpu, low, high, mf);
       break;
     }
     case 0x47: { // eor idl
       uint32_t low = 0;
       uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_eor(cpu, low, high);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x48: { // pha imp
-      if(cpu->mf) {
+      if(mf) {
         cpu_pushByte(cpu, (uint8_t)cpu->a);
       } else {
         cpu->cyclesUsed++; // m = 0: 1 extra cycle
@@ -1229,18 +1259,18 @@ restart:
     }
     case 0x49: { // eor imm(m)
       uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_eor(cpu, low, high);
+      uint32_t high = cpu_adrImm(cpu, &low, mf);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x4a: { // lsra imp
       cpu->c = cpu->a & 1;
-      if(cpu->mf) {
+      if(mf) {
         cpu->a = (cpu->a & 0xff00) | ((cpu->a >> 1) & 0x7f);
       } else {
         cpu->a >>= 1;
       }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
+      cpu_setZN(cpu, cpu->a, mf);
       break;
     }
     case 0x4b: { // phk imp
@@ -1254,19 +1284,19 @@ restart:
     case 0x4d: { // eor abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_eor(cpu, low, high);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x4e: { // lsr abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_lsr(cpu, low, high);
+      cpu_lsr(cpu, low, high, mf);
       break;
     }
     case 0x4f: { // eor abl
       uint32_t low = 0;
       uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_eor(cpu, low, high);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x50: { // bvc rel
@@ -1275,20 +1305,20 @@ restart:
     }
     case 0x51: { // eor idy(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_eor(cpu, low, high);
+      uint32_t high = cpu_adrIdy(cpu, &low, false, xf);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x52: { // eor idp
       uint32_t low = 0;
       uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_eor(cpu, low, high);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x53: { // eor isy
       uint32_t low = 0;
       uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_eor(cpu, low, high);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x54: { // mvn bm
@@ -1302,7 +1332,7 @@ restart:
       if(cpu->a != 0xffff) {
         cpu->pc -= 3;
       }
-      if(cpu->xf) {
+      if(xf) {
         cpu->x &= 0xff;
         cpu->y &= 0xff;
       }
@@ -1311,19 +1341,19 @@ restart:
     case 0x55: { // eor dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_eor(cpu, low, high);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x56: { // lsr dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_lsr(cpu, low, high);
+      cpu_lsr(cpu, low, high, mf);
       break;
     }
     case 0x57: { // eor ily
       uint32_t low = 0;
       uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_eor(cpu, low, high);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x58: { // cli imp
@@ -1332,12 +1362,12 @@ restart:
     }
     case 0x59: { // eor aby(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_eor(cpu, low, high);
+      uint32_t high = cpu_adrAby(cpu, &low, false, xf);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x5a: { // phy imp
-      if(cpu->xf) {
+      if(xf) {
         cpu_pushByte(cpu, (uint8_t)cpu->y);
       } else {
         cpu->cyclesUsed++; // m = 0: 1 extra cycle
@@ -1364,20 +1394,20 @@ restart:
     }
     case 0x5d: { // eor abx(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_eor(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, false, xf);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x5e: { // lsr abx
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_lsr(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, true, xf);
+      cpu_lsr(cpu, low, high, mf);
       break;
     }
     case 0x5f: { // eor alx
       uint32_t low = 0;
       uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_eor(cpu, low, high);
+      cpu_eor(cpu, low, high, mf);
       break;
     }
     case 0x60: { // rts imp
@@ -1394,7 +1424,7 @@ restart:
     case 0x61: { // adc idx
       uint32_t low = 0;
       uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_adc(cpu, low, high);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x62: { // per rll
@@ -1405,58 +1435,58 @@ restart:
     case 0x63: { // adc sr
       uint32_t low = 0;
       uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_adc(cpu, low, high);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x64: { // stz dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_stz(cpu, low, high);
+      cpu_stz(cpu, low, high, mf);
       break;
     }
     case 0x65: { // adc dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_adc(cpu, low, high);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x66: { // ror dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_ror(cpu, low, high);
+      cpu_ror(cpu, low, high, mf);
       break;
     }
     case 0x67: { // adc idl
       uint32_t low = 0;
       uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_adc(cpu, low, high);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x68: { // pla imp
-      if(cpu->mf) {
+      if(mf) {
         cpu->a = (cpu->a & 0xff00) | cpu_pullByte(cpu);
       } else {
         cpu->cyclesUsed++; // 16-bit m: 1 extra cycle
         cpu->a = cpu_pullWord(cpu);
       }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
+      cpu_setZN(cpu, cpu->a, mf);
       break;
     }
     case 0x69: { // adc imm(m)
       uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_adc(cpu, low, high);
+      uint32_t high = cpu_adrImm(cpu, &low, mf);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x6a: { // rora imp
       bool carry = cpu->a & 1;
-      if(cpu->mf) {
+      if(mf) {
         cpu->a = (cpu->a & 0xff00) | ((cpu->a >> 1) & 0x7f) | (cpu->c << 7);
       } else {
         cpu->a = (cpu->a >> 1) | (cpu->c << 15);
       }
       cpu->c = carry;
-      cpu_setZN(cpu, cpu->a, cpu->mf);
+      cpu_setZN(cpu, cpu->a, mf);
       break;
     }
     case 0x6b: { // rtl imp
@@ -1479,19 +1509,19 @@ restart:
     case 0x6d: { // adc abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_adc(cpu, low, high);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x6e: { // ror abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_ror(cpu, low, high);
+      cpu_ror(cpu, low, high, mf);
       break;
     }
     case 0x6f: { // adc abl
       uint32_t low = 0;
       uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_adc(cpu, low, high);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x70: { // bvs rel
@@ -1500,44 +1530,44 @@ restart:
     }
     case 0x71: { // adc idy(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_adc(cpu, low, high);
+      uint32_t high = cpu_adrIdy(cpu, &low, false, xf);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x72: { // adc idp
       uint32_t low = 0;
       uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_adc(cpu, low, high);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x73: { // adc isy
       uint32_t low = 0;
       uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_adc(cpu, low, high);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x74: { // stz dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_stz(cpu, low, high);
+      cpu_stz(cpu, low, high, mf);
       break;
     }
     case 0x75: { // adc dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_adc(cpu, low, high);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x76: { // ror dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_ror(cpu, low, high);
+      cpu_ror(cpu, low, high, mf);
       break;
     }
     case 0x77: { // adc ily
       uint32_t low = 0;
       uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_adc(cpu, low, high);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x78: { // sei imp
@@ -1546,18 +1576,18 @@ restart:
     }
     case 0x79: { // adc aby(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_adc(cpu, low, high);
+      uint32_t high = cpu_adrAby(cpu, &low, false, xf);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x7a: { // ply imp
-      if(cpu->xf) {
+      if(xf) {
         cpu->y = cpu_pullByte(cpu);
       } else {
         cpu->cyclesUsed++; // 16-bit x: 1 extra cycle
         cpu->y = cpu_pullWord(cpu);
       }
-      cpu_setZN(cpu, cpu->y, cpu->xf);
+      cpu_setZN(cpu, cpu->y, xf);
       break;
     }
     case 0x7b: { // tdc imp
@@ -1571,20 +1601,20 @@ restart:
     }
     case 0x7d: { // adc abx(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_adc(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, false, xf);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x7e: { // ror abx
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_ror(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, true, xf);
+      cpu_ror(cpu, low, high, mf);
       break;
     }
     case 0x7f: { // adc alx
       uint32_t low = 0;
       uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_adc(cpu, low, high);
+      cpu_adc(cpu, low, high, mf);
       break;
     }
     case 0x80: { // bra rel
@@ -1594,7 +1624,7 @@ restart:
     case 0x81: { // sta idx
       uint32_t low = 0;
       uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_sta(cpu, low, high);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x82: { // brl rll
@@ -1604,44 +1634,44 @@ restart:
     case 0x83: { // sta sr
       uint32_t low = 0;
       uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_sta(cpu, low, high);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x84: { // sty dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_sty(cpu, low, high);
+      cpu_sty(cpu, low, high, xf);
       break;
     }
     case 0x85: { // sta dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_sta(cpu, low, high);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x86: { // stx dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_stx(cpu, low, high);
+      cpu_stx(cpu, low, high, xf);
       break;
     }
     case 0x87: { // sta idl
       uint32_t low = 0;
       uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_sta(cpu, low, high);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x88: { // dey imp
-      if(cpu->xf) {
+      if(xf) {
         cpu->y = (cpu->y - 1) & 0xff;
       } else {
         cpu->y--;
       }
-      cpu_setZN(cpu, cpu->y, cpu->xf);
+      cpu_setZN(cpu, cpu->y, xf);
       break;
     }
     case 0x89: { // biti imm(m)
-      if(cpu->mf) {
+      if(mf) {
         uint8_t result = (cpu->a & 0xff) & cpu_readOpcode(cpu);
         cpu->z = result == 0;
       } else {
@@ -1652,12 +1682,12 @@ restart:
       break;
     }
     case 0x8a: { // txa imp
-      if(cpu->mf) {
+      if(mf) {
         cpu->a = (cpu->a & 0xff00) | (cpu->x & 0xff);
       } else {
         cpu->a = cpu->x;
       }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
+      cpu_setZN(cpu, cpu->a, mf);
       break;
     }
     case 0x8b: { // phb imp
@@ -1667,25 +1697,25 @@ restart:
     case 0x8c: { // sty abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_sty(cpu, low, high);
+      cpu_sty(cpu, low, high, xf);
       break;
     }
     case 0x8d: { // sta abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_sta(cpu, low, high);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x8e: { // stx abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_stx(cpu, low, high);
+      cpu_stx(cpu, low, high, xf);
       break;
     }
     case 0x8f: { // sta abl
       uint32_t low = 0;
       uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_sta(cpu, low, high);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x90: { // bcc rel
@@ -1694,59 +1724,59 @@ restart:
     }
     case 0x91: { // sta idy
       uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, true);
-      cpu_sta(cpu, low, high);
+      uint32_t high = cpu_adrIdy(cpu, &low, true, xf);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x92: { // sta idp
       uint32_t low = 0;
       uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_sta(cpu, low, high);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x93: { // sta isy
       uint32_t low = 0;
       uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_sta(cpu, low, high);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x94: { // sty dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_sty(cpu, low, high);
+      cpu_sty(cpu, low, high, xf);
       break;
     }
     case 0x95: { // sta dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_sta(cpu, low, high);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x96: { // stx dpy
       uint32_t low = 0;
       uint32_t high = cpu_adrDpy(cpu, &low);
-      cpu_stx(cpu, low, high);
+      cpu_stx(cpu, low, high, xf);
       break;
     }
     case 0x97: { // sta ily
       uint32_t low = 0;
       uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_sta(cpu, low, high);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x98: { // tya imp
-      if(cpu->mf) {
+      if(mf) {
         cpu->a = (cpu->a & 0xff00) | (cpu->y & 0xff);
       } else {
         cpu->a = cpu->y;
       }
-      cpu_setZN(cpu, cpu->a, cpu->mf);
+      cpu_setZN(cpu, cpu->a, mf);
       break;
     }
     case 0x99: { // sta aby
       uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, true);
-      cpu_sta(cpu, low, high);
+      uint32_t high = cpu_adrAby(cpu, &low, true, xf);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x9a: { // txs imp
@@ -1754,108 +1784,108 @@ restart:
       break;
     }
     case 0x9b: { // txy imp
-      if(cpu->xf) {
+      if(xf) {
         cpu->y = cpu->x & 0xff;
       } else {
         cpu->y = cpu->x;
       }
-      cpu_setZN(cpu, cpu->y, cpu->xf);
+      cpu_setZN(cpu, cpu->y, xf);
       break;
     }
     case 0x9c: { // stz abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_stz(cpu, low, high);
+      cpu_stz(cpu, low, high, mf);
       break;
     }
     case 0x9d: { // sta abx
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_sta(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, true, xf);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0x9e: { // stz abx
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_stz(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, true, xf);
+      cpu_stz(cpu, low, high, mf);
       break;
     }
     case 0x9f: { // sta alx
       uint32_t low = 0;
       uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_sta(cpu, low, high);
+      cpu_sta(cpu, low, high, mf);
       break;
     }
     case 0xa0: { // ldy imm(x)
       uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, true);
-      cpu_ldy(cpu, low, high);
+      uint32_t high = cpu_adrImm(cpu, &low, xf);
+      cpu_ldy(cpu, low, high, xf);
       break;
     }
     case 0xa1: { // lda idx
       uint32_t low = 0;
       uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_lda(cpu, low, high);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xa2: { // ldx imm(x)
       uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, true);
-      cpu_ldx(cpu, low, high);
+      uint32_t high = cpu_adrImm(cpu, &low, xf);
+      cpu_ldx(cpu, low, high, xf);
       break;
     }
     case 0xa3: { // lda sr
       uint32_t low = 0;
       uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_lda(cpu, low, high);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xa4: { // ldy dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_ldy(cpu, low, high);
+      cpu_ldy(cpu, low, high, xf);
       break;
     }
     case 0xa5: { // lda dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_lda(cpu, low, high);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xa6: { // ldx dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_ldx(cpu, low, high);
+      cpu_ldx(cpu, low, high, xf);
       break;
     }
     case 0xa7: { // lda idl
       uint32_t low = 0;
       uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_lda(cpu, low, high);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xa8: { // tay imp
-      if(cpu->xf) {
+      if(xf) {
         cpu->y = cpu->a & 0xff;
       } else {
         cpu->y = cpu->a;
       }
-      cpu_setZN(cpu, cpu->y, cpu->xf);
+      cpu_setZN(cpu, cpu->y, xf);
       break;
     }
     case 0xa9: { // lda imm(m)
       uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_lda(cpu, low, high);
+      uint32_t high = cpu_adrImm(cpu, &low, mf);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xaa: { // tax imp
-      if(cpu->xf) {
+      if(xf) {
         cpu->x = cpu->a & 0xff;
       } else {
         cpu->x = cpu->a;
       }
-      cpu_setZN(cpu, cpu->x, cpu->xf);
+      cpu_setZN(cpu, cpu->x, xf);
       break;
     }
     case 0xab: { // plb imp
@@ -1866,25 +1896,25 @@ restart:
     case 0xac: { // ldy abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_ldy(cpu, low, high);
+      cpu_ldy(cpu, low, high, xf);
       break;
     }
     case 0xad: { // lda abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_lda(cpu, low, high);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xae: { // ldx abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_ldx(cpu, low, high);
+      cpu_ldx(cpu, low, high, xf);
       break;
     }
     case 0xaf: { // lda abl
       uint32_t low = 0;
       uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_lda(cpu, low, high);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xb0: { // bcs rel
@@ -1893,44 +1923,44 @@ restart:
     }
     case 0xb1: { // lda idy(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_lda(cpu, low, high);
+      uint32_t high = cpu_adrIdy(cpu, &low, false, xf);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xb2: { // lda idp
       uint32_t low = 0;
       uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_lda(cpu, low, high);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xb3: { // lda isy
       uint32_t low = 0;
       uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_lda(cpu, low, high);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xb4: { // ldy dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_ldy(cpu, low, high);
+      cpu_ldy(cpu, low, high, xf);
       break;
     }
     case 0xb5: { // lda dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_lda(cpu, low, high);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xb6: { // ldx dpy
       uint32_t low = 0;
       uint32_t high = cpu_adrDpy(cpu, &low);
-      cpu_ldx(cpu, low, high);
+      cpu_ldx(cpu, low, high, xf);
       break;
     }
     case 0xb7: { // lda ily
       uint32_t low = 0;
       uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_lda(cpu, low, high);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xb8: { // clv imp
@@ -1939,62 +1969,62 @@ restart:
     }
     case 0xb9: { // lda aby(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_lda(cpu, low, high);
+      uint32_t high = cpu_adrAby(cpu, &low, false, xf);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xba: { // tsx imp
-      if(cpu->xf) {
+      if(xf) {
         cpu->x = cpu->sp & 0xff;
       } else {
         cpu->x = cpu->sp;
       }
-      cpu_setZN(cpu, cpu->x, cpu->xf);
+      cpu_setZN(cpu, cpu->x, xf);
       break;
     }
     case 0xbb: { // tyx imp
-      if(cpu->xf) {
+      if(xf) {
         cpu->x = cpu->y & 0xff;
       } else {
         cpu->x = cpu->y;
       }
-      cpu_setZN(cpu, cpu->x, cpu->xf);
+      cpu_setZN(cpu, cpu->x, xf);
       break;
     }
     case 0xbc: { // ldy abx(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_ldy(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, false, xf);
+      cpu_ldy(cpu, low, high, xf);
       break;
     }
     case 0xbd: { // lda abx(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_lda(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, false, xf);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xbe: { // ldx aby(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_ldx(cpu, low, high);
+      uint32_t high = cpu_adrAby(cpu, &low, false, xf);
+      cpu_ldx(cpu, low, high, xf);
       break;
     }
     case 0xbf: { // lda alx
       uint32_t low = 0;
       uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_lda(cpu, low, high);
+      cpu_lda(cpu, low, high, mf);
       break;
     }
     case 0xc0: { // cpy imm(x)
       uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, true);
-      cpu_cpy(cpu, low, high);
+      uint32_t high = cpu_adrImm(cpu, &low, xf);
+      cpu_cpy(cpu, low, high, xf);
       break;
     }
     case 0xc1: { // cmp idx
       uint32_t low = 0;
       uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_cmp(cpu, low, high);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xc2: { // rep imm(s)
@@ -2004,55 +2034,55 @@ restart:
     case 0xc3: { // cmp sr
       uint32_t low = 0;
       uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_cmp(cpu, low, high);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xc4: { // cpy dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_cpy(cpu, low, high);
+      cpu_cpy(cpu, low, high, xf);
       break;
     }
     case 0xc5: { // cmp dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_cmp(cpu, low, high);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xc6: { // dec dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_dec(cpu, low, high);
+      cpu_dec(cpu, low, high, mf);
       break;
     }
     case 0xc7: { // cmp idl
       uint32_t low = 0;
       uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_cmp(cpu, low, high);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xc8: { // iny imp
-      if(cpu->xf) {
+      if(xf) {
         cpu->y = (cpu->y + 1) & 0xff;
       } else {
         cpu->y++;
       }
-      cpu_setZN(cpu, cpu->y, cpu->xf);
+      cpu_setZN(cpu, cpu->y, xf);
       break;
     }
     case 0xc9: { // cmp imm(m)
       uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_cmp(cpu, low, high);
+      uint32_t high = cpu_adrImm(cpu, &low, mf);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xca: { // dex imp
-      if(cpu->xf) {
+      if(xf) {
         cpu->x = (cpu->x - 1) & 0xff;
       } else {
         cpu->x--;
       }
-      cpu_setZN(cpu, cpu->x, cpu->xf);
+      cpu_setZN(cpu, cpu->x, xf);
       break;
     }
     case 0xcb: { // wai imp
@@ -2062,25 +2092,25 @@ restart:
     case 0xcc: { // cpy abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_cpy(cpu, low, high);
+      cpu_cpy(cpu, low, high, xf);
       break;
     }
     case 0xcd: { // cmp abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_cmp(cpu, low, high);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xce: { // dec abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_dec(cpu, low, high);
+      cpu_dec(cpu, low, high, mf);
       break;
     }
     case 0xcf: { // cmp abl
       uint32_t low = 0;
       uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_cmp(cpu, low, high);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xd0: { // bne rel
@@ -2089,20 +2119,20 @@ restart:
     }
     case 0xd1: { // cmp idy(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_cmp(cpu, low, high);
+      uint32_t high = cpu_adrIdy(cpu, &low, false, xf);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xd2: { // cmp idp
       uint32_t low = 0;
       uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_cmp(cpu, low, high);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xd3: { // cmp isy
       uint32_t low = 0;
       uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_cmp(cpu, low, high);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xd4: { // pei dp
@@ -2114,19 +2144,19 @@ restart:
     case 0xd5: { // cmp dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_cmp(cpu, low, high);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xd6: { // dec dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_dec(cpu, low, high);
+      cpu_dec(cpu, low, high, mf);
       break;
     }
     case 0xd7: { // cmp ily
       uint32_t low = 0;
       uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_cmp(cpu, low, high);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xd8: { // cld imp
@@ -2135,12 +2165,12 @@ restart:
     }
     case 0xd9: { // cmp aby(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_cmp(cpu, low, high);
+      uint32_t high = cpu_adrAby(cpu, &low, false, xf);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xda: { // phx imp
-      if(cpu->xf) {
+      if(xf) {
         cpu_pushByte(cpu, (uint8_t)cpu->x);
       } else {
         cpu->cyclesUsed++; // m = 0: 1 extra cycle
@@ -2160,32 +2190,32 @@ restart:
     }
     case 0xdd: { // cmp abx(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_cmp(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, false, xf);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xde: { // dec abx
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_dec(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, true, xf);
+      cpu_dec(cpu, low, high, mf);
       break;
     }
     case 0xdf: { // cmp alx
       uint32_t low = 0;
       uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_cmp(cpu, low, high);
+      cpu_cmp(cpu, low, high, mf);
       break;
     }
     case 0xe0: { // cpx imm(x)
       uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, true);
-      cpu_cpx(cpu, low, high);
+      uint32_t high = cpu_adrImm(cpu, &low, xf);
+      cpu_cpx(cpu, low, high, xf);
       break;
     }
     case 0xe1: { // sbc idx
       uint32_t low = 0;
       uint32_t high = cpu_adrIdx(cpu, &low);
-      cpu_sbc(cpu, low, high);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xe2: { // sep imm(s)
@@ -2195,46 +2225,46 @@ restart:
     case 0xe3: { // sbc sr
       uint32_t low = 0;
       uint32_t high = cpu_adrSr(cpu, &low);
-      cpu_sbc(cpu, low, high);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xe4: { // cpx dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_cpx(cpu, low, high);
+      cpu_cpx(cpu, low, high, xf);
       break;
     }
     case 0xe5: { // sbc dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_sbc(cpu, low, high);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xe6: { // inc dp
       uint32_t low = 0;
       uint32_t high = cpu_adrDp(cpu, &low);
-      cpu_inc(cpu, low, high);
+      cpu_inc(cpu, low, high, mf);
       break;
     }
     case 0xe7: { // sbc idl
       uint32_t low = 0;
       uint32_t high = cpu_adrIdl(cpu, &low);
-      cpu_sbc(cpu, low, high);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xe8: { // inx imp
-      if(cpu->xf) {
+      if(xf) {
         cpu->x = (cpu->x + 1) & 0xff;
       } else {
         cpu->x++;
       }
-      cpu_setZN(cpu, cpu->x, cpu->xf);
+      cpu_setZN(cpu, cpu->x, xf);
       break;
     }
     case 0xe9: { // sbc imm(m)
       uint32_t low = 0;
-      uint32_t high = cpu_adrImm(cpu, &low, false);
-      cpu_sbc(cpu, low, high);
+      uint32_t high = cpu_adrImm(cpu, &low, mf);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xea: { // nop imp
@@ -2251,25 +2281,25 @@ restart:
     case 0xec: { // cpx abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_cpx(cpu, low, high);
+      cpu_cpx(cpu, low, high, xf);
       break;
     }
     case 0xed: { // sbc abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_sbc(cpu, low, high);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xee: { // inc abs
       uint32_t low = 0;
       uint32_t high = cpu_adrAbs(cpu, &low);
-      cpu_inc(cpu, low, high);
+      cpu_inc(cpu, low, high, mf);
       break;
     }
     case 0xef: { // sbc abl
       uint32_t low = 0;
       uint32_t high = cpu_adrAbl(cpu, &low);
-      cpu_sbc(cpu, low, high);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xf0: { // beq rel
@@ -2278,20 +2308,20 @@ restart:
     }
     case 0xf1: { // sbc idy(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrIdy(cpu, &low, false);
-      cpu_sbc(cpu, low, high);
+      uint32_t high = cpu_adrIdy(cpu, &low, false, xf);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xf2: { // sbc idp
       uint32_t low = 0;
       uint32_t high = cpu_adrIdp(cpu, &low);
-      cpu_sbc(cpu, low, high);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xf3: { // sbc isy
       uint32_t low = 0;
       uint32_t high = cpu_adrIsy(cpu, &low);
-      cpu_sbc(cpu, low, high);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xf4: { // pea imm(l)
@@ -2305,19 +2335,19 @@ restart:
     case 0xf5: { // sbc dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_sbc(cpu, low, high);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xf6: { // inc dpx
       uint32_t low = 0;
       uint32_t high = cpu_adrDpx(cpu, &low);
-      cpu_inc(cpu, low, high);
+      cpu_inc(cpu, low, high, mf);
       break;
     }
     case 0xf7: { // sbc ily
       uint32_t low = 0;
       uint32_t high = cpu_adrIly(cpu, &low);
-      cpu_sbc(cpu, low, high);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xf8: { // sed imp
@@ -2326,18 +2356,18 @@ restart:
     }
     case 0xf9: { // sbc aby(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAby(cpu, &low, false);
-      cpu_sbc(cpu, low, high);
+      uint32_t high = cpu_adrAby(cpu, &low, false, xf);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xfa: { // plx imp
-      if(cpu->xf) {
+      if(xf) {
         cpu->x = cpu_pullByte(cpu);
       } else {
         cpu->cyclesUsed++; // 16-bit x: 1 extra cycle
         cpu->x = cpu_pullWord(cpu);
       }
-      cpu_setZN(cpu, cpu->x, cpu->xf);
+      cpu_setZN(cpu, cpu->x, xf);
       break;
     }
     case 0xfb: { // xce imp
@@ -2355,21 +2385,34 @@ restart:
     }
     case 0xfd: { // sbc abx(r)
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, false);
-      cpu_sbc(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, false, xf);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
     case 0xfe: { // inc abx
       uint32_t low = 0;
-      uint32_t high = cpu_adrAbx(cpu, &low, true);
-      cpu_inc(cpu, low, high);
+      uint32_t high = cpu_adrAbx(cpu, &low, true, xf);
+      cpu_inc(cpu, low, high, mf);
       break;
     }
     case 0xff: { // sbc alx
       uint32_t low = 0;
       uint32_t high = cpu_adrAlx(cpu, &low);
-      cpu_sbc(cpu, low, high);
+      cpu_sbc(cpu, low, high, mf);
       break;
     }
   }
-}
\ No newline at end of file
+}
+
+static void cpu_doOpcodeM16X16(Cpu* cpu, uint8_t opcode) { cpu_doOpcodeMX(cpu, opcode, false, false); }
+static void cpu_doOpcodeM16X8(Cpu* cpu, uint8_t opcode) { cpu_doOpcodeMX(cpu, opcode, false, true); }
+static void cpu_doOpcodeM8X16(Cpu* cpu, uint8_t opcode) { cpu_doOpcodeMX(cpu, opcode, true, false); }
+static void cpu_doOpcodeM8X8(Cpu* cpu, uint8_t opcode) { cpu_doOpcodeMX(cpu, opcode, true, true); }
+
+static void (*const kCpuOpcodeTables[4])(Cpu* cpu, uint8_t opcode) = {
+  cpu_doOpcodeM16X16, cpu_doOpcodeM16X8, cpu_doOpcodeM8X16, cpu_doOpcodeM8X8,
+};
+
+static void cpu_execute(Cpu* cpu, uint8_t opcode) {
+  kCpuOpcodeTables[cpu->mf << 1 | cpu->xf](cpu, opcode);
+}
@@ -27,6 +27,7 @@ static const int transferLength[8] = {
 };
 
 static void dma_transferByte(Dma* dma, uint16_t aAdr, uint8_t aBank, uint8_t bAdr, bool fromB);
+static bool dma_bulkTransfer(Dma* dma, DmaChannel* ch);
 
 Dma* dma_init(Snes* snes) {
   Dma* dma = xmalloc(sizeof(Dma));
@@ -63,6 +64,7 @@ void dma_reset(Dma* dma) {
   dma->hdmaTimer = 0;
   dma->dmaTimer = 0;
   dma->dmaBusy = false;
+  dma->bulkTried = 0;
 }
 
 void dma_saveload(Dma *dma, SaveLoadFunc *func, void *ctx) {
@@ -210,6 +212,15 @@ void dma_doDma(Dma* dma) {
     g_fail = true;
   }
 
+  // only try the bulk copy once per channel, a channel it turns down keeps
+  // going one byte at a time
+  if(!(dma->bulkTried & (1 << i))) {
+    dma->bulkTried |= 1 << i;
+    if(dma_bulkTransfer(dma, &dma->channel[i])) {
+      return;
+    }
+  }
+
   // do channel i
   dma_transferByte(
     dma, dma->channel[i].aAdr, dma->channel[i].aBank,
@@ -319,6 +330,46 @@ static void dma_transferByte(Dma* dma, uint16_t aAdr, uint8_t aBank, uint8_t bAd
   }
 }
 
+// The rest of channel ch in one go, for the common case of a copy from wram
+// or rom into the vram, cgram or oam data ports. Returns false when it has to
+// be done one byte at a time.
+static bool dma_bulkTransfer(Dma* dma, DmaChannel* ch) {
+  if(ch->fromB) return false;
+  uint8_t bAdr[4];
+  for(int k = 0; k < 4; k++) {
+    bAdr[k] = ch->bAdr + bAdrOffsets[ch->mode][k];
+  }
+  if(!ppu_canWriteDma(bAdr)) return false;
+  uint8_t* const* map = dma->snes->readMap;
+  int n = ch->size ? ch->size : 0x10000;
+  int step = ch->fixed ? 0 : ch->decrement ? -1 : 1;
+  // every source page has to be plain memory
+  for(int i = 0; i < n;) {
+    uint16_t adr = ch->aAdr + step * i;
+    if(!map[(ch->aBank << 4) | (adr >> 12)]) return false;
+    if(step == 0) break;
+    i += step > 0 ? 0x1000 - (adr & 0xfff) : (adr & 0xfff) + 1;
+  }
+  uint16_t aAdr = ch->aAdr;
+  uint8_t buf[256];
+  for(int done = 0; done < n;) {
+    int len = n - done < (int)sizeof(buf) ? n - done : (int)sizeof(buf);
+    for(int i = 0; i < len; i++, aAdr += step) {
+      buf[i] = map[(ch->aBank << 4) | (aAdr >> 12)][aAdr & 0xfff];
+    }
+    ppu_writeDma(dma->snes->ppu, bAdr, ch->offIndex + done, buf, len);
+    done += len;
+  }
+  ch->aAdr = aAdr;
+  ch->size = 0;
+  ch->offIndex = 0;
+  ch->dmaActive = false;
+  // the dma runs to completion inside the MDMAEN write, so nothing sees the
+  // timer run down between the bytes. Only the channel overhead is left.
+  dma->dmaTimer += 8;
+  return true;
+}
+
 bool dma_cycle(Dma* dma) {
   if(dma->hdmaTimer > 0) {
     dma->hdmaTimer -= 2;
@@ -339,6 +390,7 @@ void dma_startDma(Dma* dma, uint8_t val, bool hdma) {
     }
   }
   if(!hdma) {
+    dma->bulkTried &= ~val;
     dma->dmaBusy = val;
     dma->dmaTimer += dma->dmaBusy ? 16 : 0; // 12-24 cycle overhead for entire dma transfer
   }
@@ -41,6 +41,8 @@ struct Dma {
   uint32_t dmaTimer;
   bool dmaBusy;
   uint8_t pad[7];
+  // not saved: channels whose dma has had its try at dma_bulkTransfer
+  uint8_t bulkTried;
 };
 
 Dma* dma_init(Snes* snes);
@@ -5,10 +5,19 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <math.h>
 
 #include "dsp.h"
 #include "apu.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define DSP_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DSP_SIMD_NEON 1
+#endif
+
 #define MY_CHANGES 1
 
 static const int rateValues[32] = {
@@ -53,8 +62,11 @@ static const uint16_t gaussValues[512] = {
   0x513, 0x514, 0x514, 0x515, 0x516, 0x516, 0x517, 0x517, 0x517, 0x518, 0x518, 0x518, 0x518, 0x518, 0x519, 0x519
 };
 
-static void dsp_cycleChannel(Dsp* dsp, int ch);
-static void dsp_handleEcho(Dsp* dsp, int* outputL, int* outputR);
+static int16_t dsp_cycleChannel(Dsp* dsp, int ch, bool evenCycle, int16_t noise, int16_t modulator);
+static void dsp_skipChannel(Dsp* dsp, int ch, int n, const int16_t* modulator);
+static void dsp_mix(Dsp* dsp, const int16_t* out);
+static void dsp_readEchoCheck(Dsp* dsp, uint16_t adr, int len);
+static void dsp_handleEcho(Dsp* dsp, int* outputL, int* outputR, const int32_t* voiceL, const int32_t* voiceR);
 static void dsp_handleGain(Dsp* dsp, int ch);
 static void dsp_decodeBrr(Dsp* dsp, int ch);
 static int16_t dsp_getSample(Dsp* dsp, int ch, int sampleNum, int offset);
@@ -63,6 +75,10 @@ static void dsp_handleNoise(Dsp* dsp);
 Dsp* dsp_init(uint8_t *ram) {
   Dsp* dsp = malloc(sizeof(Dsp));
   dsp->apu_ram = ram;
+  dsp->resampleLinear = false;
+  dsp->resampleRate = 0;
+  memset(dsp->brrCache, 0, sizeof(dsp->brrCache));
+  dsp->blockEchoLen = 0;
   return dsp;
 }
 
@@ -123,19 +139,128 @@ void dsp_reset(Dsp* dsp) {
   memset(dsp->firBufferR, 0, sizeof(dsp->firBufferR));
   memset(dsp->sampleBuffer, 0, sizeof(dsp->sampleBuffer));
   dsp->sampleOffset = 0;
+  memset(dsp->resampleHistory, 0, sizeof(dsp->resampleHistory));
+  memset(dsp->brrCache, 0, sizeof(dsp->brrCache));
 }
 
 void dsp_saveload(Dsp *dsp, SaveLoadFunc *func, void *ctx) {
   func(ctx, &dsp->ram, sizeof(Dsp) - offsetof(Dsp, ram));
 }
 
+// out[i] = (a[i] * b[i]) >> 6 for 8 lanes
+static void dsp_mul8(const int16_t* a, const int16_t* b, int32_t* out) {
+#if defined(DSP_SIMD_SSE2)
+  __m128i x = _mm_loadu_si128((const __m128i*)a), y = _mm_loadu_si128((const __m128i*)b);
+  __m128i lo = _mm_mullo_epi16(x, y), hi = _mm_mulhi_epi16(x, y);
+  _mm_storeu_si128((__m128i*)out, _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 6));
+  _mm_storeu_si128((__m128i*)(out + 4), _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 6));
+#elif defined(DSP_SIMD_NEON)
+  int16x8_t x = vld1q_s16(a), y = vld1q_s16(b);
+  vst1q_s32(out, vshrq_n_s32(vmull_s16(vget_low_s16(x), vget_low_s16(y)), 6));
+  vst1q_s32(out + 4, vshrq_n_s32(vmull_s16(vget_high_s16(x), vget_high_s16(y)), 6));
+#else
+  for(int i = 0; i < 8; i++)
+    out[i] = (a[i] * b[i]) >> 6;
+#endif
+}
+
 void dsp_cycle(Dsp* dsp) {
+  int16_t out[8];
+  for(int i = 0; i < 8; i++) {
+    out[i] = dsp_cycleChannel(dsp, i, dsp->evenCycle, dsp->noiseSample, i ? out[i - 1] : 0);
+  }
+  dsp_mix(dsp, out);
+  dsp_handleNoise(dsp);
+  dsp->evenCycle = !dsp->evenCycle;
+}
+
+// Same as n calls to dsp_cycle, but each voice runs through the whole block
+// before the next one and the voices are mixed at the end. Registers must not
+// be written inside a block.
+void dsp_renderBlock(Dsp* dsp, int n) {
+  while(n > kDspMaxBlock) {
+    dsp_renderBlock(dsp, kDspMaxBlock);
+    n -= kDspMaxBlock;
+  }
+  if(n <= 0) return;
+  DspChannel savedChannels[8];
+  uint8_t savedRam[0x80];
+  int16_t savedNoiseSample = dsp->noiseSample;
+  uint16_t savedNoiseCounter = dsp->noiseCounter;
+  memcpy(savedChannels, dsp->channel, sizeof(savedChannels));
+  memcpy(savedRam, dsp->ram, sizeof(savedRam));
+  // noise only depends on itself, step it up front
+  int16_t noise[kDspMaxBlock];
+  for(int i = 0; i < n; i++) {
+    noise[i] = dsp->noiseSample;
+    dsp_handleNoise(dsp);
+  }
+  // the part of the echo buffer the block writes, brr reads from it would
+  // have to see the writes of the earlier samples
+  dsp->blockEchoLen = 0;
+  dsp->blockEchoHit = false;
+  if(dsp->echoWrites) {
+    if(n <= dsp->echoRemain) {
+      dsp->blockEchoAdr = dsp->echoBufferAdr + dsp->echoBufferIndex * 4;
+      dsp->blockEchoLen = n * 4;
+    } else {
+      int last = dsp->echoBufferIndex + dsp->echoRemain;
+      int wrapped = n - dsp->echoRemain < dsp->echoDelay ? n - dsp->echoRemain : dsp->echoDelay;
+      dsp->blockEchoAdr = dsp->echoBufferAdr;
+      dsp->blockEchoLen = (last > wrapped ? last : wrapped) * 4;
+    }
+  }
+  int16_t out[8][kDspMaxBlock];
+  for(int ch = 0; ch < 8; ch++) {
+    DspChannel* c = &dsp->channel[ch];
+    const int16_t* modulator = ch ? out[ch - 1] : NULL;
+    if(c->adsrState == 4 && c->gain == 0 && (!c->keyOn || c->keyOff)) {
+      // released to silence, only the sample position moves
+      dsp_skipChannel(dsp, ch, n, modulator);
+      memset(out[ch], 0, n * sizeof(int16_t));
+      continue;
+    }
+    for(int i = 0; i < n; i++) {
+      out[ch][i] = dsp_cycleChannel(dsp, ch, dsp->evenCycle ^ (i & 1), noise[i], modulator ? modulator[i] : 0);
+    }
+  }
+  dsp->blockEchoLen = 0;
+  if(dsp->blockEchoHit) {
+    // a sample plays out of the echo buffer, redo it one sample at a time
+    memcpy(dsp->channel, savedChannels, sizeof(savedChannels));
+    memcpy(dsp->ram, savedRam, sizeof(savedRam));
+    dsp->noiseSample = savedNoiseSample;
+    dsp->noiseCounter = savedNoiseCounter;
+    for(int i = 0; i < n; i++)
+      dsp_cycle(dsp);
+    return;
+  }
+  for(int i = 0; i < n; i++) {
+    int16_t sampleOut[8];
+    for(int ch = 0; ch < 8; ch++)
+      sampleOut[ch] = out[ch][i];
+    dsp_mix(dsp, sampleOut);
+  }
+  dsp->evenCycle ^= n & 1;
+}
+
+static void dsp_mix(Dsp* dsp, const int16_t* out) {
+  // the voice outputs and volumes side by side, so the products for the main
+  // mix and the echo input are done 8 voices at a time
+  int16_t volL[8], volR[8];
+  int32_t voiceL[8], voiceR[8];
+  for(int i = 0; i < 8; i++) {
+    volL[i] = dsp->channel[i].volumeL;
+    volR[i] = dsp->channel[i].volumeR;
+  }
+  dsp_mul8(out, volL, voiceL);
+  dsp_mul8(out, volR, voiceR);
+  // the clamps after each voice make the sum order dependent, keep it serial
   int totalL = 0;
   int totalR = 0;
   for(int i = 0; i < 8; i++) {
-    dsp_cycleChannel(dsp, i);
-    totalL += (dsp->channel[i].sampleOut * dsp->channel[i].volumeL) >> 6;
-    totalR += (dsp->channel[i].sampleOut * dsp->channel[i].volumeR) >> 6;
+    totalL += voiceL[i];
+    totalR += voiceR[i];
     totalL = totalL < -0x8000 ? -0x8000 : (totalL > 0x7fff ? 0x7fff : totalL); // clamp 16-bit
     totalR = totalR < -0x8000 ? -0x8000 : (totalR > 0x7fff ? 0x7fff : totalR); // clamp 16-bit
   }
@@ -143,12 +268,11 @@ void dsp_cycle(Dsp* dsp) {
   totalR = (totalR * dsp->masterVolumeR) >> 7;
   totalL = totalL < -0x8000 ? -0x8000 : (totalL > 0x7fff ? 0x7fff : totalL); // clamp 16-bit
   totalR = totalR < -0x8000 ? -0x8000 : (totalR > 0x7fff ? 0x7fff : totalR); // clamp 16-bit
-  dsp_handleEcho(dsp, &totalL, &totalR);
+  dsp_handleEcho(dsp, &totalL, &totalR, voiceL, voiceR);
   if(dsp->mute) {
     totalL = 0;
     totalR = 0;
   }
-  dsp_handleNoise(dsp);
   // put it in the samplebuffer
   if (dsp->sampleOffset < 534) {
     dsp->sampleBuffer[dsp->sampleOffset * 2] = totalL;
@@ -156,10 +280,9 @@ void dsp_cycle(Dsp* dsp) {
     // prevent sampleOffset from going above 534-1 (out of sampleBuffer bounds)
     dsp->sampleOffset++;
   }
-  dsp->evenCycle = !dsp->evenCycle;
 }
 
-static void dsp_handleEcho(Dsp* dsp, int* outputL, int* outputR) {
+static void dsp_handleEcho(Dsp* dsp, int* outputL, int* outputR, const int32_t* voiceL, const int32_t* voiceR) {
   // get value out of ram
   uint16_t adr = dsp->echoBufferAdr + dsp->echoBufferIndex * 4;
   dsp->firBufferL[dsp->firBufferIndex] = (
@@ -170,17 +293,22 @@ static void dsp_handleEcho(Dsp* dsp, int* outputL, int* outputR) {
     dsp->apu_ram[(adr + 2) & 0xffff] + (dsp->apu_ram[(adr + 3) & 0xffff] << 8)
   );
   dsp->firBufferR[dsp->firBufferIndex] >>= 1;
-  // calculate FIR-sum
+  // calculate FIR-sum, rotate the filter to line up with the buffer
+  // instead of walking the buffer from the oldest entry
+  int16_t firValues[16], *fir = firValues + 7 - dsp->firBufferIndex;
+  for(int i = 0; i < 8; i++)
+    firValues[i] = firValues[i + 8] = dsp->firValues[i];
+  int32_t tapL[8], tapR[8];
+  dsp_mul8(dsp->firBufferL, fir, tapL);
+  dsp_mul8(dsp->firBufferR, fir, tapR);
   int sumL = 0, sumR = 0;
   for(int i = 0; i < 8; i++) {
-    sumL += (dsp->firBufferL[(dsp->firBufferIndex + i + 1) & 0x7] * dsp->firValues[i]) >> 6;
-    sumR += (dsp->firBufferR[(dsp->firBufferIndex + i + 1) & 0x7] * dsp->firValues[i]) >> 6;
-    if(i == 6) {
-      // clip to 16-bit before last addition
-      sumL = ((int16_t) (sumL & 0xffff)); // clip 16-bit
-      sumR = ((int16_t) (sumR & 0xffff)); // clip 16-bit
-    }
+    sumL += tapL[i];
+    sumR += tapR[i];
   }
+  // clip to 16-bit before adding the newest sample
+  sumL = (int16_t)((sumL - tapL[dsp->firBufferIndex]) & 0xffff) + tapL[dsp->firBufferIndex];
+  sumR = (int16_t)((sumR - tapR[dsp->firBufferIndex]) & 0xffff) + tapR[dsp->firBufferIndex];
   sumL = sumL < -0x8000 ? -0x8000 : (sumL > 0x7fff ? 0x7fff : sumL); // clamp 16-bit
   sumR = sumR < -0x8000 ? -0x8000 : (sumR > 0x7fff ? 0x7fff : sumR); // clamp 16-bit
   // modify output with sum
@@ -192,8 +320,8 @@ static void dsp_handleEcho(Dsp* dsp, int* outputL, int* outputR) {
   int inL = 0, inR = 0;
   for(int i = 0; i < 8; i++) {
     if(dsp->channel[i].echoEnable) {
-      inL += (dsp->channel[i].sampleOut * dsp->channel[i].volumeL) >> 6;
-      inR += (dsp->channel[i].sampleOut * dsp->channel[i].volumeR) >> 6;
+      inL += voiceL[i];
+      inR += voiceR[i];
       inL = inL < -0x8000 ? -0x8000 : (inL > 0x7fff ? 0x7fff : inL); // clamp 16-bit
       inR = inR < -0x8000 ? -0x8000 : (inR > 0x7fff ? 0x7fff : inR); // clamp 16-bit
     }
@@ -222,11 +350,11 @@ static void dsp_handleEcho(Dsp* dsp, int* outputL, int* outputR) {
   }
 }
 
-static void dsp_cycleChannel(Dsp* dsp, int ch) {
+static int16_t dsp_cycleChannel(Dsp* dsp, int ch, bool evenCycle, int16_t noise, int16_t modulator) {
   // handle pitch counter
   uint16_t pitch = dsp->channel[ch].pitch;
   if(ch > 0 && dsp->channel[ch].pitchModulation) {
-    int factor = (dsp->channel[ch - 1].sampleOut >> 4) + 0x400;
+    int factor = (modulator >> 4) + 0x400;
     pitch = (pitch * factor) >> 10;
     if(pitch > 0x3fff) pitch = 0x3fff;
   }
@@ -238,12 +366,12 @@ static void dsp_cycleChannel(Dsp* dsp, int ch) {
   dsp->channel[ch].pitchCounter = newCounter;
   int16_t sample = 0;
   if(dsp->channel[ch].useNoise) {
-    sample = dsp->noiseSample;
+    sample = noise;
   } else {
     sample = dsp_getSample(dsp, ch, dsp->channel[ch].pitchCounter >> 12, (dsp->channel[ch].pitchCounter >> 4) & 0xff);
   }
 #if !MY_CHANGES
-  if(dsp->evenCycle) {
+  if(evenCycle) {
     // handle keyon/off (every other cycle)
     if(dsp->channel[ch].keyOff) {
       // go to release
@@ -253,6 +381,7 @@ static void dsp_cycleChannel(Dsp* dsp, int ch) {
       // restart current sample
       dsp->channel[ch].previousFlags = 0;
       uint16_t samplePointer = dsp->dirPage + 4 * dsp->channel[ch].srcn;
+      dsp_readEchoCheck(dsp, samplePointer, 2);
       dsp->channel[ch].decodeOffset = dsp->apu_ram[samplePointer];
       dsp->channel[ch].decodeOffset |= dsp->apu_ram[(samplePointer + 1) & 0xffff] << 8;
       memset(dsp->channel[ch].decodeBuffer, 0, sizeof(dsp->channel[ch].decodeBuffer));
@@ -282,6 +411,34 @@ static void dsp_cycleChannel(Dsp* dsp, int ch) {
   sample = (sample * dsp->channel[ch].gain) >> 11;
   dsp->ram[(ch << 4) | 9] = sample >> 7;
   dsp->channel[ch].sampleOut = sample;
+  return sample;
+}
+
+// dsp_cycleChannel for n samples of a voice in release at zero gain, where the
+// output stays 0 and only the brr position has to be kept in step
+static void dsp_skipChannel(Dsp* dsp, int ch, int n, const int16_t* modulator) {
+  DspChannel* c = &dsp->channel[ch];
+  for(int i = 0; i < n; i++) {
+    uint16_t pitch = c->pitch;
+    if(ch > 0 && c->pitchModulation) {
+      int factor = (modulator[i] >> 4) + 0x400;
+      pitch = (pitch * factor) >> 10;
+      if(pitch > 0x3fff) pitch = 0x3fff;
+    }
+    int newCounter = c->pitchCounter + pitch;
+    if(newCounter > 0xffff) dsp_decodeBrr(dsp, ch);
+    c->pitchCounter = newCounter;
+  }
+  dsp->ram[(ch << 4) | 8] = 0;
+  dsp->ram[(ch << 4) | 9] = 0;
+  c->sampleOut = 0;
+}
+
+// flags brr reads that overlap echo writes still pending in dsp_renderBlock
+static void dsp_readEchoCheck(Dsp* dsp, uint16_t adr, int len) {
+  if(dsp->blockEchoLen != 0 && ((uint16_t)(adr - dsp->blockEchoAdr) < dsp->blockEchoLen ||
+                                (uint16_t)(dsp->blockEchoAdr - adr) < len))
+    dsp->blockEchoHit = true;
 }
 
 static void dsp_handleGain(Dsp* dsp, int ch) {
@@ -359,6 +516,7 @@ static void dsp_decodeBrr(Dsp* dsp, int ch) {
   if(dsp->channel[ch].previousFlags == 1 || dsp->channel[ch].previousFlags == 3) {
     // loop sample
     uint16_t samplePointer = dsp->dirPage + 4 * dsp->channel[ch].srcn;
+    dsp_readEchoCheck(dsp, samplePointer + 2, 2);
     dsp->channel[ch].decodeOffset = dsp->apu_ram[(samplePointer + 2) & 0xffff];
     dsp->channel[ch].decodeOffset |= (dsp->apu_ram[(samplePointer + 3) & 0xffff]) << 8;
     if(dsp->channel[ch].previousFlags == 1) {
@@ -368,21 +526,36 @@ static void dsp_decodeBrr(Dsp* dsp, int ch) {
     }
     dsp->ram[0x7c] |= 1 << ch; // set ENDx
   }
-  uint8_t header = dsp->apu_ram[dsp->channel[ch].decodeOffset++];
+  // fetch the block, entries compare these bytes so any write to apu ram
+  // (upload, echo buffer, spc code) invalidates a stale entry on its own
+  uint8_t data[9];
+  dsp_readEchoCheck(dsp, dsp->channel[ch].decodeOffset, 9);
+  for(int i = 0; i < 9; i++) {
+    data[i] = dsp->apu_ram[dsp->channel[ch].decodeOffset++];
+  }
+  uint8_t header = data[0];
   int shift = header >> 4;
   int filter = (header & 0xc) >> 2;
   dsp->channel[ch].previousFlags = header & 0x3;
-  uint8_t curByte = 0;
-  int old = dsp->channel[ch].old;
-  int older = dsp->channel[ch].older;
+  // only the history the filter reads is part of the key
+  int old = filter ? dsp->channel[ch].old : 0;
+  int older = filter >= 2 ? dsp->channel[ch].older : 0;
+  uint16_t adr = dsp->channel[ch].decodeOffset - 9;
+  DspBrrBlock* block = &dsp->brrCache[(adr / 9 ^ old ^ older * 3) & (kDspBrrCacheSize - 1)];
+  int16_t* out = dsp->channel[ch].decodeBuffer + 3;
+  if(block->valid && block->old == old && block->older == older && memcmp(block->data, data, 9) == 0) {
+    memcpy(out, block->samples, sizeof(block->samples));
+    dsp->channel[ch].older = out[14];
+    dsp->channel[ch].old = out[15];
+    return;
+  }
+  block->valid = true;
+  block->old = old;
+  block->older = older;
+  memcpy(block->data, data, 9);
   for(int i = 0; i < 16; i++) {
-    int s = 0;
-    if(i & 1) {
-      s = curByte & 0xf;
-    } else {
-      curByte = dsp->apu_ram[dsp->channel[ch].decodeOffset++];
-      s = curByte >> 4;
-    }
+    int s = data[1 + (i >> 1)];
+    s = (i & 1) ? s & 0xf : s >> 4;
     if(s > 7) s -= 16;
     if(shift <= 0xc) {
       s = (s << shift) >> 1;
@@ -398,8 +571,9 @@ static void dsp_decodeBrr(Dsp* dsp, int ch) {
     s = ((int16_t) ((s & 0x7fff) << 1)) >> 1; // clip 15-bit
     older = old;
     old = s;
-    dsp->channel[ch].decodeBuffer[i + 3] = s;
+    out[i] = s;
   }
+  memcpy(block->samples, out, sizeof(block->samples));
   dsp->channel[ch].older = older;
   dsp->channel[ch].old = old;
 }
@@ -565,14 +739,74 @@ void dsp_write(Dsp* dsp, uint8_t adr, uint8_t val) {
   dsp->ram[adr] = val;
 }
 
+void dsp_setLinearResampling(Dsp* dsp, bool linear) {
+  dsp->resampleLinear = linear;
+}
+
+// Windowed sinc (blackman) kernel in 2.14 fixed point, one row per fractional
+// phase. The cutoff follows the output rate when downsampling.
+static void dsp_buildResampleKernel(Dsp* dsp, int samplesPerFrame) {
+  const double pi = 3.14159265358979323846;
+  double cutoff = 0.9 * (samplesPerFrame < 534 ? samplesPerFrame / 534.0 : 1.0);
+  for(int phase = 0; phase < kDspResamplePhases; phase++) {
+    double coeffs[kDspResampleTaps], sum = 0;
+    for(int k = 0; k < kDspResampleTaps; k++) {
+      double t = k - (kDspResampleTaps / 2 - 1) - (double)phase / kDspResamplePhases;
+      double x = pi * cutoff * t;
+      double sinc = x != 0 ? sin(x) / x : 1.0;
+      double w = 2 * pi * (t + kDspResampleTaps / 2) / kDspResampleTaps;
+      coeffs[k] = sinc * (0.42 - 0.5 * cos(w) + 0.08 * cos(2 * w));
+      sum += coeffs[k];
+    }
+    // normalize each phase to unity gain and fix up rounding in the center tap
+    int total = 0;
+    for(int k = 0; k < kDspResampleTaps; k++)
+      total += dsp->resampleKernel[phase][k] = (int16_t)lrint(coeffs[k] / sum * 16384);
+    dsp->resampleKernel[phase][kDspResampleTaps / 2 - 1] += 16384 - total;
+  }
+  dsp->resampleRate = samplesPerFrame;
+}
+
+static inline int16_t dsp_clamp16(int v) {
+  return v < -0x8000 ? -0x8000 : (v > 0x7fff ? 0x7fff : v);
+}
+
 void dsp_getSamples(Dsp* dsp, int16_t* sampleData, int samplesPerFrame) {
   // resample from 534 samples per frame to wanted value
-  double adder = 534.0 / samplesPerFrame;
-  double location = 0.0;
-  for(int i = 0; i < samplesPerFrame; i++) {
-    sampleData[i * 2] = dsp->sampleBuffer[((int) location) * 2];
-    sampleData[i * 2 + 1] = dsp->sampleBuffer[((int) location) * 2 + 1];
-    location += adder;
+  // the kernel needs samples on both sides, so prepend the end of the previous
+  // frame and run kDspResampleTaps / 2 samples behind
+  int16_t input[(kDspResampleTaps + 534) * 2];
+  memcpy(input, dsp->resampleHistory, sizeof(dsp->resampleHistory));
+  memcpy(input + kDspResampleTaps * 2, dsp->sampleBuffer, sizeof(dsp->sampleBuffer));
+  memcpy(dsp->resampleHistory, input + 534 * 2, sizeof(dsp->resampleHistory));
+  // position in 16.16 fixed point
+  uint32_t step = (534 << 16) / samplesPerFrame;
+  uint32_t location = 0;
+  if(samplesPerFrame == 534) {
+    // same delay as below, so the output doesn't jump when the rate varies
+    memcpy(sampleData, input + kDspResampleTaps / 2 * 2, sizeof(dsp->sampleBuffer));
+  } else if(dsp->resampleLinear) {
+    for(int i = 0; i < samplesPerFrame; i++, location += step) {
+      const int16_t *p = input + ((location >> 16) + kDspResampleTaps / 2) * 2;
+      int frac = (location & 0xffff) >> 1;
+      sampleData[i * 2] = p[0] + (((p[2] - p[0]) * frac) >> 15);
+      sampleData[i * 2 + 1] = p[1] + (((p[3] - p[1]) * frac) >> 15);
+    }
+  } else {
+    // small changes in rate don't need a new cutoff
+    if(abs(dsp->resampleRate - samplesPerFrame) * 64 > samplesPerFrame)
+      dsp_buildResampleKernel(dsp, samplesPerFrame);
+    for(int i = 0; i < samplesPerFrame; i++, location += step) {
+      const int16_t *p = input + ((location >> 16) + 1) * 2;
+      const int16_t *kernel = dsp->resampleKernel[(location >> (16 - 7)) & (kDspResamplePhases - 1)];
+      int totalL = 0, totalR = 0;
+      for(int k = 0; k < kDspResampleTaps; k++) {
+        totalL += p[k * 2] * kernel[k];
+        totalR += p[k * 2 + 1] * kernel[k];
+      }
+      sampleData[i * 2] = dsp_clamp16((totalL + 0x2000) >> 14);
+      sampleData[i * 2 + 1] = dsp_clamp16((totalR + 0x2000) >> 14);
+    }
   }
   dsp->sampleOffset = 0;
 }
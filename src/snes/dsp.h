@@ -11,6 +11,13 @@
 
 typedef struct Dsp Dsp;
 
+enum {
+  kDspResampleTaps = 16,
+  kDspResamplePhases = 128,
+  kDspBrrCacheSize = 512,
+  kDspMaxBlock = 64,
+};
+
 typedef struct Apu Apu;
 
 typedef struct DspChannel {
@@ -46,8 +53,28 @@ typedef struct DspChannel {
   bool echoEnable;
 } DspChannel;
 
+// a decoded brr block, keyed by its 9 source bytes and the filter history
+typedef struct DspBrrBlock {
+  uint8_t data[9];
+  bool valid;
+  int16_t old;
+  int16_t older;
+  int16_t samples[16];
+} DspBrrBlock;
+
 struct Dsp {
   uint8_t *apu_ram;
+  // resampler, not part of the saved state
+  bool resampleLinear;
+  int resampleRate; // samplesPerFrame the kernel was built for
+  int16_t resampleHistory[kDspResampleTaps * 2]; // tail of the previous frame
+  int16_t resampleKernel[kDspResamplePhases][kDspResampleTaps];
+  // decoded brr blocks, not part of the saved state
+  DspBrrBlock brrCache[kDspBrrCacheSize];
+  // echo buffer range dsp_renderBlock writes while voices run ahead of it
+  uint16_t blockEchoAdr;
+  int blockEchoLen;
+  bool blockEchoHit;
   // mirror ram
   uint8_t ram[0x80];
   // 8 channels
@@ -91,9 +118,11 @@ Dsp *dsp_init(uint8_t *ram);
 void dsp_free(Dsp* dsp);
 void dsp_reset(Dsp* dsp);
 void dsp_cycle(Dsp* dsp);
+void dsp_renderBlock(Dsp* dsp, int n);
 uint8_t dsp_read(Dsp* dsp, uint8_t adr);
 void dsp_write(Dsp* dsp, uint8_t adr, uint8_t val);
 void dsp_getSamples(Dsp* dsp, int16_t* sampleData, int samplesPerFrame);
+void dsp_setLinearResampling(Dsp* dsp, bool linear);
 void dsp_saveload(Dsp *dsp, SaveLoadFunc *func, void *ctx);
 
 #endif
@@ -10,6 +10,15 @@
 #include "snes.h"
 #include "../types.h"
 #include "../util.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define PPU_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PPU_SIMD_NEON 1
+#endif
+
 typedef uint64_t uint64;
 typedef uint32_t uint32;
 typedef uint32_t uint;
@@ -19,6 +28,7 @@ typedef uint8_t uint8;
 
 extern bool g_new_ppu;
 static void PpuDrawWholeLine(Ppu *ppu, uint y);
+static void PpuRenderLine(Ppu *ppu, int line);
 
 // array for layer definitions per mode:
 //   0-7: mode 0-7; 8: mode 1 + l3prio; 9: mode 7 + extbg
@@ -97,24 +107,59 @@ enum {
   kWindow2Enabled = 8,
 };
 
+enum {
+  kPpuTileCacheEntries = 0x8000 * 2,
+};
+static const uint64 kPpuTileRowInvalid = ~(uint64)0;
+
 Ppu* ppu_init(Snes* snes) {
   Ppu* ppu = xmalloc(sizeof(Ppu));
   ppu->snes = snes;
+  ppu->renderFlags = 0;
+  ppu->lineCapture = NULL;
+  ppu->tileCache = xmalloc(kPpuTileCacheEntries * sizeof(uint64));
+  PpuInvalidateTileCache(ppu, 0, 0x8000);
   return ppu;
 }
 
 void ppu_free(Ppu* ppu) {
+  free(ppu->lineCapture);
+  free(ppu->tileCache);
   free(ppu);
 }
 
+// Drop the decoded rows that depend on the given vram words
+void PpuInvalidateTileCache(Ppu *ppu, uint32_t adr, uint32_t words) {
+  if (words >= 0x8000) {
+    memset(ppu->tileCache, 0xff, kPpuTileCacheEntries * sizeof(uint64));
+    return;
+  }
+  for (uint32 i = 0; i < words; i++)
+    ppu->tileCache[(adr + i) & 0x7fff] = kPpuTileRowInvalid;
+  // 4bpp rows also read the word 8 after their address
+  for (uint32 i = 0; i < words + 8; i++)
+    ppu->tileCache[0x8000 + ((adr - 8 + i) & 0x7fff)] = kPpuTileRowInvalid;
+}
+
+static uint32_t g_vram_serial;
+
 void ppu_copy(Ppu *ppu, Ppu *ppu_src) {
   Snes *snes = ppu->snes;
   size_t pitch = ppu->renderPitch;
   uint8_t *renderBuffer = ppu->renderBuffer;
+  uint32_t renderFlags = ppu->renderFlags;
+  uint64 *tileCache = ppu->tileCache;
+  PpuLineState *lineCapture = ppu->lineCapture;
   memcpy(ppu, ppu_src, sizeof(*ppu));
   ppu->renderBuffer = renderBuffer;
   ppu->renderPitch = (uint32_t)pitch;
+  ppu->renderFlags = renderFlags;
   ppu->snes = snes;
+  ppu->tileCache = tileCache;
+  ppu->lineCapture = lineCapture;
+  ppu->capturedLines = 0;
+  ppu->vramSerial = ++g_vram_serial;
+  PpuInvalidateTileCache(ppu, 0, 0x8000);
 }
 
 void ppu_reset(Ppu* ppu) {
@@ -122,11 +167,20 @@ void ppu_reset(Ppu* ppu) {
     Snes *snes = ppu->snes;
     size_t pitch = ppu->renderPitch;
     uint8_t *renderBuffer = ppu->renderBuffer;
+    uint32_t renderFlags = ppu->renderFlags;
+    uint64 *tileCache = ppu->tileCache;
+    PpuLineState *lineCapture = ppu->lineCapture;
     memset(ppu, 0, sizeof(*ppu));
     ppu->renderBuffer = renderBuffer;
     ppu->renderPitch = (uint32_t)pitch;
+    ppu->renderFlags = renderFlags;
     ppu->snes = snes;
+    ppu->tileCache = tileCache;
+    ppu->lineCapture = lineCapture;
   }
+  ppu->renderScale = 1;
+  ppu->vramSerial = ++g_vram_serial;
+  PpuInvalidateTileCache(ppu, 0, 0x8000);
   ppu->vramPointer = 0;
   ppu->vramIncrementOnHigh = false;
   ppu->vramIncrement = 1;
@@ -222,11 +276,45 @@ void ppu_reset(Ppu* ppu) {
 
 void ppu_saveload(Ppu *ppu, SaveLoadFunc *func, void *ctx) {
   func(ctx, &ppu->vram, offsetof(Ppu, pixelbuffer_placeholder) - offsetof(Ppu, vram));
+  ppu->paletteValid = false;
+  ppu->vramSerial = ++g_vram_serial;
+  PpuInvalidateTileCache(ppu, 0, 0x8000);
+}
+
+void PpuClearVramDirty(Ppu *ppu, uint16_t *backup) {
+  memset(ppu->vramDirty, 0, sizeof(ppu->vramDirty));
+  ppu->vramBackup = backup;
+}
+
+static inline void ppu_markVramPageDirty(Ppu *ppu, int page) {
+  if (!PpuIsVramPageDirty(ppu, page)) {
+    ppu->vramDirty[page >> 3] |= 1 << (page & 7);
+    if (ppu->vramBackup)
+      memcpy(ppu->vramBackup + page * kPpuVramPageWords, ppu->vram + page * kPpuVramPageWords, kPpuVramPageWords * sizeof(uint16_t));
+  }
+}
+
+void PpuPrepareVramWrite(Ppu *ppu, uint32_t adr, uint32_t words) {
+  if (words > 0x8000)
+    words = 0x8000;
+  for (uint32_t w = 0; w < words; w += kPpuVramPageWords - ((adr + w) & (kPpuVramPageWords - 1)))
+    ppu_markVramPageDirty(ppu, ((adr + w) & 0x7fff) / kPpuVramPageWords);
+  PpuInvalidateTileCache(ppu, adr & 0x7fff, words);
 }
 
+static inline void ppu_markVramDirty(Ppu *ppu, uint16_t adr) {
+  // The word is the 2bpp row at adr, and belongs to the 4bpp rows at adr and adr - 8
+  ppu->tileCache[adr & 0x7fff] = kPpuTileRowInvalid;
+  ppu->tileCache[0x8000 + (adr & 0x7fff)] = kPpuTileRowInvalid;
+  ppu->tileCache[0x8000 + ((adr - 8) & 0x7fff)] = kPpuTileRowInvalid;
+  ppu_markVramPageDirty(ppu, (adr & 0x7fff) / kPpuVramPageWords);
+}
+
+// |pixels| must have room for 4x4 the |pitch| * lines when kPpuRenderFlags_4x4Mode7 is set
 void PpuBeginDrawing(Ppu *ppu, uint8_t *pixels, size_t pitch, uint32_t render_flags) {
   ppu->renderPitch = (uint)pitch;
   ppu->renderBuffer = pixels;
+  ppu->renderFlags = render_flags;
 }
 
 bool ppu_checkOverscan(Ppu* ppu) {
@@ -250,6 +338,92 @@ static inline void ClearBackdrop(PpuPixelPrioBufs *buf) {
     *(uint64*)&buf->data[i] = 0x0500050005000500;
 }
 
+#define LINE_STATE_FIELDS(X) \
+  X(windowsel) X(objTileAdr1) X(objTileAdr2) X(oamAdr) X(objSize) X(objPriority) \
+  X(objInterlace) X(evenFrame) X(forcedBlank) X(brightness) X(mode) X(mosaicSize) \
+  X(mosaicEnabled) X(m7largeField) X(m7charFill) X(m7xFlip) X(m7yFlip) \
+  X(window1left) X(window1right) X(window2left) X(window2right) X(clipMode) \
+  X(preventMathMode) X(addSubscreen) X(subtractColor) X(halfColor) \
+  X(fixedColorR) X(fixedColorG) X(fixedColorB) X(extraLeftCur) X(extraRightCur)
+#define LINE_STATE_ARRAYS(X) \
+  X(bgLayer) X(m7matrix) X(screenEnabled) X(screenWindowed) X(mathEnabled)
+
+static void PpuSaveLineState(const Ppu *ppu, PpuLineState *ls) {
+#define X(f) ls->f = ppu->f;
+  LINE_STATE_FIELDS(X)
+#undef X
+#define X(f) memcpy(ls->f, ppu->f, sizeof(ls->f));
+  LINE_STATE_ARRAYS(X)
+#undef X
+}
+
+static void PpuLoadLineState(Ppu *ppu, const PpuLineState *ls) {
+#define X(f) ppu->f = ls->f;
+  LINE_STATE_FIELDS(X)
+#undef X
+#define X(f) memcpy(ppu->f, ls->f, sizeof(ls->f));
+  LINE_STATE_ARRAYS(X)
+#undef X
+}
+
+void PpuSetLineCapture(Ppu *ppu, bool enable) {
+  if (enable && !ppu->lineCapture) {
+    ppu->lineCapture = xmalloc(sizeof(PpuLineState) * kPpuMaxLines);
+  } else if (!enable) {
+    free(ppu->lineCapture);
+    ppu->lineCapture = NULL;
+  }
+  ppu->capturedLines = 0;
+}
+
+// Move the lines captured since the last call into |frame|, together with a
+// copy of vram, cgram and oam. Returns false if there was nothing captured.
+bool PpuFinishLineCapture(Ppu *ppu, PpuCapturedFrame *frame) {
+  int n = ppu->capturedLines;
+  if (n == 0)
+    return false;
+  memcpy(frame->vram, ppu->vram, sizeof(frame->vram));
+  memcpy(frame->cgram, ppu->cgram, sizeof(frame->cgram));
+  memcpy(frame->oam, ppu->oam, sizeof(frame->oam));
+  memcpy(frame->highOam, ppu->highOam, sizeof(frame->highOam));
+  frame->renderBuffer = ppu->renderBuffer;
+  frame->renderPitch = ppu->renderPitch;
+  frame->renderFlags = ppu->renderFlags;
+  frame->renderScale = ppu->renderScale;
+  frame->extraLeftRight = ppu->extraLeftRight;
+  frame->numLines = n;
+  memcpy(&frame->lines[1], &ppu->lineCapture[1], sizeof(PpuLineState) * n);
+  ppu->capturedLines = 0;
+  return true;
+}
+
+// Draw lines first, first + step, ... of a captured frame. |ppu| is a private
+// ppu for the calling thread, so several threads can draw the same frame.
+void PpuDrawCapturedLines(Ppu *ppu, const PpuCapturedFrame *frame, int first, int step) {
+  // Only replace the vram pages that differ, to keep the tile cache warm.
+  for (int page = 0; page < kPpuVramPages; page++) {
+    size_t offs = page * kPpuVramPageWords, size = kPpuVramPageWords * sizeof(uint16);
+    if (memcmp(&ppu->vram[offs], &frame->vram[offs], size) != 0) {
+      memcpy(&ppu->vram[offs], &frame->vram[offs], size);
+      PpuInvalidateTileCache(ppu, offs, kPpuVramPageWords);
+    }
+  }
+  memcpy(ppu->cgram, frame->cgram, sizeof(ppu->cgram));
+  ppu->paletteValid = false;
+  memcpy(ppu->oam, frame->oam, sizeof(ppu->oam));
+  memcpy(ppu->highOam, frame->highOam, sizeof(ppu->highOam));
+  ppu->spriteBinsKey = 0;
+  ppu->renderBuffer = frame->renderBuffer;
+  ppu->renderPitch = frame->renderPitch;
+  ppu->renderFlags = frame->renderFlags;
+  ppu->renderScale = frame->renderScale;
+  ppu->extraLeftRight = frame->extraLeftRight;
+  for (int line = first; line <= frame->numLines; line += step) {
+    PpuLoadLineState(ppu, &frame->lines[line]);
+    PpuRenderLine(ppu, line);
+  }
+}
+
 void ppu_runLine(Ppu* ppu, int line) {
   if(line == 0) {
     // pre-render line
@@ -258,30 +432,46 @@ void ppu_runLine(Ppu* ppu, int line) {
     ppu->rangeOver = false;
     ppu->timeOver = false;
     ppu->evenFrame = !ppu->evenFrame;
-  } else {  
-    // Cache the brightness computation
-    if (ppu->brightness != ppu->lastBrightnessMult) {
-      uint8_t ppu_brightness = ppu->brightness;
-      ppu->lastBrightnessMult = ppu_brightness;
-      for (int i = 0; i < 32; i++)
-        ppu->brightnessMultHalf[i * 2] = ppu->brightnessMultHalf[i * 2 + 1] = ppu->brightnessMult[i] =
-        ((i << 3) | (i >> 2)) * ppu_brightness / 15;
-      // Store 31 extra entries to remove the need for clamping to 31.
-      memset(&ppu->brightnessMult[32], ppu->brightnessMult[31], 31);
-    }
-
-    // evaluate sprites
-    ClearBackdrop(&ppu->objBuffer);
-    ppu->lineHasSprites = !ppu->forcedBlank && ppu_evaluateSprites(ppu, line - 1);
-
-    if (g_new_ppu) {
-      PpuDrawWholeLine(ppu, line);
-    } else {
-      // actual line
-      if (ppu->mode == 7) ppu_calculateMode7Starts(ppu, line);
-      for (int x = 0; x < 256; x++) {
-        ppu_handlePixel(ppu, x, line);
-      }
+    // Oam is final here, rebuild the sprite bins on the first visible line
+    ppu->spriteBinsKey = 0;
+    // Render the whole frame upscaled if it or the previous one uses mode 7
+    ppu->renderScale = g_new_ppu && (ppu->renderFlags & kPpuRenderFlags_4x4Mode7) &&
+      (ppu->mode == 7 || ppu->frameHasMode7) ? 4 : 1;
+    ppu->frameHasMode7 = false;
+  } else if (ppu->lineCapture && g_new_ppu) {
+    if (ppu->mode == 7)
+      ppu->frameHasMode7 = true;
+    PpuSaveLineState(ppu, &ppu->lineCapture[line]);
+    ppu->capturedLines = line;
+  } else {
+    PpuRenderLine(ppu, line);
+  }
+}
+
+static void PpuRenderLine(Ppu *ppu, int line) {
+  // Cache the brightness computation
+  if (ppu->brightness != ppu->lastBrightnessMult) {
+    uint8_t ppu_brightness = ppu->brightness;
+    ppu->lastBrightnessMult = ppu_brightness;
+    for (int i = 0; i < 32; i++)
+      ppu->brightnessMultHalf[i * 2] = ppu->brightnessMultHalf[i * 2 + 1] = ppu->brightnessMult[i] =
+      ((i << 3) | (i >> 2)) * ppu_brightness / 15;
+    // Store 31 extra entries to remove the need for clamping to 31.
+    memset(&ppu->brightnessMult[32], ppu->brightnessMult[31], 31);
+    ppu->paletteValid = false;
+  }
+
+  // evaluate sprites
+  ClearBackdrop(&ppu->objBuffer);
+  ppu->lineHasSprites = !ppu->forcedBlank && ppu_evaluateSprites(ppu, line - 1);
+
+  if (g_new_ppu) {
+    PpuDrawWholeLine(ppu, line);
+  } else {
+    // actual line
+    if (ppu->mode == 7) ppu_calculateMode7Starts(ppu, line);
+    for (int x = 0; x < 256; x++) {
+      ppu_handlePixel(ppu, x, line);
     }
   }
 }
@@ -360,114 +550,69 @@ static void PpuWindows_Calc(PpuWindows *win, Ppu *ppu, uint layer) {
   win->bits = w1_bits | w2_bits;
 }
 
-// Draw a whole line of a 4bpp background layer into bgBuffers
-static void PpuDrawBackground_4bpp(Ppu *ppu, uint y, bool sub, uint layer, PpuZbufType zhi, PpuZbufType zlo) {
-#define DO_PIXEL(i) do { \
-  pixel = ((bits >> i) & 1) | ((bits >> (7 + i)) & 2) | ((bits >> (14 + i)) & 4) | ((bits >> (21 + i)) & 8); \
-  if ((bits & (0x01010101 << i)) && z > dstz[i]) dstz[i] = z + pixel; } while (0)
-#define DO_PIXEL_HFLIP(i) do { \
-  pixel = ((bits >> (7 - i)) & 1) | ((bits >> (14 - i)) & 2) | ((bits >> (21 - i)) & 4) | ((bits >> (28 - i)) & 8); \
-  if ((bits & (0x80808080 >> i)) && z > dstz[i]) dstz[i] = z + pixel; } while (0)
-#define READ_BITS(ta, tile) (addr = &ppu->vram[((ta) + (tile) * 16) & 0x7fff], addr[0] | addr[8] << 16)
-  enum { kPaletteShift = 6 };
-  if (!IS_SCREEN_ENABLED(ppu, sub, layer))
-    return;  // layer is completely hidden
-  PpuWindows win;
-  IS_SCREEN_WINDOWED(ppu, sub, layer) ? PpuWindows_Calc(&win, ppu, layer) : PpuWindows_Clear(&win, ppu, layer);
-  BgLayer *bglayer = &ppu->bgLayer[layer];
-  y += bglayer->vScroll;
-  int sc_offs = bglayer->tilemapAdr + (((y >> 3) & 0x1f) << 5);
-  if ((y & 0x100) && bglayer->tilemapHigher)
-    sc_offs += bglayer->tilemapWider ? 0x800 : 0x400;
-  const uint16 *tps[2] = {
-    &ppu->vram[sc_offs & 0x7fff],
-    &ppu->vram[(sc_offs + (bglayer->tilemapWider ? 0x400 : 0)) & 0x7fff]
-  };
-  int tileadr = ppu->bgLayer[layer].tileAdr, pixel;
-  int tileadr1 = tileadr + 7 - (y & 0x7), tileadr0 = tileadr + (y & 0x7);
-  const uint16 *addr;
-  for (size_t windex = 0; windex < win.nr; windex++) {
-    if (win.bits & (1 << windex))
-      continue;  // layer is disabled for this window part
-    uint x = win.edges[windex] + bglayer->hScroll;
-    uint w = win.edges[windex + 1] - win.edges[windex];
-    PpuZbufType *dstz = ppu->bgBuffers[sub].data + win.edges[windex] + kPpuExtraLeftRight;
-    const uint16 *tp = tps[x >> 8 & 1] + ((x >> 3) & 0x1f);
-    const uint16 *tp_last = tps[x >> 8 & 1] + 31;
-    const uint16 *tp_next = tps[(x >> 8 & 1) ^ 1];
-#define NEXT_TP() if (tp != tp_last) tp += 1; else tp = tp_next, tp_next = tp_last - 31, tp_last = tp + 31;
-    // Handle clipped pixels on left side
-    if (x & 7) {
-      int curw = IntMin(8 - (x & 7), w);
-      w -= curw;
-      uint32 tile = *tp;
-      NEXT_TP();
-      int ta = (tile & 0x8000) ? tileadr1 : tileadr0;
-      PpuZbufType z = (tile & 0x2000) ? zhi : zlo;
-      uint32 bits = READ_BITS(ta, tile & 0x3ff);
-      if (bits) {
-        z += ((tile & 0x1c00) >> kPaletteShift);
-        if (tile & 0x4000) {
-          bits >>= (x & 7), x += curw;
-          do DO_PIXEL(0); while (bits >>= 1, dstz++, --curw);
-        } else {
-          bits <<= (x & 7), x += curw;
-          do DO_PIXEL_HFLIP(0); while (bits <<= 1, dstz++, --curw);
-        }
-      } else {
-        dstz += curw;
-      }
-    }
-    // Handle full tiles in the middle
-    while (w >= 8) {
-      uint32 tile = *tp;
-      NEXT_TP();
-      int ta = (tile & 0x8000) ? tileadr1 : tileadr0;
-      PpuZbufType z = (tile & 0x2000) ? zhi : zlo;
-      uint32 bits = READ_BITS(ta, tile & 0x3ff);
-      if (bits) {
-        z += ((tile & 0x1c00) >> kPaletteShift);
-        if (tile & 0x4000) {
-          DO_PIXEL(0); DO_PIXEL(1); DO_PIXEL(2); DO_PIXEL(3);
-          DO_PIXEL(4); DO_PIXEL(5); DO_PIXEL(6); DO_PIXEL(7);
-        } else {
-          DO_PIXEL_HFLIP(0); DO_PIXEL_HFLIP(1); DO_PIXEL_HFLIP(2); DO_PIXEL_HFLIP(3);
-          DO_PIXEL_HFLIP(4); DO_PIXEL_HFLIP(5); DO_PIXEL_HFLIP(6); DO_PIXEL_HFLIP(7);
-        }
-      }
-      dstz += 8, w -= 8;
-    }
-    // Handle remaining clipped part
-    if (w) {
-      uint32 tile = *tp;
-      int ta = (tile & 0x8000) ? tileadr1 : tileadr0;
-      PpuZbufType z = (tile & 0x2000) ? zhi : zlo;
-      uint32 bits = READ_BITS(ta, tile & 0x3ff);
-      if (bits) {
-        z += ((tile & 0x1c00) >> kPaletteShift);
-        if (tile & 0x4000) {
-          do DO_PIXEL(0); while (bits >>= 1, dstz++, --w);
-        } else {
-          do DO_PIXEL_HFLIP(0); while (bits <<= 1, dstz++, --w);
-        }
-      }
-    }
+// Decode one tile row into 8 pixel indices, byte i holds the pixel for x = i
+// of an unflipped tile. 4bpp rows read their second plane pair 8 words later.
+static uint64 PpuDecodeTileRow(const uint16 *vram, uint32 adr, int bpp) {
+  uint32 planes = vram[adr & 0x7fff] | (bpp == 4 ? vram[(adr + 8) & 0x7fff] << 16 : 0);
+  uint64 row = 0;
+  for (int i = 0; i < 8; i++) {
+    uint32 bits = planes >> (7 - i);
+    row |= (uint64)((bits & 1) | (bits >> 7 & 2) | (bits >> 14 & 4) | (bits >> 21 & 8)) << (i * 8);
   }
-#undef READ_BITS
-#undef DO_PIXEL
-#undef DO_PIXEL_HFLIP
+  return row;
 }
 
-// Draw a whole line of a 2bpp background layer into bgBuffers
-static void PpuDrawBackground_2bpp(Ppu *ppu, uint y, bool sub, uint layer, PpuZbufType zhi, PpuZbufType zlo) {
-#define DO_PIXEL(i) do { \
-  pixel = ((bits >> i) & 1) | ((bits >> (7 + i)) & 2); \
-  if (pixel && z > dstz[i]) dstz[i] = z + pixel; } while (0)
-#define DO_PIXEL_HFLIP(i) do { \
-  pixel = ((bits >> (7 - i)) & 1) | ((bits >> (14 - i)) & 2); \
-  if (pixel && z > dstz[i]) dstz[i] = z + pixel; } while (0)
-#define READ_BITS(ta, tile) (addr = &ppu->vram[((ta) + (tile) * 8) & 0x7fff], addr[0])
-  enum { kPaletteShift = 8 };
+static FORCEINLINE uint64 PpuGetTileRow(Ppu *ppu, uint32 adr, int bpp) {
+  uint64 *ent = &ppu->tileCache[(bpp == 4 ? 0x8000 : 0) + (adr & 0x7fff)];
+  uint64 row = *ent;
+  if (row == kPpuTileRowInvalid)
+    *ent = row = PpuDecodeTileRow(ppu->vram, adr, bpp);
+  return row;
+}
+
+static FORCEINLINE uint64 PpuFlipTileRow(uint64 row) {
+#if defined(_MSC_VER)
+  return _byteswap_uint64(row);
+#else
+  return __builtin_bswap64(row);
+#endif
+}
+
+// Draw one full 8 pixel tile row of decoded pixel indices. Writes z + pixel
+// for each opaque pixel where z is above the current z value.
+static FORCEINLINE void PpuDrawTileRow(PpuZbufType *dstz, uint64 pixels, PpuZbufType z) {
+#if defined(PPU_SIMD_SSE2)
+  __m128i pixel = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)&pixels), _mm_setzero_si128());
+  // SSE2 only has signed 16-bit compares, so bias both sides.
+  __m128i bias = _mm_set1_epi16(-0x8000);
+  __m128i zv = _mm_set1_epi16((int16)z);
+  __m128i old = _mm_loadu_si128((const __m128i *)dstz);
+  __m128i take = _mm_andnot_si128(_mm_cmpeq_epi16(pixel, _mm_setzero_si128()),
+                                  _mm_cmpgt_epi16(_mm_xor_si128(zv, bias), _mm_xor_si128(old, bias)));
+  __m128i val = _mm_add_epi16(zv, pixel);
+  _mm_storeu_si128((__m128i *)dstz, _mm_or_si128(_mm_and_si128(take, val), _mm_andnot_si128(take, old)));
+#elif defined(PPU_SIMD_NEON)
+  uint16x8_t pixel = vmovl_u8(vcreate_u8(pixels));
+  uint16x8_t zv = vdupq_n_u16(z);
+  uint16x8_t old = vld1q_u16(dstz);
+  uint16x8_t take = vandq_u16(vtstq_u16(pixel, pixel), vcgtq_u16(zv, old));
+  vst1q_u16(dstz, vbslq_u16(take, vaddq_u16(zv, pixel), old));
+#else
+  for (int i = 0; i < 8; i++) {
+    uint32 pixel = (pixels >> (i * 8)) & 0xff;
+    if (pixel && z > dstz[i])
+      dstz[i] = z + pixel;
+  }
+#endif
+}
+
+// Draw a whole line of a 4bpp or 2bpp background layer into bgBuffers
+static FORCEINLINE void PpuDrawBackground_Tiled(Ppu *ppu, uint y, bool sub, uint layer, PpuZbufType zhi, PpuZbufType zlo, int bpp) {
+#define DO_PIXEL() do { \
+  pixel = row & 0xff; \
+  if (pixel && z > dstz[0]) dstz[0] = z + pixel; } while (0)
+#define READ_ROW(ta, tile) PpuGetTileRow(ppu, (ta) + (tile) * 4 * bpp, bpp)
+  int palette_shift = (bpp == 4) ? 6 : 8;
   if (!IS_SCREEN_ENABLED(ppu, sub, layer))
     return;  // layer is completely hidden
   PpuWindows win;
@@ -483,8 +628,6 @@ static void PpuDrawBackground_2bpp(Ppu *ppu, uint y, bool sub, uint layer, PpuZb
   };
   int tileadr = ppu->bgLayer[layer].tileAdr, pixel;
   int tileadr1 = tileadr + 7 - (y & 0x7), tileadr0 = tileadr + (y & 0x7);
-
-  const uint16 *addr;
   for (size_t windex = 0; windex < win.nr; windex++) {
     if (win.bits & (1 << windex))
       continue;  // layer is disabled for this window part
@@ -494,7 +637,6 @@ static void PpuDrawBackground_2bpp(Ppu *ppu, uint y, bool sub, uint layer, PpuZb
     const uint16 *tp = tps[x >> 8 & 1] + ((x >> 3) & 0x1f);
     const uint16 *tp_last = tps[x >> 8 & 1] + 31;
     const uint16 *tp_next = tps[(x >> 8 & 1) ^ 1];
-
 #define NEXT_TP() if (tp != tp_last) tp += 1; else tp = tp_next, tp_next = tp_last - 31, tp_last = tp + 31;
     // Handle clipped pixels on left side
     if (x & 7) {
@@ -504,16 +646,13 @@ static void PpuDrawBackground_2bpp(Ppu *ppu, uint y, bool sub, uint layer, PpuZb
       NEXT_TP();
       int ta = (tile & 0x8000) ? tileadr1 : tileadr0;
       PpuZbufType z = (tile & 0x2000) ? zhi : zlo;
-      uint32 bits = READ_BITS(ta, tile & 0x3ff);
-      if (bits) {
-        z += ((tile & 0x1c00) >> kPaletteShift);
-        if (tile & 0x4000) {
-          bits >>= (x & 7), x += curw;
-          do DO_PIXEL(0); while (bits >>= 1, dstz++, --curw);
-        } else {
-          bits <<= (x & 7), x += curw;
-          do DO_PIXEL_HFLIP(0); while (bits <<= 1, dstz++, --curw);
-        }
+      uint64 row = READ_ROW(ta, tile & 0x3ff);
+      if (row) {
+        z += ((tile & 0x1c00) >> palette_shift);
+        if (tile & 0x4000)
+          row = PpuFlipTileRow(row);
+        row >>= (x & 7) * 8;
+        do DO_PIXEL(); while (row >>= 8, dstz++, --curw);
       } else {
         dstz += curw;
       }
@@ -524,17 +663,9 @@ static void PpuDrawBackground_2bpp(Ppu *ppu, uint y, bool sub, uint layer, PpuZb
       NEXT_TP();
       int ta = (tile & 0x8000) ? tileadr1 : tileadr0;
       PpuZbufType z = (tile & 0x2000) ? zhi : zlo;
-      uint32 bits = READ_BITS(ta, tile & 0x3ff);
-      if (bits) {
-        z += ((tile & 0x1c00) >> kPaletteShift);
-        if (tile & 0x4000) {
-          DO_PIXEL(0); DO_PIXEL(1); DO_PIXEL(2); DO_PIXEL(3);
-          DO_PIXEL(4); DO_PIXEL(5); DO_PIXEL(6); DO_PIXEL(7);
-        } else {
-          DO_PIXEL_HFLIP(0); DO_PIXEL_HFLIP(1); DO_PIXEL_HFLIP(2); DO_PIXEL_HFLIP(3);
-          DO_PIXEL_HFLIP(4); DO_PIXEL_HFLIP(5); DO_PIXEL_HFLIP(6); DO_PIXEL_HFLIP(7);
-        }
-      }
+      uint64 row = READ_ROW(ta, tile & 0x3ff);
+      if (row)
+        PpuDrawTileRow(dstz, (tile & 0x4000) ? PpuFlipTileRow(row) : row, z + ((tile & 0x1c00) >> palette_shift));
       dstz += 8, w -= 8;
     }
     // Handle remaining clipped part
@@ -542,31 +673,30 @@ static void PpuDrawBackground_2bpp(Ppu *ppu, uint y, bool sub, uint layer, PpuZb
       uint32 tile = *tp;
       int ta = (tile & 0x8000) ? tileadr1 : tileadr0;
       PpuZbufType z = (tile & 0x2000) ? zhi : zlo;
-      uint32 bits = READ_BITS(ta, tile & 0x3ff);
-      if (bits) {
-        z += ((tile & 0x1c00) >> kPaletteShift);
-        if (tile & 0x4000) {
-          do DO_PIXEL(0); while (bits >>= 1, dstz++, --w);
-        } else {
-          do DO_PIXEL_HFLIP(0); while (bits <<= 1, dstz++, --w);
-        }
+      uint64 row = READ_ROW(ta, tile & 0x3ff);
+      if (row) {
+        z += ((tile & 0x1c00) >> palette_shift);
+        if (tile & 0x4000)
+          row = PpuFlipTileRow(row);
+        do DO_PIXEL(); while (row >>= 8, dstz++, --w);
       }
     }
   }
 #undef NEXT_TP
-#undef READ_BITS
+#undef READ_ROW
 #undef DO_PIXEL
-#undef DO_PIXEL_HFLIP
 }
 
-// Assumes it's drawn on an empty backdrop
-static void PpuDrawBackground_mode7(Ppu *ppu, uint y, bool sub, PpuZbufType z) {
-  int layer = 0;
-  if (!IS_SCREEN_ENABLED(ppu, sub, layer))
-    return;  // layer is completely hidden
-  PpuWindows win;
-  IS_SCREEN_WINDOWED(ppu, sub, layer) ? PpuWindows_Calc(&win, ppu, layer) : PpuWindows_Clear(&win, ppu, layer);
+static void PpuDrawBackground_4bpp(Ppu *ppu, uint y, bool sub, uint layer, PpuZbufType zhi, PpuZbufType zlo) {
+  PpuDrawBackground_Tiled(ppu, y, sub, layer, zhi, zlo, 4);
+}
 
+static void PpuDrawBackground_2bpp(Ppu *ppu, uint y, bool sub, uint layer, PpuZbufType zhi, PpuZbufType zlo) {
+  PpuDrawBackground_Tiled(ppu, y, sub, layer, zhi, zlo, 2);
+}
+
+// Compute the mode 7 texture position of the left edge of line |y|
+static void PpuCalcMode7Start(Ppu *ppu, uint y, uint32 *start_x, uint32 *start_y) {
   // expand 13-bit values to signed values
   int hScroll = ((int16_t)(ppu->m7matrix[6] << 3)) >> 3;
   int vScroll = ((int16_t)(ppu->m7matrix[7] << 3)) >> 3;
@@ -576,14 +706,25 @@ static void PpuDrawBackground_mode7(Ppu *ppu, uint y, bool sub, PpuZbufType z) {
   int clippedV = vScroll - yCenter;
   clippedH = (clippedH & 0x2000) ? (clippedH | ~1023) : (clippedH & 1023);
   clippedV = (clippedV & 0x2000) ? (clippedV | ~1023) : (clippedV & 1023);
-  bool mosaic_enabled = IS_MOSAIC_ENABLED(ppu, 0);
-  if (mosaic_enabled)
-    y = ppu->mosaicModulo[y];
   uint32 ry = ppu->m7yFlip ? 255 - y : y;
-  uint32 m7startX = (ppu->m7matrix[0] * clippedH & ~63) + (ppu->m7matrix[1] * ry & ~63) +
+  *start_x = (ppu->m7matrix[0] * clippedH & ~63) + (ppu->m7matrix[1] * ry & ~63) +
     (ppu->m7matrix[1] * clippedV & ~63) + (xCenter << 8);
-  uint32 m7startY = (ppu->m7matrix[2] * clippedH & ~63) + (ppu->m7matrix[3] * ry & ~63) +
+  *start_y = (ppu->m7matrix[2] * clippedH & ~63) + (ppu->m7matrix[3] * ry & ~63) +
     (ppu->m7matrix[3] * clippedV & ~63) + (yCenter << 8);
+}
+
+// Assumes it's drawn on an empty backdrop
+static void PpuDrawBackground_mode7(Ppu *ppu, uint y, bool sub, PpuZbufType z) {
+  int layer = 0;
+  if (!IS_SCREEN_ENABLED(ppu, sub, layer))
+    return;  // layer is completely hidden
+  PpuWindows win;
+  IS_SCREEN_WINDOWED(ppu, sub, layer) ? PpuWindows_Calc(&win, ppu, layer) : PpuWindows_Clear(&win, ppu, layer);
+  bool mosaic_enabled = IS_MOSAIC_ENABLED(ppu, 0);
+  if (mosaic_enabled)
+    y = ppu->mosaicModulo[y];
+  uint32 m7startX, m7startY;
+  PpuCalcMode7Start(ppu, y, &m7startX, &m7startY);
   for (size_t windex = 0; windex < win.nr; windex++) {
     if (win.bits & (1 << windex))
       continue;  // layer is disabled for this window part
@@ -631,6 +772,96 @@ static void PpuDrawBackground_mode7(Ppu *ppu, uint y, bool sub, PpuZbufType z) {
   }
 }
 
+// Draw sub row |subrow| of a mode 7 line at 4x4 resolution, into a buffer that
+// holds 4 entries per pixel. The matrix is evaluated at every quarter pixel.
+// Assumes it's drawn on an empty backdrop, and that mosaic is off.
+static void PpuDrawBackground_mode7Upsampled(Ppu *ppu, uint y, uint subrow, bool sub, PpuZbufType z, PpuZbufType *zbuf) {
+  int layer = 0;
+  if (!IS_SCREEN_ENABLED(ppu, sub, layer))
+    return;  // layer is completely hidden
+  PpuWindows win;
+  IS_SCREEN_WINDOWED(ppu, sub, layer) ? PpuWindows_Calc(&win, ppu, layer) : PpuWindows_Clear(&win, ppu, layer);
+  uint32 m7startX, m7startY;
+  PpuCalcMode7Start(ppu, y, &m7startX, &m7startY);
+  // Positions have 2 extra fraction bits, so one step is a quarter pixel.
+  int ystep = ppu->m7yFlip ? -(int)subrow : (int)subrow;
+  for (size_t windex = 0; windex < win.nr; windex++) {
+    if (win.bits & (1 << windex))
+      continue;  // layer is disabled for this window part
+    int x = win.edges[windex], x2 = win.edges[windex + 1], tile;
+    PpuZbufType *dstz = zbuf + (x + kPpuExtraLeftRight) * 4;
+    PpuZbufType *dstz_end = zbuf + (x2 + kPpuExtraLeftRight) * 4;
+    uint32 rx = ppu->m7xFlip ? 255 - x : x;
+    uint32 xpos = (m7startX + ppu->m7matrix[0] * rx) * 4 + ppu->m7matrix[1] * ystep;
+    uint32 ypos = (m7startY + ppu->m7matrix[2] * rx) * 4 + ppu->m7matrix[3] * ystep;
+    uint32 dx = ppu->m7xFlip ? -ppu->m7matrix[0] : ppu->m7matrix[0];
+    uint32 dy = ppu->m7xFlip ? -ppu->m7matrix[2] : ppu->m7matrix[2];
+    uint32 outside_value = ppu->m7largeField ? 0x3ffff : 0xffffffff;
+    bool char_fill = ppu->m7charFill;
+    do {
+      if ((uint32)((int32)xpos >> 2 | (int32)ypos >> 2) > outside_value) {
+        if (!char_fill)
+          continue;
+        tile = 0;
+      } else {
+        tile = ppu->vram[(ypos >> 13 & 0x7f) * 128 + (xpos >> 13 & 0x7f)] & 0xff;
+      }
+      uint8 pixel = ppu->vram[tile * 64 + (ypos >> 10 & 7) * 8 + (xpos >> 10 & 7)] >> 8;
+      if (pixel)
+        dstz[0] = pixel + z;
+    } while (xpos += dx, ypos += dy, ++dstz != dstz_end);
+  }
+}
+
+// Merge the sprite line into a buffer with 4 entries per pixel
+static void PpuDrawSpritesUpsampled(Ppu *ppu, uint sub, PpuZbufType *zbuf) {
+  int layer = 4;
+  if (!IS_SCREEN_ENABLED(ppu, sub, layer))
+    return;  // layer is completely hidden
+  PpuWindows win;
+  IS_SCREEN_WINDOWED(ppu, sub, layer) ? PpuWindows_Calc(&win, ppu, layer) : PpuWindows_Clear(&win, ppu, layer);
+  for (size_t windex = 0; windex < win.nr; windex++) {
+    if (win.bits & (1 << windex))
+      continue;  // layer is disabled for this window part
+    for (int x = win.edges[windex] + kPpuExtraLeftRight; x < win.edges[windex + 1] + kPpuExtraLeftRight; x++) {
+      PpuZbufType src = ppu->objBuffer.data[x], *dst = zbuf + x * 4;
+      for (int i = 0; i < 4; i++) {
+        if (src > dst[i])
+          dst[i] = src;
+      }
+    }
+  }
+}
+
+// Compose sub row |subrow| of a mode 7 line into mode7Buffers[sub]
+static void PpuDrawMode7Upsampled(Ppu *ppu, uint y, uint subrow, bool sub) {
+  PpuZbufType *zbuf = ppu->mode7Buffers[sub];
+  for (size_t i = 0; i != arraysize(ppu->mode7Buffers[sub]); i += 4)
+    *(uint64*)&zbuf[i] = 0x0500050005000500;
+  PpuDrawBackground_mode7Upsampled(ppu, y, subrow, sub, 0x5000, zbuf);
+  if (ppu->lineHasSprites)
+    PpuDrawSpritesUpsampled(ppu, sub, zbuf);
+}
+
+// dst = max(dst, src) for |width| z values
+static void PpuMergeZbuf(PpuZbufType *dst, const PpuZbufType *src, int width) {
+  int i = 0;
+#if defined(PPU_SIMD_SSE2)
+  // No unsigned 16-bit max in SSE2; saturating subtract gives the same result.
+  for (; i + 8 <= width; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_add_epi16(a, _mm_subs_epu16(b, a)));
+  }
+#elif defined(PPU_SIMD_NEON)
+  for (; i + 8 <= width; i += 8)
+    vst1q_u16(dst + i, vmaxq_u16(vld1q_u16(dst + i), vld1q_u16(src + i)));
+#endif
+  for (; i < width; i++) {
+    if (src[i] > dst[i])
+      dst[i] = src[i];
+  }
+}
 
 static void PpuDrawSprites(Ppu *ppu, uint y, uint sub, bool clear_backdrop) {
   int layer = 4;
@@ -648,10 +879,7 @@ static void PpuDrawSprites(Ppu *ppu, uint y, uint sub, bool clear_backdrop) {
     if (clear_backdrop) {
       memcpy(dst, src, width * sizeof(uint16));
     } else {
-      do {
-        if (src[0] > dst[0])
-          dst[0] = src[0];
-      } while (src++, dst++, --width);
+      PpuMergeZbuf(dst, src, width);
     }
   }
 }
@@ -698,19 +926,122 @@ static void PpuDrawBackgrounds(Ppu *ppu, int y, bool sub) {
   }
 }
 
+static void PpuUpdatePalette(Ppu *ppu) {
+  for (int i = 0; i < 256; i++) {
+    uint32 color = ppu->cgram[i];
+    ppu->palette[i] = ppu->brightnessMult[color & 0x1f] << 16 |
+      ppu->brightnessMult[(color >> 5) & 0x1f] << 8 |
+      ppu->brightnessMult[(color >> 10) & 0x1f];
+  }
+  ppu->paletteValid = true;
+}
+
+#if defined(PPU_SIMD_SSE2)
+// One 5 bit color channel of 8 pixels through add/sub, halving and brightness
+static FORCEINLINE __m128i PpuColorMathChannel(__m128i a, __m128i b, __m128i half, bool subtract, __m128i bright) {
+  __m128i v = subtract ? _mm_subs_epu16(a, b) : _mm_add_epi16(a, b);
+  v = _mm_or_si128(_mm_and_si128(half, _mm_srli_epi16(v, 1)), _mm_andnot_si128(half, _mm_min_epi16(v, _mm_set1_epi16(31))));
+  v = _mm_mullo_epi16(_mm_or_si128(_mm_slli_epi16(v, 3), _mm_srli_epi16(v, 2)), bright);
+  return _mm_srli_epi16(_mm_mulhi_epu16(v, _mm_set1_epi16((short)0x8889)), 3);
+}
+#endif
+
+#if defined(PPU_SIMD_SSE2) || defined(PPU_SIMD_NEON)
+// Color math for as many whole groups of 8 pixels as fit in n, returns the
+// number of pixels written. Matches the scalar loop in PpuDrawWholeLine, the
+// brightness tables are replaced by computing ((c << 3) | (c >> 2)) * b / 15,
+// where the division is done as a multiply by 0x8889 and a shift by 19.
+static uint32 PpuColorMathSimd(Ppu *ppu, uint32 *dst, const PpuZbufType *main_buf, const PpuZbufType *sub_buf,
+                               uint32 n, uint32 math_enabled_cur, uint32 clip_color_mask, uint32 fixed_color) {
+  uint16 layers[16];
+  int num_layers = 0;
+  for (int l = 0; l < 16; l++)
+    if (math_enabled_cur & (1 << l))
+      layers[num_layers++] = l;
+  bool add_subscreen = (math_enabled_cur & 0x100) != 0, subtract = (math_enabled_cur & 0x200) != 0;
+  uint16 clip = clip_color_mask ? 0x7fff : 0;
+  uint16 c1s[8], c2s[8];
+  uint32 i = 0;
+#if defined(PPU_SIMD_SSE2)
+  __m128i ch_mask = _mm_set1_epi16(0x1f), bright = _mm_set1_epi16(ppu->brightness);
+  __m128i zero = _mm_setzero_si128();
+  __m128i half_ena = _mm_set1_epi16(ppu->halfColor ? -1 : 0);
+#endif
+  for (; i + 8 <= n; i += 8, dst += 8) {
+    for (int k = 0; k < 8; k++) {
+      uint32 m = main_buf[i + k], s = sub_buf[i + k] & 0xff;
+      c1s[k] = ppu->cgram[m & 0xff] & clip;
+      c2s[k] = (add_subscreen && s != 0) ? ppu->cgram[s] : fixed_color;
+    }
+#if defined(PPU_SIMD_SSE2)
+    __m128i main_layer = _mm_and_si128(_mm_srli_epi16(_mm_loadu_si128((const __m128i *)(main_buf + i)), 8), _mm_set1_epi16(0xf));
+    __m128i math = zero;
+    for (int l = 0; l < num_layers; l++)
+      math = _mm_or_si128(math, _mm_cmpeq_epi16(main_layer, _mm_set1_epi16(layers[l])));
+    // Halve unless the subscreen is backdrop
+    __m128i half = _mm_and_si128(math, half_ena);
+    if (add_subscreen) {
+      __m128i sub_color = _mm_and_si128(_mm_loadu_si128((const __m128i *)(sub_buf + i)), _mm_set1_epi16(0xff));
+      half = _mm_andnot_si128(_mm_cmpeq_epi16(sub_color, zero), half);
+    }
+    __m128i c1 = _mm_loadu_si128((const __m128i *)c1s);
+    __m128i c2 = _mm_and_si128(_mm_loadu_si128((const __m128i *)c2s), math);
+    __m128i r = PpuColorMathChannel(_mm_and_si128(c1, ch_mask), _mm_and_si128(c2, ch_mask), half, subtract, bright);
+    __m128i g = PpuColorMathChannel(_mm_and_si128(_mm_srli_epi16(c1, 5), ch_mask),
+                                    _mm_and_si128(_mm_srli_epi16(c2, 5), ch_mask), half, subtract, bright);
+    __m128i b = PpuColorMathChannel(_mm_and_si128(_mm_srli_epi16(c1, 10), ch_mask),
+                                    _mm_and_si128(_mm_srli_epi16(c2, 10), ch_mask), half, subtract, bright);
+    __m128i lo = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(lo, r));
+    _mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi16(lo, r));
+#else
+    uint16x8_t main_layer = vandq_u16(vshrq_n_u16(vld1q_u16(main_buf + i), 8), vdupq_n_u16(0xf));
+    uint16x8_t math = vdupq_n_u16(0);
+    for (int l = 0; l < num_layers; l++)
+      math = vorrq_u16(math, vceqq_u16(main_layer, vdupq_n_u16(layers[l])));
+    // Halve unless the subscreen is backdrop
+    uint16x8_t half = vandq_u16(math, vdupq_n_u16(ppu->halfColor ? 0xffff : 0));
+    if (add_subscreen)
+      half = vandq_u16(half, vtstq_u16(vld1q_u16(sub_buf + i), vdupq_n_u16(0xff)));
+    uint16x8_t c1 = vld1q_u16(c1s), c2 = vandq_u16(vld1q_u16(c2s), math), out[3];
+    for (int j = 0; j < 3; j++) {
+      uint16x8_t a = vandq_u16(vshlq_u16(c1, vdupq_n_s16(-5 * j)), vdupq_n_u16(0x1f));
+      uint16x8_t b = vandq_u16(vshlq_u16(c2, vdupq_n_s16(-5 * j)), vdupq_n_u16(0x1f));
+      uint16x8_t v = subtract ? vqsubq_u16(a, b) : vaddq_u16(a, b);
+      v = vbslq_u16(half, vshrq_n_u16(v, 1), vminq_u16(v, vdupq_n_u16(31)));
+      v = vmulq_n_u16(vorrq_u16(vshlq_n_u16(v, 3), vshrq_n_u16(v, 2)), ppu->brightness);
+      uint32x4_t p0 = vmull_n_u16(vget_low_u16(v), 0x8889), p1 = vmull_n_u16(vget_high_u16(v), 0x8889);
+      out[j] = vshrq_n_u16(vcombine_u16(vshrn_n_u32(p0, 16), vshrn_n_u32(p1, 16)), 3);
+    }
+    uint16x8x2_t res = { { vorrq_u16(out[2], vshlq_n_u16(out[1], 8)), out[0] } };
+    vst2q_u16((uint16_t *)dst, res);
+#endif
+  }
+  return i;
+}
+#endif
+
 static NOINLINE void PpuDrawWholeLine(Ppu *ppu, uint y) {
+  // With a render scale of 4 each line covers 4 rows that are 4 times wider
+  uint scale = ppu->renderScale;
+  size_t pitch = ppu->renderPitch * scale;
+  uint8 *dst_line = &ppu->renderBuffer[(y - 1) * pitch * scale];
+  size_t line_pixels = 256 + ppu->extraLeftRight * 2;
   if (ppu->forcedBlank) {
-    uint8 *dst = &ppu->renderBuffer[(y - 1) * ppu->renderPitch];
-    size_t n = sizeof(uint32) * (256 + ppu->extraLeftRight * 2);
-    memset(dst, 0, n);
+    for (uint i = 0; i < scale; i++)
+      memset(dst_line + i * pitch, 0, sizeof(uint32) * line_pixels * scale);
     return;
   }
+  if (ppu->mode == 7)
+    ppu->frameHasMode7 = true;
+  bool upsample_mode7 = (scale == 4 && ppu->mode == 7 && !IS_MOSAIC_ENABLED(ppu, 0));
 
   // Default background is backdrop
   ClearBackdrop(&ppu->bgBuffers[0]);
 
   // Render main screen
-  PpuDrawBackgrounds(ppu, y, false);
+  if (!upsample_mode7)
+    PpuDrawBackgrounds(ppu, y, false);
 
   // The 6:th bit is automatically zero, math is never applied to the first half of the sprites.
   uint32 math_enabled = 0;
@@ -722,7 +1053,8 @@ static NOINLINE void PpuDrawWholeLine(Ppu *ppu, uint y) {
   if (ppu->preventMathMode != 3 && ppu->addSubscreen && math_enabled) {
     ClearBackdrop(&ppu->bgBuffers[1]);
     if (ppu->screenEnabled[1] != 0) {
-      PpuDrawBackgrounds(ppu, y, true);
+      if (!upsample_mode7)
+        PpuDrawBackgrounds(ppu, y, true);
       rendered_subscreen = true;
     }
   }
@@ -734,67 +1066,108 @@ static NOINLINE void PpuDrawWholeLine(Ppu *ppu, uint y) {
     0x00, 0xff, 0xff, 0x00,
     0xff, 0x00, 0xff, 0x00,
   };
-  uint32 cw_clip_math = ((cwin.bits & kCwBitsMod[ppu->clipMode]) ^ kCwBitsMod[ppu->clipMode + 4]) |
+  if (!ppu->paletteValid)
+    PpuUpdatePalette(ppu);
+  uint32 cw_clip_math_line = ((cwin.bits & kCwBitsMod[ppu->clipMode]) ^ kCwBitsMod[ppu->clipMode + 4]) |
     ((cwin.bits & kCwBitsMod[ppu->preventMathMode]) ^ kCwBitsMod[ppu->preventMathMode + 4]) << 8;
 
-  uint32 *dst = (uint32*)&ppu->renderBuffer[(y - 1) * ppu->renderPitch], *dst_org = dst;
-
-  dst += (ppu->extraLeftRight - ppu->extraLeftCur);
-
-  uint32 windex = 0;
-  do {
-    uint32 left = cwin.edges[windex] + kPpuExtraLeftRight, right = cwin.edges[windex + 1] + kPpuExtraLeftRight;
-    // If clip is set, then zero out the rgb values from the main screen.
-    uint32 clip_color_mask = (cw_clip_math & 1) ? 0x1f : 0;
-    uint32 math_enabled_cur = (cw_clip_math & 0x100) ? math_enabled : 0;
-    uint32 fixed_color = ppu->fixedColorR | (ppu->fixedColorG << 5) | (ppu->fixedColorB << 10);
-    if (math_enabled_cur == 0 || (fixed_color == 0 && !ppu->halfColor && !rendered_subscreen)) {
-      // Math is disabled (or has no effect), so can avoid the per-pixel maths check
-      uint32 i = left;
-      do {
-        uint32 color = ppu->cgram[ppu->bgBuffers[0].data[i] & 0xff];
-        dst[0] = ppu->brightnessMult[color & clip_color_mask] << 16 |
-          ppu->brightnessMult[(color >> 5) & clip_color_mask] << 8 |
-          ppu->brightnessMult[(color >> 10) & clip_color_mask];
-      } while (dst++, ++i < right);
-    } else {
-      uint8 *half_color_map = ppu->halfColor ? ppu->brightnessMultHalf : ppu->brightnessMult;
-      // Store this in locals
-      math_enabled_cur |= ppu->addSubscreen << 8 | ppu->subtractColor << 9;
-      // Need to check for each pixel whether to use math or not based on the main screen layer.
-      uint32 i = left;
-      do {
-        uint32 color = ppu->cgram[ppu->bgBuffers[0].data[i] & 0xff], color2;
-        uint8 main_layer = (ppu->bgBuffers[0].data[i] >> 8) & 0xf;
-        uint32 r = color & clip_color_mask;
-        uint32 g = (color >> 5) & clip_color_mask;
-        uint32 b = (color >> 10) & clip_color_mask;
-        uint8 *color_map = ppu->brightnessMult;
-        if (math_enabled_cur & (1 << main_layer)) {
-          if (math_enabled_cur & 0x100) {  // addSubscreen ?
-            if ((ppu->bgBuffers[1].data[i] & 0xff) != 0)
-              color2 = ppu->cgram[ppu->bgBuffers[1].data[i] & 0xff], color_map = half_color_map;
-            else  // Don't halve if ppu->addSubscreen && backdrop
-              color2 = fixed_color;
-          } else {
-            color2 = fixed_color, color_map = half_color_map;
-          }
-          uint32 r2 = (color2 & 0x1f), g2 = ((color2 >> 5) & 0x1f), b2 = ((color2 >> 10) & 0x1f);
-          if (math_enabled_cur & 0x200) {  // subtractColor?
-            r = (r >= r2) ? r - r2 : 0;
-            g = (g >= g2) ? g - g2 : 0;
-            b = (b >= b2) ? b - b2 : 0;
-          } else {
-            r += r2;
-            g += g2;
-            b += b2;
+  // Upsampled mode 7 composes and outputs each of the 4 rows separately,
+  // everything else is output at native width and stretched afterwards.
+  uint xscale = upsample_mode7 ? 4 : 1;
+  if (upsample_mode7 && !rendered_subscreen) {
+    for (size_t i = 0; i != arraysize(ppu->mode7Buffers[1]); i++)
+      ppu->mode7Buffers[1][i] = 0x500;
+  }
+  for (uint subrow = 0; subrow < (upsample_mode7 ? 4 : 1); subrow++) {
+    const PpuZbufType *main_buf = ppu->bgBuffers[0].data, *sub_buf = ppu->bgBuffers[1].data;
+    if (upsample_mode7) {
+      PpuDrawMode7Upsampled(ppu, y, subrow, false);
+      if (rendered_subscreen)
+        PpuDrawMode7Upsampled(ppu, y, subrow, true);
+      main_buf = ppu->mode7Buffers[0], sub_buf = ppu->mode7Buffers[1];
+    }
+    uint32 cw_clip_math = cw_clip_math_line;
+    uint32 *dst = (uint32*)(dst_line + subrow * pitch), *dst_end = dst + line_pixels * xscale;
+
+    // Side space outside of the current widescreen area is black
+    memset(dst, 0, (ppu->extraLeftRight - ppu->extraLeftCur) * xscale * sizeof(uint32));
+    dst += (ppu->extraLeftRight - ppu->extraLeftCur) * xscale;
+
+    uint32 windex = 0;
+    do {
+      uint32 left = (cwin.edges[windex] + kPpuExtraLeftRight) * xscale, right = (cwin.edges[windex + 1] + kPpuExtraLeftRight) * xscale;
+      // If clip is set, then zero out the rgb values from the main screen.
+      uint32 clip_color_mask = (cw_clip_math & 1) ? 0x1f : 0;
+      uint32 math_enabled_cur = (cw_clip_math & 0x100) ? math_enabled : 0;
+      uint32 fixed_color = ppu->fixedColorR | (ppu->fixedColorG << 5) | (ppu->fixedColorB << 10);
+      if (math_enabled_cur == 0 || (fixed_color == 0 && !ppu->halfColor && !rendered_subscreen)) {
+        // Math is disabled (or has no effect), so can avoid the per-pixel maths check.
+        // Clipped pixels are always black.
+        if (clip_color_mask) {
+          const uint32 *palette = ppu->palette;
+          uint32 i = left;
+          do {
+            dst[0] = palette[main_buf[i] & 0xff];
+          } while (dst++, ++i < right);
+        } else {
+          memset(dst, 0, (right - left) * sizeof(uint32));
+          dst += right - left;
+        }
+      } else {
+        uint8 *half_color_map = ppu->halfColor ? ppu->brightnessMultHalf : ppu->brightnessMult;
+        // Store this in locals
+        math_enabled_cur |= ppu->addSubscreen << 8 | ppu->subtractColor << 9;
+        // Need to check for each pixel whether to use math or not based on the main screen layer.
+        uint32 i = left;
+#if defined(PPU_SIMD_SSE2) || defined(PPU_SIMD_NEON)
+        uint32 done = PpuColorMathSimd(ppu, dst, main_buf + i, sub_buf + i, right - left,
+                                       math_enabled_cur, clip_color_mask, fixed_color);
+        i += done, dst += done;
+#endif
+        for (; i < right; i++, dst++) {
+          uint32 color = ppu->cgram[main_buf[i] & 0xff], color2;
+          uint8 main_layer = (main_buf[i] >> 8) & 0xf;
+          uint32 r = color & clip_color_mask;
+          uint32 g = (color >> 5) & clip_color_mask;
+          uint32 b = (color >> 10) & clip_color_mask;
+          uint8 *color_map = ppu->brightnessMult;
+          if (math_enabled_cur & (1 << main_layer)) {
+            if (math_enabled_cur & 0x100) {  // addSubscreen ?
+              if ((sub_buf[i] & 0xff) != 0)
+                color2 = ppu->cgram[sub_buf[i] & 0xff], color_map = half_color_map;
+              else  // Don't halve if ppu->addSubscreen && backdrop
+                color2 = fixed_color;
+            } else {
+              color2 = fixed_color, color_map = half_color_map;
+            }
+            uint32 r2 = (color2 & 0x1f), g2 = ((color2 >> 5) & 0x1f), b2 = ((color2 >> 10) & 0x1f);
+            if (math_enabled_cur & 0x200) {  // subtractColor?
+              r = (r >= r2) ? r - r2 : 0;
+              g = (g >= g2) ? g - g2 : 0;
+              b = (b >= b2) ? b - b2 : 0;
+            } else {
+              r += r2;
+              g += g2;
+              b += b2;
+            }
           }
+          dst[0] = color_map[b] | color_map[g] << 8 | color_map[r] << 16;
         }
-        dst[0] = color_map[b] | color_map[g] << 8 | color_map[r] << 16;
-      } while (dst++, ++i < right);
-    }
-  } while (cw_clip_math >>= 1, ++windex < cwin.nr);
+      }
+    } while (cw_clip_math >>= 1, ++windex < cwin.nr);
+    memset(dst, 0, (dst_end - dst) * sizeof(uint32));
+  }
 
+  if (scale == 4 && !upsample_mode7) {
+    // Stretch the native line in place, back to front, then repeat it
+    uint32 *row = (uint32 *)dst_line;
+    for (size_t i = line_pixels; i-- != 0; ) {
+      uint32 v = row[i];
+      row[i * 4 + 0] = row[i * 4 + 1] = row[i * 4 + 2] = row[i * 4 + 3] = v;
+    }
+    for (uint i = 1; i < 4; i++)
+      memcpy(dst_line + i * pitch, dst_line, sizeof(uint32) * line_pixels * 4);
+  }
 }
 
 
@@ -1105,79 +1478,97 @@ static bool ppu_getWindowState(Ppu* ppu, int layer, int x) {
   return false;
 }
 
+// Bucket the sprites into per-line lists, in evaluation order. Sprites that
+// are outside the screen horizontally are left out, they don't count
+// towards the 32 sprite limit.
+static void PpuBuildSpriteBins(Ppu *ppu, uint16 key) {
+  uint8_t index = ppu->objPriority ? (ppu->oamAdr & 0xfe) : 0;
+  memset(ppu->spriteLineCount, 0, sizeof(ppu->spriteLineCount));
+  for (int i = 0; i < 128; i++, index += 2) {
+    uint8_t y = ppu->oam[index] >> 8;
+    int spriteSize = spriteSizes[ppu->objSize][(ppu->highOam[index >> 3] >> ((index & 7) + 1)) & 1];
+    int spriteHeight = ppu->objInterlace ? spriteSize / 2 : spriteSize;
+    // get the x location, using the high bit as well
+    int x = ppu->oam[index] & 0xff;
+    x |= ((ppu->highOam[index >> 3] >> (index & 7)) & 1) << 8;
+    if (x > 255) x -= 512;
+    if (x <= -spriteSize)
+      continue;
+    PpuSprite *spr = &ppu->sprites[i];
+    spr->x = x;
+    spr->y = y;
+    spr->size = spriteSize;
+    spr->oam1 = ppu->oam[index + 1];
+    for (int row = 0; row < spriteHeight; row++) {
+      uint8_t line = y + row;
+      if (line < kPpuMaxLines)
+        ppu->spriteLines[line][ppu->spriteLineCount[line]++] = i;
+    }
+  }
+  ppu->spriteBinsKey = key;
+}
+
 static bool ppu_evaluateSprites(Ppu* ppu, int line) {
   // TODO: iterate over oam normally to determine in-range sprites,
   //   then iterate those in-range sprites in reverse for tile-fetching
   // TODO: rectangular sprites, wierdness with sprites at -256
-  uint8_t index = ppu->objPriority ? (ppu->oamAdr & 0xfe) : 0;
+  uint16 key = 0x8000 | (ppu->objPriority ? (ppu->oamAdr & 0xfe) : 0) | ppu->objSize << 8 | ppu->objInterlace << 11;
+  if (ppu->spriteBinsKey != key)
+    PpuBuildSpriteBins(ppu, key);
+  if (line >= kPpuMaxLines)
+    return false;
+  bool limits = !(ppu->renderFlags & kPpuRenderFlags_NoSpriteLimits);
   int spritesFound = 0;
   int tilesFound = 0;
-  for(int i = 0; i < 128; i++) {
-    uint8_t y = ppu->oam[index] >> 8;
-    // check if the sprite is on this line and get the sprite size
-    uint8_t row = line - y;
-    int spriteSize = spriteSizes[ppu->objSize][(ppu->highOam[index >> 3] >> ((index & 7) + 1)) & 1];
-    int spriteHeight = ppu->objInterlace ? spriteSize / 2 : spriteSize;
-    if(row < spriteHeight) {
-      // in y-range, get the x location, using the high bit as well
-      int x = ppu->oam[index] & 0xff;
-      x |= ((ppu->highOam[index >> 3] >> (index & 7)) & 1) << 8;
-      if(x > 255) x -= 512;
-      // if in x-range
-      if(x > -spriteSize) {
-        // break if we found 32 sprites already
-        spritesFound++;
-        if(spritesFound > 32) {
-          ppu->rangeOver = true;
-          break;
+  const uint8_t *list = ppu->spriteLines[line];
+  for (int j = 0, n = ppu->spriteLineCount[line]; j < n; j++) {
+    const PpuSprite *spr = &ppu->sprites[list[j]];
+    int x = spr->x, spriteSize = spr->size, oam1 = spr->oam1;
+    uint8_t row = line - spr->y;
+    // break if we found 32 sprites already
+    spritesFound++;
+    if(spritesFound > 32) {
+      ppu->rangeOver = true;
+      if (limits) break;
+    }
+    // update row according to obj-interlace
+    if(ppu->objInterlace) row = row * 2 + (ppu->evenFrame ? 0 : 1);
+    // get some data for the sprite and y-flip row if needed
+    int objAdr = (oam1 & 0x100) ? ppu->objTileAdr2 : ppu->objTileAdr1;
+    if(oam1 & 0x8000) row = spriteSize - 1 - row;
+    // fetch all tiles in x-range
+    int paletteBase = 0x80 + 16 * ((oam1 & 0xe00) >> 9);
+    int prio = SPRITE_PRIO_TO_PRIO((oam1 & 0x3000) >> 12, (oam1 & 0x800) == 0);
+    PpuZbufType z = paletteBase + (prio << 8);
+
+    for(int col = 0; col < spriteSize; col += 8) {
+      if(col + x > -8 && col + x < 256) {
+        // break if we found 34 8*1 slivers already
+        tilesFound++;
+        if(tilesFound > 34) {
+          ppu->timeOver = true;
+          if (limits) break;
         }
-        // update row according to obj-interlace
-        if(ppu->objInterlace) row = row * 2 + (ppu->evenFrame ? 0 : 1);
-        // get some data for the sprite and y-flip row if needed
-        int oam1 = ppu->oam[index + 1];
-        int tile = oam1 & 0xff;
-        int objAdr = (oam1 & 0x100) ? ppu->objTileAdr2 : ppu->objTileAdr1;
-        int palette = (oam1 & 0xe00) >> 9;
-        bool hFlipped = oam1 & 0x4000;
-        if(oam1 & 0x8000) row = spriteSize - 1 - row;
-        // fetch all tiles in x-range
-        int paletteBase = 0x80 + 16 * ((oam1 & 0xe00) >> 9);
-        int prio = SPRITE_PRIO_TO_PRIO((oam1 & 0x3000) >> 12, (oam1 & 0x800) == 0);
-        PpuZbufType z = paletteBase + (prio << 8);
-
-        for(int col = 0; col < spriteSize; col += 8) {
-          if(col + x > -8 && col + x < 256) {
-            // break if we found 34 8*1 slivers already
-            tilesFound++;
-            if(tilesFound > 34) {
-              ppu->timeOver = true;
-              break;
-            }
-            // figure out which tile this uses, looping within 16x16 pages, and get it's data
-            int usedCol = oam1 & 0x4000 ? spriteSize - 1 - col : col;
-            int usedTile = ((((oam1 & 0xff) >> 4) + (row >> 3)) << 4) | (((oam1 & 0xf) + (usedCol >> 3)) & 0xf);
-            uint16 *addr = &ppu->vram[(objAdr + usedTile * 16 + (row & 0x7)) & 0x7fff];
-            uint32 plane = addr[0] | addr[8] << 16;
-            // go over each pixel
-            int px_left = IntMax(-(col + x + kPpuExtraLeftRight), 0);
-            int px_right = IntMin(256 + kPpuExtraLeftRight - (col + x), 8);
-            PpuZbufType *dst = ppu->objBuffer.data + col + x + px_left + kPpuExtraLeftRight;
-
-            for (int px = px_left; px < px_right; px++, dst++) {
-              int shift = oam1 & 0x4000 ? px : 7 - px;
-              uint32 bits = plane >> shift;
-              int pixel = ((bits >> 0) & 1) | ((bits >> 7) & 2) | ((bits >> 14) & 4) | ((bits >> 21) & 8);
-              // draw it in the buffer if there is a pixel here, and the buffer there is still empty
-              if (pixel != 0 && (dst[0] & 0xff) == 0)
-                dst[0] = z + pixel;
-            }
-
-          }
+        // figure out which tile this uses, looping within 16x16 pages, and get it's data
+        int usedCol = oam1 & 0x4000 ? spriteSize - 1 - col : col;
+        int usedTile = ((((oam1 & 0xff) >> 4) + (row >> 3)) << 4) | (((oam1 & 0xf) + (usedCol >> 3)) & 0xf);
+        uint64 pixels = PpuGetTileRow(ppu, objAdr + usedTile * 16 + (row & 0x7), 4);
+        if (oam1 & 0x4000)
+          pixels = PpuFlipTileRow(pixels);
+        // go over each pixel
+        int px_left = IntMax(-(col + x + kPpuExtraLeftRight), 0);
+        int px_right = IntMin(256 + kPpuExtraLeftRight - (col + x), 8);
+        PpuZbufType *dst = ppu->objBuffer.data + col + x + px_left + kPpuExtraLeftRight;
+
+        for (int px = px_left; px < px_right; px++, dst++) {
+          int pixel = (pixels >> (px * 8)) & 0xff;
+          // draw it in the buffer if there is a pixel here, and the buffer there is still empty
+          if (pixel != 0 && (dst[0] & 0xff) == 0)
+            dst[0] = z + pixel;
         }
-        if(tilesFound > 34) break; // break out of sprite-loop if max tiles found
       }
     }
-    index += 2;
+    if(tilesFound > 34 && limits) break; // break out of sprite-loop if max tiles found
   }
   return tilesFound != 0;
 }
@@ -1313,6 +1704,47 @@ uint8_t ppu_read(Ppu* ppu, uint8_t adr) {
   }
 }
 
+static void ppu_writeOamData(Ppu* ppu, uint8_t val) {
+  if(ppu->oamInHigh) {
+    ppu->highOam[((ppu->oamAdr & 0xf) << 1) | ppu->oamSecondWrite] = val;
+    ppu->spriteBinsKey = 0;
+    if(ppu->oamSecondWrite) {
+      ppu->oamAdr++;
+      if(ppu->oamAdr == 0) ppu->oamInHigh = false;
+    }
+  } else {
+    if(!ppu->oamSecondWrite) {
+      ppu->oamBuffer = val;
+    } else {
+      ppu->oam[ppu->oamAdr++] = (val << 8) | ppu->oamBuffer;
+      ppu->spriteBinsKey = 0;
+      if(ppu->oamAdr == 0) ppu->oamInHigh = true;
+    }
+  }
+  ppu->oamSecondWrite = !ppu->oamSecondWrite;
+}
+
+static void ppu_writeVramData(Ppu* ppu, bool high, uint8_t val) {
+  uint16_t vramAdr = ppu_getVramRemap(ppu);
+  ppu_markVramDirty(ppu, vramAdr);
+  if(high) {
+    ppu->vram[vramAdr & 0x7fff] = (ppu->vram[vramAdr & 0x7fff] & 0x00ff) | (val << 8);
+  } else {
+    ppu->vram[vramAdr & 0x7fff] = (ppu->vram[vramAdr & 0x7fff] & 0xff00) | val;
+  }
+  if(ppu->vramIncrementOnHigh == high) ppu->vramPointer += ppu->vramIncrement;
+}
+
+static void ppu_writeCgramData(Ppu* ppu, uint8_t val) {
+  if(!ppu->cgramSecondWrite) {
+    ppu->cgramBuffer = val;
+  } else {
+    ppu->cgram[ppu->cgramPointer++] = (val << 8) | ppu->cgramBuffer;
+    ppu->paletteValid = false;
+  }
+  ppu->cgramSecondWrite = !ppu->cgramSecondWrite;
+}
+
 void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
 //  if (adr != 24 && adr != 25)
 //    printf("ppu_write(%d, %d)\n", adr, val);
@@ -1345,21 +1777,7 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
       break;
     }
     case 0x04: {
-      if(ppu->oamInHigh) {
-        ppu->highOam[((ppu->oamAdr & 0xf) << 1) | ppu->oamSecondWrite] = val;
-        if(ppu->oamSecondWrite) {
-          ppu->oamAdr++;
-          if(ppu->oamAdr == 0) ppu->oamInHigh = false;
-        }
-      } else {
-        if(!ppu->oamSecondWrite) {
-          ppu->oamBuffer = val;
-        } else {
-          ppu->oam[ppu->oamAdr++] = (val << 8) | ppu->oamBuffer;
-          if(ppu->oamAdr == 0) ppu->oamInHigh = true;
-        }
-      }
-      ppu->oamSecondWrite = !ppu->oamSecondWrite;
+      ppu_writeOamData(ppu, val);
       break;
     }
     case 0x05: {
@@ -1449,15 +1867,11 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
     }
     case 0x18: {
       // TODO: vram access during rendering (also cgram and oam)
-      uint16_t vramAdr = ppu_getVramRemap(ppu);
-      ppu->vram[vramAdr & 0x7fff] = (ppu->vram[vramAdr & 0x7fff] & 0xff00) | val;
-      if(!ppu->vramIncrementOnHigh) ppu->vramPointer += ppu->vramIncrement;
+      ppu_writeVramData(ppu, false, val);
       break;
     }
     case 0x19: {
-      uint16_t vramAdr = ppu_getVramRemap(ppu);
-      ppu->vram[vramAdr & 0x7fff] = (ppu->vram[vramAdr & 0x7fff] & 0x00ff) | (val << 8);
-      if(ppu->vramIncrementOnHigh) ppu->vramPointer += ppu->vramIncrement;
+      ppu_writeVramData(ppu, true, val);
       break;
     }
     case 0x1a: {
@@ -1487,12 +1901,7 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
       break;
     }
     case 0x22: {
-      if(!ppu->cgramSecondWrite) {
-        ppu->cgramBuffer = val;
-      } else {
-        ppu->cgram[ppu->cgramPointer++] = (val << 8) | ppu->cgramBuffer;
-      }
-      ppu->cgramSecondWrite = !ppu->cgramSecondWrite;
+      ppu_writeCgramData(ppu, val);
       break;
     }
     case 0x23:
@@ -1615,6 +2024,50 @@ void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val) {
   }
 }
 
+bool ppu_canWriteDma(const uint8_t* adr) {
+  bool vram = true, cgram = true, oam = true;
+  for(int i = 0; i < 4; i++) {
+    vram &= (adr[i] & 0xfe) == 0x18;
+    cgram &= adr[i] == 0x22;
+    oam &= adr[i] == 0x04;
+  }
+  return vram || cgram || oam;
+}
+
+bool ppu_writeDma(Ppu* ppu, const uint8_t* adr, int index, const uint8_t* data, int n) {
+  bool vram = true, cgram = true, oam = true;
+  for(int i = 0; i < 4; i++) {
+    vram &= (adr[i] & 0xfe) == 0x18;
+    cgram &= adr[i] == 0x22;
+    oam &= adr[i] == 0x04;
+  }
+  if(cgram) {
+    for(int i = 0; i < n; i++) ppu_writeCgramData(ppu, data[i]);
+    return true;
+  }
+  if(oam) {
+    for(int i = 0; i < n; i++) ppu_writeOamData(ppu, data[i]);
+    return true;
+  }
+  if(!vram) return false;
+  int i = 0;
+  if(ppu->vramRemapMode == 0 && ppu->vramIncrement == 1 && ppu->vramIncrementOnHigh &&
+     adr[index & 3] == 0x18 && adr[(index + 1) & 3] == 0x19 &&
+     adr[(index + 2) & 3] == 0x18 && adr[(index + 3) & 3] == 0x19) {
+    // low, high, low, high into consecutive words: copy them as words and
+    // mark the pages up front, before anything in them changes
+    uint16_t start = ppu->vramPointer;
+    int words = n >> 1;
+    PpuPrepareVramWrite(ppu, start, words);
+    for(int w = 0; w < words; w++)
+      ppu->vram[(start + w) & 0x7fff] = data[w * 2] | (data[w * 2 + 1] << 8);
+    ppu->vramPointer = start + words;
+    i = words * 2;
+  }
+  for(; i < n; i++) ppu_writeVramData(ppu, adr[(index + i) & 3] & 1, data[i]);
+  return true;
+}
+
 void PpuSetExtraSideSpace(Ppu* ppu, int left, int right) {
   // Clamp values to the maximum allowed extra pixels
   ppu->extraLeftCur = (left < ppu->extraLeftRight) ? left : ppu->extraLeftRight;
@@ -1622,5 +2075,5 @@ void PpuSetExtraSideSpace(Ppu* ppu, int left, int right) {
 }
 
 int PpuGetCurrentRenderScale(Ppu *ppu, uint32_t render_flags) {
-  return 1;
+  return (render_flags & kPpuRenderFlags_4x4Mode7) ? ppu->renderScale : 1;
 }
@@ -28,6 +28,9 @@ enum {
   kPpuExtraLeftRight = kPpuEnableLargeScreen ? 96 : 0,
   // Total pixel width including max widescreen extension
   kPpuXPixels = 256 + kPpuExtraLeftRight * 2,
+  // Granularity of the vram write tracking (256 bytes)
+  kPpuVramPageWords = 128,
+  kPpuVramPages = 0x8000 / kPpuVramPageWords,
 };
 
 typedef uint16_t PpuZbufType;
@@ -64,6 +67,75 @@ typedef struct WindowLayer {
   uint8_t maskLogic;
 } WindowLayer;
 
+enum {
+  kPpuMaxLines = 240,
+};
+
+// The registers the new renderer reads for one line, as they were
+// when the line was reached.
+typedef struct PpuLineState {
+  BgLayer bgLayer[4];
+  int16_t m7matrix[8];
+  uint32_t windowsel;
+  uint16_t objTileAdr1;
+  uint16_t objTileAdr2;
+  uint8_t oamAdr;
+  uint8_t objSize;
+  bool objPriority;
+  bool objInterlace;
+  bool evenFrame;
+  bool forcedBlank;
+  uint8_t brightness;
+  uint8_t mode;
+  uint8_t mosaicSize;
+  uint8_t mosaicEnabled;
+  bool m7largeField;
+  bool m7charFill;
+  bool m7xFlip;
+  bool m7yFlip;
+  uint8_t window1left;
+  uint8_t window1right;
+  uint8_t window2left;
+  uint8_t window2right;
+  uint8_t screenEnabled[2];
+  uint8_t screenWindowed[2];
+  uint8_t clipMode;
+  uint8_t preventMathMode;
+  bool addSubscreen;
+  bool subtractColor;
+  bool halfColor;
+  bool mathEnabled[6];
+  uint8_t fixedColorR;
+  uint8_t fixedColorG;
+  uint8_t fixedColorB;
+  uint8_t extraLeftCur;
+  uint8_t extraRightCur;
+} PpuLineState;
+
+// A sprite that is at least partly on screen horizontally
+typedef struct PpuSprite {
+  int16_t x;
+  uint8_t y;
+  uint8_t size;
+  uint16_t oam1;
+} PpuSprite;
+
+// A frame recorded with line capture enabled. Vram, cgram and oam are taken
+// at the end of the frame and shared by all lines.
+typedef struct PpuCapturedFrame {
+  uint16_t vram[0x8000];
+  uint16_t cgram[0x100];
+  uint16_t oam[0x100];
+  uint8_t highOam[0x20];
+  uint8_t *renderBuffer;
+  uint32_t renderPitch;
+  uint32_t renderFlags;
+  uint8_t renderScale;
+  uint8_t extraLeftRight;
+  int numLines;
+  PpuLineState lines[kPpuMaxLines];
+} PpuCapturedFrame;
+
 struct Ppu {
   Snes* snes;
   // vram access
@@ -167,10 +239,36 @@ struct Ppu {
   PpuPixelPrioBufs objBuffer;
   uint32_t renderPitch;
   uint8_t *renderBuffer;
+  uint32_t renderFlags;
+  // 4 while the current frame is drawn at 4x4 for kPpuRenderFlags_4x4Mode7
+  uint8_t renderScale;
+  bool frameHasMode7;
+  // Main and sub screen of upsampled mode 7 lines, 4 entries per pixel
+  PpuZbufType mode7Buffers[2][kPpuXPixels * 4];
+  // Sprites of each line in evaluation order, indexes into sprites. Rebuilt
+  // once per frame, or when oam or the registers that are part of the key change.
+  uint16_t spriteBinsKey;
+  PpuSprite sprites[128];
+  uint8_t spriteLineCount[kPpuMaxLines];
+  uint8_t spriteLines[kPpuMaxLines][128];
+  // When set, lines are recorded here instead of drawn, see PpuFinishLineCapture
+  PpuLineState *lineCapture;
+  int capturedLines;
   uint8_t brightnessMult[32 + 31];
   uint8_t brightnessMultHalf[32 * 2];
+  // cgram expanded to xrgb with brightness applied, rebuilt when paletteValid is clear
+  bool paletteValid;
+  uint32_t palette[256];
   uint8_t mosaicModulo[kPpuXPixels];
-
+  // vram pages written since PpuClearVramDirty, the old contents of a page
+  // are copied to vramBackup (if set) on its first write.
+  uint8_t vramDirty[kPpuVramPages / 8];
+  uint16_t *vramBackup;
+  // Changes whenever vram is replaced as a whole (reset, load, copy)
+  uint32_t vramSerial;
+  // Decoded tile rows, 2bpp rows followed by 4bpp rows, indexed by vram word
+  // address. Entries are reset to all ones whenever the words behind them change.
+  uint64_t *tileCache;
 };
 
 Ppu* ppu_init(Snes* snes);
@@ -182,9 +280,27 @@ void ppu_handleVblank(Ppu* ppu);
 void ppu_runLine(Ppu* ppu, int line);
 uint8_t ppu_read(Ppu* ppu, uint8_t adr);
 void ppu_write(Ppu* ppu, uint8_t adr, uint8_t val);
+// Whether ppu_writeDma handles a dma into the b-bus registers adr[0..3]
+bool ppu_canWriteDma(const uint8_t* adr);
+// Write data[i] to register adr[(index + i) & 3], like a dma into the b-bus.
+// Only the vram, cgram and oam data ports are handled, for any other register
+// it returns false without writing anything.
+bool ppu_writeDma(Ppu* ppu, const uint8_t* adr, int index, const uint8_t* data, int n);
 void ppu_saveload(Ppu *ppu, SaveLoadFunc *func, void *ctx);
 void PpuSetExtraSideSpace(Ppu* ppu, int left, int right);
 void PpuBeginDrawing(Ppu *ppu, uint8_t *pixels, size_t pitch, uint32_t render_flags);
+void PpuClearVramDirty(Ppu *ppu, uint16_t *backup);
+void PpuInvalidateTileCache(Ppu *ppu, uint32_t adr, uint32_t words);
+// Call before changing words [adr, adr + words) of ppu->vram directly, it
+// marks their pages dirty and invalidates the tile cache rows that use them.
+void PpuPrepareVramWrite(Ppu *ppu, uint32_t adr, uint32_t words);
+void PpuSetLineCapture(Ppu *ppu, bool enable);
+bool PpuFinishLineCapture(Ppu *ppu, PpuCapturedFrame *frame);
+void PpuDrawCapturedLines(Ppu *ppu, const PpuCapturedFrame *frame, int first, int step);
+
+static inline bool PpuIsVramPageDirty(const Ppu *ppu, int page) {
+  return (ppu->vramDirty[page >> 3] >> (page & 7)) & 1;
+}
 
 int PpuGetCurrentRenderScale(Ppu *ppu, uint32_t render_flags);
 
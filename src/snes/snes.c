@@ -41,6 +41,7 @@ Snes* snes_init(uint8_t *ram) {
   snes->cart = cart_init(snes);
   snes->input1 = input_init(snes);
   snes->input2 = input_init(snes);
+  snes_buildMemoryMap(snes);
   return snes;
 }
 
@@ -164,17 +165,13 @@ void snes_handle_pos_stuff(Snes *snes) {
   }
 }
 
-#define IS_ADR(x) (x == 0xfffff)
-
 void snes_catchupApu(Snes* snes) {
   if (snes->apuCatchupCycles > 10000)
     snes->apuCatchupCycles = 10000;
 
   int catchupCycles = (int) snes->apuCatchupCycles;
 
-  for(int i = 0; i < catchupCycles; i++) {
-    apu_cycle(snes->apu);
-  }
+  apu_runCycles(snes->apu, catchupCycles);
   snes->apuCatchupCycles -= (double) catchupCycles;
 }
 
@@ -379,7 +376,29 @@ static void snes_writeReg(Snes* snes, uint16_t adr, uint8_t val) {
   }
 }
 
+void snes_buildMemoryMap(Snes* snes) {
+  for(int page = 0; page < 0x1000; page++) {
+    uint8_t bank = page >> 4;
+    uint16_t adr = (page & 0xf) << 12;
+    bool systemBank = bank < 0x40 || (bank >= 0x80 && bank < 0xc0);
+    uint8_t* read = NULL;
+    uint8_t* write = NULL;
+    if(bank == 0x7e || bank == 0x7f || (systemBank && adr < 0x2000)) {
+      uint32_t ramAdr = systemBank ? adr : ((bank & 1) << 16) | adr;
+      read = write = &snes->ram[ramAdr];
+    } else if(!(systemBank && (adr == 0x2000 || adr == 0x4000))) {
+      // pages 2xxx and 4xxx of the system banks hold the registers
+      read = cart_getPage(snes->cart, bank, adr, false);
+      write = cart_getPage(snes->cart, bank, adr, true);
+    }
+    snes->readMap[page] = read;
+    snes->writeMap[page] = write;
+  }
+}
+
 uint8_t snes_read(Snes* snes, uint32_t adr) {
+  const uint8_t* page = snes->readMap[(adr >> 12) & 0xfff];
+  if(page) return page[adr & 0xfff];
   uint8_t bank = adr >> 16;
   adr &= 0xffff;
   if(bank == 0x7e || bank == 0x7f) {
@@ -415,19 +434,24 @@ void LogWrite(Snes *snes, uint32_t adr, uint8_t val) {
 }
 
 void snes_write(Snes* snes, uint32_t adr, uint8_t val) {
+  uint8_t* page = snes->writeMap[(adr >> 12) & 0xfff];
+  if(page) {
+    page[adr & 0xfff] = val;
+    return;
+  }
   uint8_t bank = adr >> 16;
   adr &= 0xffff;
   if(bank == 0x7e || bank == 0x7f) {
     uint32_t addr = ((bank & 1) << 16) | adr;
     snes->ram[addr] = val; // ram
-    if (IS_ADR(addr)) {
+    if (addr == SNES_WATCHED_RAM) {
       LogWrite(snes, adr, val);
     }
   }
   if(bank < 0x40 || (bank >= 0x80 && bank < 0xc0)) {
     if(adr < 0x2000) {
       snes->ram[adr] = val; // ram mirror
-      if (IS_ADR(adr)) {
+      if (adr == SNES_WATCHED_RAM) {
         LogWrite(snes, adr, val);
       }
     }
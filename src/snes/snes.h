@@ -68,6 +68,10 @@ struct Snes {
   // misc
   bool fastMem;
   uint8_t openBus;
+  // not saved, 4 KB pages: host memory, or NULL where registers or cart
+  // decoding are involved. Built by snes_buildMemoryMap
+  uint8_t* readMap[0x1000];
+  uint8_t* writeMap[0x1000];
 };
 
 Snes* snes_init(uint8_t *ram);
@@ -80,9 +84,13 @@ void snes_writeBBus(Snes* snes, uint8_t adr, uint8_t val);
 uint8_t snes_read(Snes* snes, uint32_t adr);
 void snes_write(Snes* snes, uint32_t adr, uint8_t val);
 uint8_t snes_cpuRead(Snes* snes, uint32_t adr);
+void snes_buildMemoryMap(Snes* snes);
 void snes_cpuWrite(Snes* snes, uint32_t adr, uint8_t val);
 // debugging
 void snes_debugCycle(Snes* snes, bool* cpuNext, bool* spcNext);
+// wram writes to this address are logged by LogWrite. Only writes that miss
+// writeMap get there, so clear its page in snes_buildMemoryMap when setting it.
+#define SNES_WATCHED_RAM 0xfffff
 
 void snes_handle_pos_stuff(Snes *snes);
 
@@ -10,6 +10,11 @@
 #include "apu.h"
 #include "../util.h"
 
+// threaded dispatch with computed goto where the compiler has it
+#if defined(__GNUC__) || defined(__clang__)
+#define SPC_THREADED 1
+#endif
+
 static const int cyclesPerOpcode[256] = {
   2, 8, 4, 5, 3, 4, 3, 6, 2, 6, 5, 4, 5, 4, 6, 8,
   2, 8, 4, 5, 4, 5, 5, 6, 5, 5, 6, 5, 2, 2, 4, 6,
@@ -43,7 +48,7 @@ static uint16_t spc_pullWord(Spc* spc);
 static void spc_pushWord(Spc* spc, uint16_t value);
 static uint16_t spc_readWord(Spc* spc, uint16_t adrl, uint16_t adrh);
 static void spc_writeWord(Spc* spc, uint16_t adrl, uint16_t adrh, uint16_t value);
-static void spc_doOpcode(Spc* spc, uint8_t opcode);
+static int spc_execute(Spc* spc, int cycles);
 
 // addressing modes and opcode functions not declared, only used after defintions
 
@@ -90,10 +95,11 @@ void spc_saveload(Spc *spc, SaveLoadFunc *func, void *ctx) {
 int spc_runOpcode(Spc* spc) {
   spc->cyclesUsed = 0;
   if(spc->stopped) return 1;
-  uint8_t opcode = spc_readOpcode(spc);
-  spc->cyclesUsed = cyclesPerOpcode[opcode];
-  spc_doOpcode(spc, opcode);
-  return spc->cyclesUsed;
+  return spc_execute(spc, 0);
+}
+
+int spc_runCycles(Spc* spc, int cycles) {
+  return spc_execute(spc, cycles);
 }
 
 static uint8_t spc_readOpcode(Spc* spc) {
@@ -430,1099 +436,1162 @@ static void spc_dec(Spc* spc, uint16_t adr) {
   spc_setZN(spc, val);
 }
 
-static void spc_doOpcode(Spc* spc, uint8_t opcode) {
-  switch(opcode) {
-    case 0x00: { // nop imp
-      // no operation
-      break;
-    }
-    case 0x01:
-    case 0x11:
-    case 0x21:
-    case 0x31:
-    case 0x41:
-    case 0x51:
-    case 0x61:
-    case 0x71:
-    case 0x81:
-    case 0x91:
-    case 0xa1:
-    case 0xb1:
-    case 0xc1:
-    case 0xd1:
-    case 0xe1:
-    case 0xf1: { // tcall imp
-      spc_pushWord(spc, spc->pc);
-      uint16_t adr = 0xffde - (2 * (opcode >> 4));
-      spc->pc = spc_readWord(spc, adr, adr + 1);
-      break;
-    }
-    case 0x02:
-    case 0x22:
-    case 0x42:
-    case 0x62:
-    case 0x82:
-    case 0xa2:
-    case 0xc2:
-    case 0xe2: { // set1 dp
-      uint16_t adr = spc_adrDp(spc);
-      spc_write(spc, adr, spc_read(spc, adr) | (1 << (opcode >> 5)));
-      break;
-    }
-    case 0x12:
-    case 0x32:
-    case 0x52:
-    case 0x72:
-    case 0x92:
-    case 0xb2:
-    case 0xd2:
-    case 0xf2: { // clr1 dp
-      uint16_t adr = spc_adrDp(spc);
-      spc_write(spc, adr, spc_read(spc, adr) & ~(1 << (opcode >> 5)));
-      break;
-    }
-    case 0x03:
-    case 0x23:
-    case 0x43:
-    case 0x63:
-    case 0x83:
-    case 0xa3:
-    case 0xc3:
-    case 0xe3: { // bbs dp, rel
-      uint8_t val = spc_read(spc, spc_adrDp(spc));
-      spc_doBranch(spc, spc_readOpcode(spc), val & (1 << (opcode >> 5)));
-      break;
-    }
-    case 0x13:
-    case 0x33:
-    case 0x53:
-    case 0x73:
-    case 0x93:
-    case 0xb3:
-    case 0xd3:
-    case 0xf3: { // bbc dp, rel
-      uint8_t val = spc_read(spc, spc_adrDp(spc));
-      spc_doBranch(spc, spc_readOpcode(spc), (val & (1 << (opcode >> 5))) == 0);
-      break;
-    }
-    case 0x04: { // or  dp
-      spc_or(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0x05: { // or  abs
-      spc_or(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0x06: { // or  ind
-      spc_or(spc, spc_adrInd(spc));
-      break;
-    }
-    case 0x07: { // or  idx
-      spc_or(spc, spc_adrIdx(spc));
-      break;
-    }
-    case 0x08: { // or  imm
-      spc_or(spc, spc_adrImm(spc));
-      break;
-    }
-    case 0x09: { // orm dp, dp
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpDp(spc, &src);
-      spc_orm(spc, dst, src);
-      break;
-    }
-    case 0x0a: { // or1 abs.bit
-      uint16_t adr = 0;
-      uint8_t bit = spc_adrAbsBit(spc, &adr);
-      spc->c = spc->c | ((spc_read(spc, adr) >> bit) & 1);
-      break;
-    }
-    case 0x0b: { // asl dp
-      spc_asl(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0x0c: { // asl abs
-      spc_asl(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0x0d: { // pushp imp
-      spc_pushByte(spc, spc_getFlags(spc));
-      break;
-    }
-    case 0x0e: { // tset1 abs
-      uint16_t adr = spc_adrAbs(spc);
-      uint8_t val = spc_read(spc, adr);
-      uint8_t result = spc->a + (val ^ 0xff) + 1;
-      spc_setZN(spc, result);
-      spc_write(spc, adr, val | spc->a);
-      break;
-    }
-    case 0x0f: { // brk imp
-      spc_pushWord(spc, spc->pc);
-      spc_pushByte(spc, spc_getFlags(spc));
-      spc->i = false;
-      spc->b = true;
-      spc->pc = spc_readWord(spc, 0xffde, 0xffdf);
-      break;
-    }
-    case 0x10: { // bpl rel
-      spc_doBranch(spc, spc_readOpcode(spc), !spc->n);
-      break;
-    }
-    case 0x14: { // or  dpx
-      spc_or(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0x15: { // or  abx
-      spc_or(spc, spc_adrAbx(spc));
-      break;
-    }
-    case 0x16: { // or  aby
-      spc_or(spc, spc_adrAby(spc));
-      break;
-    }
-    case 0x17: { // or  idy
-      spc_or(spc, spc_adrIdy(spc));
-      break;
-    }
-    case 0x18: { // orm dp, imm
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpImm(spc, &src);
-      spc_orm(spc, dst, src);
-      break;
-    }
-    case 0x19: { // orm ind, ind
-      uint16_t src = 0;
-      uint16_t dst = spc_adrIndInd(spc, &src);
-      spc_orm(spc, dst, src);
-      break;
-    }
-    case 0x1a: { // decw dp
-      uint16_t low = 0;
-      uint16_t high = spc_adrDpWord(spc, &low);
-      uint16_t value = spc_readWord(spc, low, high) - 1;
-      spc->z = value == 0;
-      spc->n = value & 0x8000;
-      spc_writeWord(spc, low, high, value);
-      break;
-    }
-    case 0x1b: { // asl dpx
-      spc_asl(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0x1c: { // asla imp
-      spc->c = spc->a & 0x80;
-      spc->a <<= 1;
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0x1d: { // decx imp
-      spc->x--;
-      spc_setZN(spc, spc->x);
-      break;
-    }
-    case 0x1e: { // cmpx abs
-      spc_cmpx(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0x1f: { // jmp iax
-      uint16_t pointer = spc_readOpcodeWord(spc);
-      spc->pc = spc_readWord(spc, (pointer + spc->x) & 0xffff, (pointer + spc->x + 1) & 0xffff);
-      break;
-    }
-    case 0x20: { // clrp imp
-      spc->p = false;
-      break;
-    }
-    case 0x24: { // and dp
-      spc_and(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0x25: { // and abs
-      spc_and(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0x26: { // and ind
-      spc_and(spc, spc_adrInd(spc));
-      break;
-    }
-    case 0x27: { // and idx
-      spc_and(spc, spc_adrIdx(spc));
-      break;
-    }
-    case 0x28: { // and imm
-      spc_and(spc, spc_adrImm(spc));
-      break;
-    }
-    case 0x29: { // andm dp, dp
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpDp(spc, &src);
-      spc_andm(spc, dst, src);
-      break;
-    }
-    case 0x2a: { // or1n abs.bit
-      uint16_t adr = 0;
-      uint8_t bit = spc_adrAbsBit(spc, &adr);
-      spc->c = spc->c | (~(spc_read(spc, adr) >> bit) & 1);
-      break;
-    }
-    case 0x2b: { // rol dp
-      spc_rol(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0x2c: { // rol abs
-      spc_rol(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0x2d: { // pusha imp
-      spc_pushByte(spc, spc->a);
-      break;
-    }
-    case 0x2e: { // cbne dp, rel
-      uint8_t val = spc_read(spc, spc_adrDp(spc)) ^ 0xff;
-      uint8_t result = spc->a + val + 1;
-      spc_doBranch(spc, spc_readOpcode(spc), result != 0);
-      break;
-    }
-    case 0x2f: { // bra rel
-      spc->pc += (int8_t) spc_readOpcode(spc);
-      break;
-    }
-    case 0x30: { // bmi rel
-      spc_doBranch(spc, spc_readOpcode(spc), spc->n);
-      break;
-    }
-    case 0x34: { // and dpx
-      spc_and(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0x35: { // and abx
-      spc_and(spc, spc_adrAbx(spc));
-      break;
-    }
-    case 0x36: { // and aby
-      spc_and(spc, spc_adrAby(spc));
-      break;
-    }
-    case 0x37: { // and idy
-      spc_and(spc, spc_adrIdy(spc));
-      break;
-    }
-    case 0x38: { // andm dp, imm
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpImm(spc, &src);
-      spc_andm(spc, dst, src);
-      break;
-    }
-    case 0x39: { // andm ind, ind
-      uint16_t src = 0;
-      uint16_t dst = spc_adrIndInd(spc, &src);
-      spc_andm(spc, dst, src);
-      break;
-    }
-    case 0x3a: { // incw dp
-      uint16_t low = 0;
-      uint16_t high = spc_adrDpWord(spc, &low);
-      uint16_t value = spc_readWord(spc, low, high) + 1;
-      spc->z = value == 0;
-      spc->n = value & 0x8000;
-      spc_writeWord(spc, low, high, value);
-      break;
-    }
-    case 0x3b: { // rol dpx
-      spc_rol(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0x3c: { // rola imp
-      bool newC = spc->a & 0x80;
-      spc->a = (spc->a << 1) | spc->c;
-      spc->c = newC;
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0x3d: { // incx imp
-      spc->x++;
-      spc_setZN(spc, spc->x);
-      break;
-    }
-    case 0x3e: { // cmpx dp
-      spc_cmpx(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0x3f: { // call abs
-      uint16_t dst = spc_readOpcodeWord(spc);
-      spc_pushWord(spc, spc->pc);
-      spc->pc = dst;
-      break;
-    }
-    case 0x40: { // setp imp
-      spc->p = true;
-      break;
-    }
-    case 0x44: { // eor dp
-      spc_eor(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0x45: { // eor abs
-      spc_eor(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0x46: { // eor ind
-      spc_eor(spc, spc_adrInd(spc));
-      break;
-    }
-    case 0x47: { // eor idx
-      spc_eor(spc, spc_adrIdx(spc));
-      break;
-    }
-    case 0x48: { // eor imm
-      spc_eor(spc, spc_adrImm(spc));
-      break;
-    }
-    case 0x49: { // eorm dp, dp
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpDp(spc, &src);
-      spc_eorm(spc, dst, src);
-      break;
-    }
-    case 0x4a: { // and1 abs.bit
-      uint16_t adr = 0;
-      uint8_t bit = spc_adrAbsBit(spc, &adr);
-      spc->c = spc->c & ((spc_read(spc, adr) >> bit) & 1);
-      break;
-    }
-    case 0x4b: { // lsr dp
-      spc_lsr(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0x4c: { // lsr abs
-      spc_lsr(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0x4d: { // pushx imp
-      spc_pushByte(spc, spc->x);
-      break;
-    }
-    case 0x4e: { // tclr1 abs
-      uint16_t adr = spc_adrAbs(spc);
-      uint8_t val = spc_read(spc, adr);
-      uint8_t result = spc->a + (val ^ 0xff) + 1;
-      spc_setZN(spc, result);
-      spc_write(spc, adr, val & ~spc->a);
-      break;
-    }
-    case 0x4f: { // pcall dp
-      uint8_t dst = spc_readOpcode(spc);
-      spc_pushWord(spc, spc->pc);
-      spc->pc = 0xff00 | dst;
-      break;
-    }
-    case 0x50: { // bvc rel
-      spc_doBranch(spc, spc_readOpcode(spc), !spc->v);
-      break;
-    }
-    case 0x54: { // eor dpx
-      spc_eor(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0x55: { // eor abx
-      spc_eor(spc, spc_adrAbx(spc));
-      break;
-    }
-    case 0x56: { // eor aby
-      spc_eor(spc, spc_adrAby(spc));
-      break;
-    }
-    case 0x57: { // eor idy
-      spc_eor(spc, spc_adrIdy(spc));
-      break;
-    }
-    case 0x58: { // eorm dp, imm
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpImm(spc, &src);
-      spc_eorm(spc, dst, src);
-      break;
-    }
-    case 0x59: { // eorm ind, ind
-      uint16_t src = 0;
-      uint16_t dst = spc_adrIndInd(spc, &src);
-      spc_eorm(spc, dst, src);
-      break;
-    }
-    case 0x5a: { // cmpw dp
-      uint16_t low = 0;
-      uint16_t high = spc_adrDpWord(spc, &low);
-      uint16_t value = spc_readWord(spc, low, high) ^ 0xffff;
-      uint16_t ya = spc->a | (spc->y << 8);
-      int result = ya + value + 1;
-      spc->c = result > 0xffff;
-      spc->z = (result & 0xffff) == 0;
-      spc->n = result & 0x8000;
-      break;
-    }
-    case 0x5b: { // lsr dpx
-      spc_lsr(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0x5c: { // lsra imp
-      spc->c = spc->a & 1;
-      spc->a >>= 1;
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0x5d: { // movxa imp
-      spc->x = spc->a;
-      spc_setZN(spc, spc->x);
-      break;
-    }
-    case 0x5e: { // cmpy abs
-      spc_cmpy(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0x5f: { // jmp abs
-      spc->pc = spc_readOpcodeWord(spc);
-      break;
-    }
-    case 0x60: { // clrc imp
-      spc->c = false;
-      break;
-    }
-    case 0x64: { // cmp dp
-      spc_cmp(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0x65: { // cmp abs
-      spc_cmp(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0x66: { // cmp ind
-      spc_cmp(spc, spc_adrInd(spc));
-      break;
-    }
-    case 0x67: { // cmp idx
-      spc_cmp(spc, spc_adrIdx(spc));
-      break;
-    }
-    case 0x68: { // cmp imm
-      spc_cmp(spc, spc_adrImm(spc));
-      break;
-    }
-    case 0x69: { // cmpm dp, dp
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpDp(spc, &src);
-      spc_cmpm(spc, dst, src);
-      break;
-    }
-    case 0x6a: { // and1n abs.bit
-      uint16_t adr = 0;
-      uint8_t bit = spc_adrAbsBit(spc, &adr);
-      spc->c = spc->c & (~(spc_read(spc, adr) >> bit) & 1);
-      break;
-    }
-    case 0x6b: { // ror dp
-      spc_ror(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0x6c: { // ror abs
-      spc_ror(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0x6d: { // pushy imp
-      spc_pushByte(spc, spc->y);
-      break;
-    }
-    case 0x6e: { // dbnz dp, rel
-      uint16_t adr = spc_adrDp(spc);
-      uint8_t result = spc_read(spc, adr) - 1;
-      spc_write(spc, adr, result);
-      spc_doBranch(spc, spc_readOpcode(spc), result != 0);
-      break;
-    }
-    case 0x6f: { // ret imp
-      spc->pc = spc_pullWord(spc);
-      break;
-    }
-    case 0x70: { // bvs rel
-      spc_doBranch(spc, spc_readOpcode(spc), spc->v);
-      break;
-    }
-    case 0x74: { // cmp dpx
-      spc_cmp(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0x75: { // cmp abx
-      spc_cmp(spc, spc_adrAbx(spc));
-      break;
-    }
-    case 0x76: { // cmp aby
-      spc_cmp(spc, spc_adrAby(spc));
-      break;
-    }
-    case 0x77: { // cmp idy
-      spc_cmp(spc, spc_adrIdy(spc));
-      break;
-    }
-    case 0x78: { // cmpm dp, imm
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpImm(spc, &src);
-      spc_cmpm(spc, dst, src);
-      break;
-    }
-    case 0x79: { // cmpm ind, ind
-      uint16_t src = 0;
-      uint16_t dst = spc_adrIndInd(spc, &src);
-      spc_cmpm(spc, dst, src);
-      break;
-    }
-    case 0x7a: { // addw dp
-      uint16_t low = 0;
-      uint16_t high = spc_adrDpWord(spc, &low);
-      uint16_t value = spc_readWord(spc, low, high);
-      uint16_t ya = spc->a | (spc->y << 8);
-      int result = ya + value;
-      spc->v = (ya & 0x8000) == (value & 0x8000) && (value & 0x8000) != (result & 0x8000);
-      spc->h = ((ya & 0xfff) + (value & 0xfff) + 1) > 0xfff;
-      spc->c = result > 0xffff;
-      spc->z = (result & 0xffff) == 0;
-      spc->n = result & 0x8000;
-      spc->a = result & 0xff;
-      spc->y = result >> 8;
-      break;
-    }
-    case 0x7b: { // ror dpx
-      spc_ror(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0x7c: { // rora imp
-      bool newC = spc->a & 1;
-      spc->a = (spc->a >> 1) | (spc->c << 7);
-      spc->c = newC;
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0x7d: { // movax imp
-      spc->a = spc->x;
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0x7e: { // cmpy dp
-      spc_cmpy(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0x7f: { // reti imp
-      spc_setFlags(spc, spc_pullByte(spc));
-      spc->pc = spc_pullWord(spc);
-      break;
-    }
-    case 0x80: { // setc imp
-      spc->c = true;
-      break;
-    }
-    case 0x84: { // adc dp
-      spc_adc(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0x85: { // adc abs
-      spc_adc(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0x86: { // adc ind
-      spc_adc(spc, spc_adrInd(spc));
-      break;
-    }
-    case 0x87: { // adc idx
-      spc_adc(spc, spc_adrIdx(spc));
-      break;
-    }
-    case 0x88: { // adc imm
-      spc_adc(spc, spc_adrImm(spc));
-      break;
-    }
-    case 0x89: { // adcm dp, dp
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpDp(spc, &src);
-      spc_adcm(spc, dst, src);
-      break;
-    }
-    case 0x8a: { // eor1 abs.bit
-      uint16_t adr = 0;
-      uint8_t bit = spc_adrAbsBit(spc, &adr);
-      spc->c = spc->c ^ ((spc_read(spc, adr) >> bit) & 1);
-      break;
-    }
-    case 0x8b: { // dec dp
-      spc_dec(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0x8c: { // dec abs
-      spc_dec(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0x8d: { // movy imm
-      spc_movy(spc, spc_adrImm(spc));
-      break;
-    }
-    case 0x8e: { // popp imp
-      spc_setFlags(spc, spc_pullByte(spc));
-      break;
-    }
-    case 0x8f: { // movm dp, imm
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpImm(spc, &src);
-      uint8_t val = spc_read(spc, src);
-      spc_read(spc, dst);
-      spc_write(spc, dst, val);
-      break;
-    }
-    case 0x90: { // bcc rel
-      spc_doBranch(spc, spc_readOpcode(spc), !spc->c);
-      break;
-    }
-    case 0x94: { // adc dpx
-      spc_adc(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0x95: { // adc abx
-      spc_adc(spc, spc_adrAbx(spc));
-      break;
-    }
-    case 0x96: { // adc aby
-      spc_adc(spc, spc_adrAby(spc));
-      break;
-    }
-    case 0x97: { // adc idy
-      spc_adc(spc, spc_adrIdy(spc));
-      break;
-    }
-    case 0x98: { // adcm dp, imm
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpImm(spc, &src);
-      spc_adcm(spc, dst, src);
-      break;
-    }
-    case 0x99: { // adcm ind, ind
-      uint16_t src = 0;
-      uint16_t dst = spc_adrIndInd(spc, &src);
-      spc_adcm(spc, dst, src);
-      break;
-    }
-    case 0x9a: { // subw dp
-      uint16_t low = 0;
-      uint16_t high = spc_adrDpWord(spc, &low);
-      uint16_t value = spc_readWord(spc, low, high) ^ 0xffff;
-      uint16_t ya = spc->a | (spc->y << 8);
-      int result = ya + value + 1;
-      spc->v = (ya & 0x8000) == (value & 0x8000) && (value & 0x8000) != (result & 0x8000);
-      spc->h = ((ya & 0xfff) + (value & 0xfff) + 1) > 0xfff;
-      spc->c = result > 0xffff;
-      spc->z = (result & 0xffff) == 0;
-      spc->n = result & 0x8000;
-      spc->a = result & 0xff;
-      spc->y = result >> 8;
-      break;
-    }
-    case 0x9b: { // dec dpx
-      spc_dec(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0x9c: { // deca imp
-      spc->a--;
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0x9d: { // movxp imp
-      spc->x = spc->sp;
-      spc_setZN(spc, spc->x);
-      break;
-    }
-    case 0x9e: { // div imp
-      // TODO: proper division algorithm
-      uint16_t value = spc->a | (spc->y << 8);
-      int result = 0xffff;
-      int mod = spc->a;
-      if(spc->x != 0) {
-        result = value / spc->x;
-        mod = value % spc->x;
-      }
-      spc->v = result > 0xff;
-      spc->h = (spc->x & 0xf) <= (spc->y & 0xf);
-      spc->a = result;
-      spc->y = mod;
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0x9f: { // xcn imp
-      spc->a = (spc->a >> 4) | (spc->a << 4);
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0xa0: { // ei  imp
-      spc->i = true;
-      break;
-    }
-    case 0xa4: { // sbc dp
-      spc_sbc(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0xa5: { // sbc abs
-      spc_sbc(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0xa6: { // sbc ind
-      spc_sbc(spc, spc_adrInd(spc));
-      break;
-    }
-    case 0xa7: { // sbc idx
-      spc_sbc(spc, spc_adrIdx(spc));
-      break;
-    }
-    case 0xa8: { // sbc imm
-      spc_sbc(spc, spc_adrImm(spc));
-      break;
-    }
-    case 0xa9: { // sbcm dp, dp
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpDp(spc, &src);
-      spc_sbcm(spc, dst, src);
-      break;
-    }
-    case 0xaa: { // mov1 abs.bit
-      uint16_t adr = 0;
-      uint8_t bit = spc_adrAbsBit(spc, &adr);
-      spc->c = (spc_read(spc, adr) >> bit) & 1;
-      break;
-    }
-    case 0xab: { // inc dp
-      spc_inc(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0xac: { // inc abs
-      spc_inc(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0xad: { // cmpy imm
-      spc_cmpy(spc, spc_adrImm(spc));
-      break;
-    }
-    case 0xae: { // popa imp
-      spc->a = spc_pullByte(spc);
-      break;
-    }
-    case 0xaf: { // movs ind+
-      uint16_t adr = spc_adrIndP(spc);
-      spc_write(spc, adr, spc->a);
-      break;
-    }
-    case 0xb0: { // bcs rel
-      spc_doBranch(spc, spc_readOpcode(spc), spc->c);
-      break;
-    }
-    case 0xb4: { // sbc dpx
-      spc_sbc(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0xb5: { // sbc abx
-      spc_sbc(spc, spc_adrAbx(spc));
-      break;
-    }
-    case 0xb6: { // sbc aby
-      spc_sbc(spc, spc_adrAby(spc));
-      break;
-    }
-    case 0xb7: { // sbc idy
-      spc_sbc(spc, spc_adrIdy(spc));
-      break;
-    }
-    case 0xb8: { // sbcm dp, imm
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpImm(spc, &src);
-      spc_sbcm(spc, dst, src);
-      break;
-    }
-    case 0xb9: { // sbcm ind, ind
-      uint16_t src = 0;
-      uint16_t dst = spc_adrIndInd(spc, &src);
-      spc_sbcm(spc, dst, src);
-      break;
-    }
-    case 0xba: { // movw dp
-      uint16_t low = 0;
-      uint16_t high = spc_adrDpWord(spc, &low);
-      uint16_t val = spc_readWord(spc, low, high);
-      spc->a = val & 0xff;
-      spc->y = val >> 8;
-      spc->z = val == 0;
-      spc->n = val & 0x8000;
-      break;
-    }
-    case 0xbb: { // inc dpx
-      spc_inc(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0xbc: { // inca imp
-      spc->a++;
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0xbd: { // movpx imp
-      spc->sp = spc->x;
-      break;
-    }
-    case 0xbe: { // das imp
-      if(spc->a > 0x99 || !spc->c) {
-        spc->a -= 0x60;
+// Runs opcodes for |cycles| cycles, advancing the timers and dsp after each
+// one, and returns how many cycles of the last opcode are still to be run.
+// With |cycles| == 0 runs a single opcode without advancing anything and
+// returns its length.
+static int spc_execute(Spc* spc, int cycles) {
+#define SPC_TICK() do { \
+    if(cycles == 0) return spc->cyclesUsed; \
+    cycles -= spc->cyclesUsed; \
+    apu_advance(spc->apu, cycles < 0 ? spc->cyclesUsed + cycles : spc->cyclesUsed); \
+    if(cycles <= 0) return -cycles; \
+  } while(0)
+#define SPC_FETCH() do { \
+    if(spc->stopped) { \
+      apu_advance(spc->apu, cycles); \
+      return 0; \
+    } \
+    opcode = spc_readOpcode(spc); \
+    spc->cyclesUsed = cyclesPerOpcode[opcode]; \
+  } while(0)
+#if SPC_THREADED
+  // every handler ends with its own jump to the next one
+  static const void* const opcodeLabels[256] = {
+    &&op_00, &&op_01, &&op_02, &&op_03, &&op_04, &&op_05, &&op_06, &&op_07, &&op_08, &&op_09, &&op_0a, &&op_0b, &&op_0c, &&op_0d, &&op_0e, &&op_0f,
+    &&op_10, &&op_11, &&op_12, &&op_13, &&op_14, &&op_15, &&op_16, &&op_17, &&op_18, &&op_19, &&op_1a, &&op_1b, &&op_1c, &&op_1d, &&op_1e, &&op_1f,
+    &&op_20, &&op_21, &&op_22, &&op_23, &&op_24, &&op_25, &&op_26, &&op_27, &&op_28, &&op_29, &&op_2a, &&op_2b, &&op_2c, &&op_2d, &&op_2e, &&op_2f,
+    &&op_30, &&op_31, &&op_32, &&op_33, &&op_34, &&op_35, &&op_36, &&op_37, &&op_38, &&op_39, &&op_3a, &&op_3b, &&op_3c, &&op_3d, &&op_3e, &&op_3f,
+    &&op_40, &&op_41, &&op_42, &&op_43, &&op_44, &&op_45, &&op_46, &&op_47, &&op_48, &&op_49, &&op_4a, &&op_4b, &&op_4c, &&op_4d, &&op_4e, &&op_4f,
+    &&op_50, &&op_51, &&op_52, &&op_53, &&op_54, &&op_55, &&op_56, &&op_57, &&op_58, &&op_59, &&op_5a, &&op_5b, &&op_5c, &&op_5d, &&op_5e, &&op_5f,
+    &&op_60, &&op_61, &&op_62, &&op_63, &&op_64, &&op_65, &&op_66, &&op_67, &&op_68, &&op_69, &&op_6a, &&op_6b, &&op_6c, &&op_6d, &&op_6e, &&op_6f,
+    &&op_70, &&op_71, &&op_72, &&op_73, &&op_74, &&op_75, &&op_76, &&op_77, &&op_78, &&op_79, &&op_7a, &&op_7b, &&op_7c, &&op_7d, &&op_7e, &&op_7f,
+    &&op_80, &&op_81, &&op_82, &&op_83, &&op_84, &&op_85, &&op_86, &&op_87, &&op_88, &&op_89, &&op_8a, &&op_8b, &&op_8c, &&op_8d, &&op_8e, &&op_8f,
+    &&op_90, &&op_91, &&op_92, &&op_93, &&op_94, &&op_95, &&op_96, &&op_97, &&op_98, &&op_99, &&op_9a, &&op_9b, &&op_9c, &&op_9d, &&op_9e, &&op_9f,
+    &&op_a0, &&op_a1, &&op_a2, &&op_a3, &&op_a4, &&op_a5, &&op_a6, &&op_a7, &&op_a8, &&op_a9, &&op_aa, &&op_ab, &&op_ac, &&op_ad, &&op_ae, &&op_af,
+    &&op_b0, &&op_b1, &&op_b2, &&op_b3, &&op_b4, &&op_b5, &&op_b6, &&op_b7, &&op_b8, &&op_b9, &&op_ba, &&op_bb, &&op_bc, &&op_bd, &&op_be, &&op_bf,
+    &&op_c0, &&op_c1, &&op_c2, &&op_c3, &&op_c4, &&op_c5, &&op_c6, &&op_c7, &&op_c8, &&op_c9, &&op_ca, &&op_cb, &&op_cc, &&op_cd, &&op_ce, &&op_cf,
+    &&op_d0, &&op_d1, &&op_d2, &&op_d3, &&op_d4, &&op_d5, &&op_d6, &&op_d7, &&op_d8, &&op_d9, &&op_da, &&op_db, &&op_dc, &&op_dd, &&op_de, &&op_df,
+    &&op_e0, &&op_e1, &&op_e2, &&op_e3, &&op_e4, &&op_e5, &&op_e6, &&op_e7, &&op_e8, &&op_e9, &&op_ea, &&op_eb, &&op_ec, &&op_ed, &&op_ee, &&op_ef,
+    &&op_f0, &&op_f1, &&op_f2, &&op_f3, &&op_f4, &&op_f5, &&op_f6, &&op_f7, &&op_f8, &&op_f9, &&op_fa, &&op_fb, &&op_fc, &&op_fd, &&op_fe, &&op_ff,
+  };
+#define SPC_OP(n) op_##n:
+#define SPC_NEXT do { SPC_TICK(); SPC_FETCH(); goto *opcodeLabels[opcode]; } while(0)
+#else
+#define SPC_OP(n)
+#define SPC_NEXT break
+#endif
+  uint8_t opcode;
+  if(cycles != 0 && spc->stopped) {
+    apu_advance(spc->apu, cycles);
+    return 0;
+  }
+  opcode = spc_readOpcode(spc);
+  spc->cyclesUsed = cyclesPerOpcode[opcode];
+#if SPC_THREADED
+  goto *opcodeLabels[opcode];
+#endif
+  for(;;) {
+    switch(opcode) {
+      case 0x00: SPC_OP(00) { // nop imp
+        // no operation
+        SPC_NEXT;
+      }
+      case 0x01: SPC_OP(01)
+      case 0x11: SPC_OP(11)
+      case 0x21: SPC_OP(21)
+      case 0x31: SPC_OP(31)
+      case 0x41: SPC_OP(41)
+      case 0x51: SPC_OP(51)
+      case 0x61: SPC_OP(61)
+      case 0x71: SPC_OP(71)
+      case 0x81: SPC_OP(81)
+      case 0x91: SPC_OP(91)
+      case 0xa1: SPC_OP(a1)
+      case 0xb1: SPC_OP(b1)
+      case 0xc1: SPC_OP(c1)
+      case 0xd1: SPC_OP(d1)
+      case 0xe1: SPC_OP(e1)
+      case 0xf1: SPC_OP(f1) { // tcall imp
+        spc_pushWord(spc, spc->pc);
+        uint16_t adr = 0xffde - (2 * (opcode >> 4));
+        spc->pc = spc_readWord(spc, adr, adr + 1);
+        SPC_NEXT;
+      }
+      case 0x02: SPC_OP(02)
+      case 0x22: SPC_OP(22)
+      case 0x42: SPC_OP(42)
+      case 0x62: SPC_OP(62)
+      case 0x82: SPC_OP(82)
+      case 0xa2: SPC_OP(a2)
+      case 0xc2: SPC_OP(c2)
+      case 0xe2: SPC_OP(e2) { // set1 dp
+        uint16_t adr = spc_adrDp(spc);
+        spc_write(spc, adr, spc_read(spc, adr) | (1 << (opcode >> 5)));
+        SPC_NEXT;
+      }
+      case 0x12: SPC_OP(12)
+      case 0x32: SPC_OP(32)
+      case 0x52: SPC_OP(52)
+      case 0x72: SPC_OP(72)
+      case 0x92: SPC_OP(92)
+      case 0xb2: SPC_OP(b2)
+      case 0xd2: SPC_OP(d2)
+      case 0xf2: SPC_OP(f2) { // clr1 dp
+        uint16_t adr = spc_adrDp(spc);
+        spc_write(spc, adr, spc_read(spc, adr) & ~(1 << (opcode >> 5)));
+        SPC_NEXT;
+      }
+      case 0x03: SPC_OP(03)
+      case 0x23: SPC_OP(23)
+      case 0x43: SPC_OP(43)
+      case 0x63: SPC_OP(63)
+      case 0x83: SPC_OP(83)
+      case 0xa3: SPC_OP(a3)
+      case 0xc3: SPC_OP(c3)
+      case 0xe3: SPC_OP(e3) { // bbs dp, rel
+        uint8_t val = spc_read(spc, spc_adrDp(spc));
+        spc_doBranch(spc, spc_readOpcode(spc), val & (1 << (opcode >> 5)));
+        SPC_NEXT;
+      }
+      case 0x13: SPC_OP(13)
+      case 0x33: SPC_OP(33)
+      case 0x53: SPC_OP(53)
+      case 0x73: SPC_OP(73)
+      case 0x93: SPC_OP(93)
+      case 0xb3: SPC_OP(b3)
+      case 0xd3: SPC_OP(d3)
+      case 0xf3: SPC_OP(f3) { // bbc dp, rel
+        uint8_t val = spc_read(spc, spc_adrDp(spc));
+        spc_doBranch(spc, spc_readOpcode(spc), (val & (1 << (opcode >> 5))) == 0);
+        SPC_NEXT;
+      }
+      case 0x04: SPC_OP(04) { // or  dp
+        spc_or(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0x05: SPC_OP(05) { // or  abs
+        spc_or(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0x06: SPC_OP(06) { // or  ind
+        spc_or(spc, spc_adrInd(spc));
+        SPC_NEXT;
+      }
+      case 0x07: SPC_OP(07) { // or  idx
+        spc_or(spc, spc_adrIdx(spc));
+        SPC_NEXT;
+      }
+      case 0x08: SPC_OP(08) { // or  imm
+        spc_or(spc, spc_adrImm(spc));
+        SPC_NEXT;
+      }
+      case 0x09: SPC_OP(09) { // orm dp, dp
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpDp(spc, &src);
+        spc_orm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x0a: SPC_OP(0a) { // or1 abs.bit
+        uint16_t adr = 0;
+        uint8_t bit = spc_adrAbsBit(spc, &adr);
+        spc->c = spc->c | ((spc_read(spc, adr) >> bit) & 1);
+        SPC_NEXT;
+      }
+      case 0x0b: SPC_OP(0b) { // asl dp
+        spc_asl(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0x0c: SPC_OP(0c) { // asl abs
+        spc_asl(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0x0d: SPC_OP(0d) { // pushp imp
+        spc_pushByte(spc, spc_getFlags(spc));
+        SPC_NEXT;
+      }
+      case 0x0e: SPC_OP(0e) { // tset1 abs
+        uint16_t adr = spc_adrAbs(spc);
+        uint8_t val = spc_read(spc, adr);
+        uint8_t result = spc->a + (val ^ 0xff) + 1;
+        spc_setZN(spc, result);
+        spc_write(spc, adr, val | spc->a);
+        SPC_NEXT;
+      }
+      case 0x0f: SPC_OP(0f) { // brk imp
+        spc_pushWord(spc, spc->pc);
+        spc_pushByte(spc, spc_getFlags(spc));
+        spc->i = false;
+        spc->b = true;
+        spc->pc = spc_readWord(spc, 0xffde, 0xffdf);
+        SPC_NEXT;
+      }
+      case 0x10: SPC_OP(10) { // bpl rel
+        spc_doBranch(spc, spc_readOpcode(spc), !spc->n);
+        SPC_NEXT;
+      }
+      case 0x14: SPC_OP(14) { // or  dpx
+        spc_or(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0x15: SPC_OP(15) { // or  abx
+        spc_or(spc, spc_adrAbx(spc));
+        SPC_NEXT;
+      }
+      case 0x16: SPC_OP(16) { // or  aby
+        spc_or(spc, spc_adrAby(spc));
+        SPC_NEXT;
+      }
+      case 0x17: SPC_OP(17) { // or  idy
+        spc_or(spc, spc_adrIdy(spc));
+        SPC_NEXT;
+      }
+      case 0x18: SPC_OP(18) { // orm dp, imm
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpImm(spc, &src);
+        spc_orm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x19: SPC_OP(19) { // orm ind, ind
+        uint16_t src = 0;
+        uint16_t dst = spc_adrIndInd(spc, &src);
+        spc_orm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x1a: SPC_OP(1a) { // decw dp
+        uint16_t low = 0;
+        uint16_t high = spc_adrDpWord(spc, &low);
+        uint16_t value = spc_readWord(spc, low, high) - 1;
+        spc->z = value == 0;
+        spc->n = value & 0x8000;
+        spc_writeWord(spc, low, high, value);
+        SPC_NEXT;
+      }
+      case 0x1b: SPC_OP(1b) { // asl dpx
+        spc_asl(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0x1c: SPC_OP(1c) { // asla imp
+        spc->c = spc->a & 0x80;
+        spc->a <<= 1;
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0x1d: SPC_OP(1d) { // decx imp
+        spc->x--;
+        spc_setZN(spc, spc->x);
+        SPC_NEXT;
+      }
+      case 0x1e: SPC_OP(1e) { // cmpx abs
+        spc_cmpx(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0x1f: SPC_OP(1f) { // jmp iax
+        uint16_t pointer = spc_readOpcodeWord(spc);
+        spc->pc = spc_readWord(spc, (pointer + spc->x) & 0xffff, (pointer + spc->x + 1) & 0xffff);
+        SPC_NEXT;
+      }
+      case 0x20: SPC_OP(20) { // clrp imp
+        spc->p = false;
+        SPC_NEXT;
+      }
+      case 0x24: SPC_OP(24) { // and dp
+        spc_and(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0x25: SPC_OP(25) { // and abs
+        spc_and(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0x26: SPC_OP(26) { // and ind
+        spc_and(spc, spc_adrInd(spc));
+        SPC_NEXT;
+      }
+      case 0x27: SPC_OP(27) { // and idx
+        spc_and(spc, spc_adrIdx(spc));
+        SPC_NEXT;
+      }
+      case 0x28: SPC_OP(28) { // and imm
+        spc_and(spc, spc_adrImm(spc));
+        SPC_NEXT;
+      }
+      case 0x29: SPC_OP(29) { // andm dp, dp
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpDp(spc, &src);
+        spc_andm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x2a: SPC_OP(2a) { // or1n abs.bit
+        uint16_t adr = 0;
+        uint8_t bit = spc_adrAbsBit(spc, &adr);
+        spc->c = spc->c | (~(spc_read(spc, adr) >> bit) & 1);
+        SPC_NEXT;
+      }
+      case 0x2b: SPC_OP(2b) { // rol dp
+        spc_rol(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0x2c: SPC_OP(2c) { // rol abs
+        spc_rol(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0x2d: SPC_OP(2d) { // pusha imp
+        spc_pushByte(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0x2e: SPC_OP(2e) { // cbne dp, rel
+        uint8_t val = spc_read(spc, spc_adrDp(spc)) ^ 0xff;
+        uint8_t result = spc->a + val + 1;
+        spc_doBranch(spc, spc_readOpcode(spc), result != 0);
+        SPC_NEXT;
+      }
+      case 0x2f: SPC_OP(2f) { // bra rel
+        spc->pc += (int8_t) spc_readOpcode(spc);
+        SPC_NEXT;
+      }
+      case 0x30: SPC_OP(30) { // bmi rel
+        spc_doBranch(spc, spc_readOpcode(spc), spc->n);
+        SPC_NEXT;
+      }
+      case 0x34: SPC_OP(34) { // and dpx
+        spc_and(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0x35: SPC_OP(35) { // and abx
+        spc_and(spc, spc_adrAbx(spc));
+        SPC_NEXT;
+      }
+      case 0x36: SPC_OP(36) { // and aby
+        spc_and(spc, spc_adrAby(spc));
+        SPC_NEXT;
+      }
+      case 0x37: SPC_OP(37) { // and idy
+        spc_and(spc, spc_adrIdy(spc));
+        SPC_NEXT;
+      }
+      case 0x38: SPC_OP(38) { // andm dp, imm
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpImm(spc, &src);
+        spc_andm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x39: SPC_OP(39) { // andm ind, ind
+        uint16_t src = 0;
+        uint16_t dst = spc_adrIndInd(spc, &src);
+        spc_andm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x3a: SPC_OP(3a) { // incw dp
+        uint16_t low = 0;
+        uint16_t high = spc_adrDpWord(spc, &low);
+        uint16_t value = spc_readWord(spc, low, high) + 1;
+        spc->z = value == 0;
+        spc->n = value & 0x8000;
+        spc_writeWord(spc, low, high, value);
+        SPC_NEXT;
+      }
+      case 0x3b: SPC_OP(3b) { // rol dpx
+        spc_rol(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0x3c: SPC_OP(3c) { // rola imp
+        bool newC = spc->a & 0x80;
+        spc->a = (spc->a << 1) | spc->c;
+        spc->c = newC;
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0x3d: SPC_OP(3d) { // incx imp
+        spc->x++;
+        spc_setZN(spc, spc->x);
+        SPC_NEXT;
+      }
+      case 0x3e: SPC_OP(3e) { // cmpx dp
+        spc_cmpx(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0x3f: SPC_OP(3f) { // call abs
+        uint16_t dst = spc_readOpcodeWord(spc);
+        spc_pushWord(spc, spc->pc);
+        spc->pc = dst;
+        SPC_NEXT;
+      }
+      case 0x40: SPC_OP(40) { // setp imp
+        spc->p = true;
+        SPC_NEXT;
+      }
+      case 0x44: SPC_OP(44) { // eor dp
+        spc_eor(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0x45: SPC_OP(45) { // eor abs
+        spc_eor(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0x46: SPC_OP(46) { // eor ind
+        spc_eor(spc, spc_adrInd(spc));
+        SPC_NEXT;
+      }
+      case 0x47: SPC_OP(47) { // eor idx
+        spc_eor(spc, spc_adrIdx(spc));
+        SPC_NEXT;
+      }
+      case 0x48: SPC_OP(48) { // eor imm
+        spc_eor(spc, spc_adrImm(spc));
+        SPC_NEXT;
+      }
+      case 0x49: SPC_OP(49) { // eorm dp, dp
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpDp(spc, &src);
+        spc_eorm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x4a: SPC_OP(4a) { // and1 abs.bit
+        uint16_t adr = 0;
+        uint8_t bit = spc_adrAbsBit(spc, &adr);
+        spc->c = spc->c & ((spc_read(spc, adr) >> bit) & 1);
+        SPC_NEXT;
+      }
+      case 0x4b: SPC_OP(4b) { // lsr dp
+        spc_lsr(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0x4c: SPC_OP(4c) { // lsr abs
+        spc_lsr(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0x4d: SPC_OP(4d) { // pushx imp
+        spc_pushByte(spc, spc->x);
+        SPC_NEXT;
+      }
+      case 0x4e: SPC_OP(4e) { // tclr1 abs
+        uint16_t adr = spc_adrAbs(spc);
+        uint8_t val = spc_read(spc, adr);
+        uint8_t result = spc->a + (val ^ 0xff) + 1;
+        spc_setZN(spc, result);
+        spc_write(spc, adr, val & ~spc->a);
+        SPC_NEXT;
+      }
+      case 0x4f: SPC_OP(4f) { // pcall dp
+        uint8_t dst = spc_readOpcode(spc);
+        spc_pushWord(spc, spc->pc);
+        spc->pc = 0xff00 | dst;
+        SPC_NEXT;
+      }
+      case 0x50: SPC_OP(50) { // bvc rel
+        spc_doBranch(spc, spc_readOpcode(spc), !spc->v);
+        SPC_NEXT;
+      }
+      case 0x54: SPC_OP(54) { // eor dpx
+        spc_eor(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0x55: SPC_OP(55) { // eor abx
+        spc_eor(spc, spc_adrAbx(spc));
+        SPC_NEXT;
+      }
+      case 0x56: SPC_OP(56) { // eor aby
+        spc_eor(spc, spc_adrAby(spc));
+        SPC_NEXT;
+      }
+      case 0x57: SPC_OP(57) { // eor idy
+        spc_eor(spc, spc_adrIdy(spc));
+        SPC_NEXT;
+      }
+      case 0x58: SPC_OP(58) { // eorm dp, imm
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpImm(spc, &src);
+        spc_eorm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x59: SPC_OP(59) { // eorm ind, ind
+        uint16_t src = 0;
+        uint16_t dst = spc_adrIndInd(spc, &src);
+        spc_eorm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x5a: SPC_OP(5a) { // cmpw dp
+        uint16_t low = 0;
+        uint16_t high = spc_adrDpWord(spc, &low);
+        uint16_t value = spc_readWord(spc, low, high) ^ 0xffff;
+        uint16_t ya = spc->a | (spc->y << 8);
+        int result = ya + value + 1;
+        spc->c = result > 0xffff;
+        spc->z = (result & 0xffff) == 0;
+        spc->n = result & 0x8000;
+        SPC_NEXT;
+      }
+      case 0x5b: SPC_OP(5b) { // lsr dpx
+        spc_lsr(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0x5c: SPC_OP(5c) { // lsra imp
+        spc->c = spc->a & 1;
+        spc->a >>= 1;
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0x5d: SPC_OP(5d) { // movxa imp
+        spc->x = spc->a;
+        spc_setZN(spc, spc->x);
+        SPC_NEXT;
+      }
+      case 0x5e: SPC_OP(5e) { // cmpy abs
+        spc_cmpy(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0x5f: SPC_OP(5f) { // jmp abs
+        spc->pc = spc_readOpcodeWord(spc);
+        SPC_NEXT;
+      }
+      case 0x60: SPC_OP(60) { // clrc imp
         spc->c = false;
+        SPC_NEXT;
       }
-      if((spc->a & 0xf) > 9 || !spc->h) {
-        spc->a -= 6;
+      case 0x64: SPC_OP(64) { // cmp dp
+        spc_cmp(spc, spc_adrDp(spc));
+        SPC_NEXT;
       }
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0xbf: { // mov ind+
-      uint16_t adr = spc_adrIndP(spc);
-      spc->a = spc_read(spc, adr);
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0xc0: { // di  imp
-      spc->i = false;
-      break;
-    }
-    case 0xc4: { // movs dp
-      spc_movs(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0xc5: { // movs abs
-      spc_movs(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0xc6: { // movs ind
-      spc_movs(spc, spc_adrInd(spc));
-      break;
-    }
-    case 0xc7: { // movs idx
-      spc_movs(spc, spc_adrIdx(spc));
-      break;
-    }
-    case 0xc8: { // cmpx imm
-      spc_cmpx(spc, spc_adrImm(spc));
-      break;
-    }
-    case 0xc9: { // movsx abs
-      spc_movsx(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0xca: { // mov1s abs.bit
-      uint16_t adr = 0;
-      uint8_t bit = spc_adrAbsBit(spc, &adr);
-      uint8_t result = (spc_read(spc, adr) & (~(1 << bit))) | (spc->c << bit);
-      spc_write(spc, adr, result);
-      break;
-    }
-    case 0xcb: { // movsy dp
-      spc_movsy(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0xcc: { // movsy abs
-      spc_movsy(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0xcd: { // movx imm
-      spc_movx(spc, spc_adrImm(spc));
-      break;
-    }
-    case 0xce: { // popx imp
-      spc->x = spc_pullByte(spc);
-      break;
-    }
-    case 0xcf: { // mul imp
-      uint16_t result = spc->a * spc->y;
-      spc->a = result & 0xff;
-      spc->y = result >> 8;
-      spc_setZN(spc, spc->y);
-      break;
-    }
-    case 0xd0: { // bne rel
-      spc_doBranch(spc, spc_readOpcode(spc), !spc->z);
-      break;
-    }
-    case 0xd4: { // movs dpx
-      spc_movs(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0xd5: { // movs abx
-      spc_movs(spc, spc_adrAbx(spc));
-      break;
-    }
-    case 0xd6: { // movs aby
-      spc_movs(spc, spc_adrAby(spc));
-      break;
-    }
-    case 0xd7: { // movs idy
-      spc_movs(spc, spc_adrIdy(spc));
-      break;
-    }
-    case 0xd8: { // movsx dp
-      spc_movsx(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0xd9: { // movsx dpy
-      spc_movsx(spc, spc_adrDpy(spc));
-      break;
-    }
-    case 0xda: { // movws dp
-      uint16_t low = 0;
-      uint16_t high = spc_adrDpWord(spc, &low);
-      spc_read(spc, low);
-      spc_write(spc, low, spc->a);
-      spc_write(spc, high, spc->y);
-      break;
-    }
-    case 0xdb: { // movsy dpx
-      spc_movsy(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0xdc: { // decy imp
-      spc->y--;
-      spc_setZN(spc, spc->y);
-      break;
-    }
-    case 0xdd: { // movay imp
-      spc->a = spc->y;
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0xde: { // cbne dpx, rel
-      uint8_t val = spc_read(spc, spc_adrDpx(spc)) ^ 0xff;
-      uint8_t result = spc->a + val + 1;
-      spc_doBranch(spc, spc_readOpcode(spc), result != 0);
-      break;
-    }
-    case 0xdf: { // daa imp
-      if(spc->a > 0x99 || spc->c) {
-        spc->a += 0x60;
+      case 0x65: SPC_OP(65) { // cmp abs
+        spc_cmp(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0x66: SPC_OP(66) { // cmp ind
+        spc_cmp(spc, spc_adrInd(spc));
+        SPC_NEXT;
+      }
+      case 0x67: SPC_OP(67) { // cmp idx
+        spc_cmp(spc, spc_adrIdx(spc));
+        SPC_NEXT;
+      }
+      case 0x68: SPC_OP(68) { // cmp imm
+        spc_cmp(spc, spc_adrImm(spc));
+        SPC_NEXT;
+      }
+      case 0x69: SPC_OP(69) { // cmpm dp, dp
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpDp(spc, &src);
+        spc_cmpm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x6a: SPC_OP(6a) { // and1n abs.bit
+        uint16_t adr = 0;
+        uint8_t bit = spc_adrAbsBit(spc, &adr);
+        spc->c = spc->c & (~(spc_read(spc, adr) >> bit) & 1);
+        SPC_NEXT;
+      }
+      case 0x6b: SPC_OP(6b) { // ror dp
+        spc_ror(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0x6c: SPC_OP(6c) { // ror abs
+        spc_ror(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0x6d: SPC_OP(6d) { // pushy imp
+        spc_pushByte(spc, spc->y);
+        SPC_NEXT;
+      }
+      case 0x6e: SPC_OP(6e) { // dbnz dp, rel
+        uint16_t adr = spc_adrDp(spc);
+        uint8_t result = spc_read(spc, adr) - 1;
+        spc_write(spc, adr, result);
+        spc_doBranch(spc, spc_readOpcode(spc), result != 0);
+        SPC_NEXT;
+      }
+      case 0x6f: SPC_OP(6f) { // ret imp
+        spc->pc = spc_pullWord(spc);
+        SPC_NEXT;
+      }
+      case 0x70: SPC_OP(70) { // bvs rel
+        spc_doBranch(spc, spc_readOpcode(spc), spc->v);
+        SPC_NEXT;
+      }
+      case 0x74: SPC_OP(74) { // cmp dpx
+        spc_cmp(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0x75: SPC_OP(75) { // cmp abx
+        spc_cmp(spc, spc_adrAbx(spc));
+        SPC_NEXT;
+      }
+      case 0x76: SPC_OP(76) { // cmp aby
+        spc_cmp(spc, spc_adrAby(spc));
+        SPC_NEXT;
+      }
+      case 0x77: SPC_OP(77) { // cmp idy
+        spc_cmp(spc, spc_adrIdy(spc));
+        SPC_NEXT;
+      }
+      case 0x78: SPC_OP(78) { // cmpm dp, imm
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpImm(spc, &src);
+        spc_cmpm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x79: SPC_OP(79) { // cmpm ind, ind
+        uint16_t src = 0;
+        uint16_t dst = spc_adrIndInd(spc, &src);
+        spc_cmpm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x7a: SPC_OP(7a) { // addw dp
+        uint16_t low = 0;
+        uint16_t high = spc_adrDpWord(spc, &low);
+        uint16_t value = spc_readWord(spc, low, high);
+        uint16_t ya = spc->a | (spc->y << 8);
+        int result = ya + value;
+        spc->v = (ya & 0x8000) == (value & 0x8000) && (value & 0x8000) != (result & 0x8000);
+        spc->h = ((ya & 0xfff) + (value & 0xfff) + 1) > 0xfff;
+        spc->c = result > 0xffff;
+        spc->z = (result & 0xffff) == 0;
+        spc->n = result & 0x8000;
+        spc->a = result & 0xff;
+        spc->y = result >> 8;
+        SPC_NEXT;
+      }
+      case 0x7b: SPC_OP(7b) { // ror dpx
+        spc_ror(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0x7c: SPC_OP(7c) { // rora imp
+        bool newC = spc->a & 1;
+        spc->a = (spc->a >> 1) | (spc->c << 7);
+        spc->c = newC;
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0x7d: SPC_OP(7d) { // movax imp
+        spc->a = spc->x;
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0x7e: SPC_OP(7e) { // cmpy dp
+        spc_cmpy(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0x7f: SPC_OP(7f) { // reti imp
+        spc_setFlags(spc, spc_pullByte(spc));
+        spc->pc = spc_pullWord(spc);
+        SPC_NEXT;
+      }
+      case 0x80: SPC_OP(80) { // setc imp
         spc->c = true;
+        SPC_NEXT;
       }
-      if((spc->a & 0xf) > 9 || spc->h) {
-        spc->a += 6;
+      case 0x84: SPC_OP(84) { // adc dp
+        spc_adc(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0x85: SPC_OP(85) { // adc abs
+        spc_adc(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0x86: SPC_OP(86) { // adc ind
+        spc_adc(spc, spc_adrInd(spc));
+        SPC_NEXT;
+      }
+      case 0x87: SPC_OP(87) { // adc idx
+        spc_adc(spc, spc_adrIdx(spc));
+        SPC_NEXT;
+      }
+      case 0x88: SPC_OP(88) { // adc imm
+        spc_adc(spc, spc_adrImm(spc));
+        SPC_NEXT;
+      }
+      case 0x89: SPC_OP(89) { // adcm dp, dp
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpDp(spc, &src);
+        spc_adcm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x8a: SPC_OP(8a) { // eor1 abs.bit
+        uint16_t adr = 0;
+        uint8_t bit = spc_adrAbsBit(spc, &adr);
+        spc->c = spc->c ^ ((spc_read(spc, adr) >> bit) & 1);
+        SPC_NEXT;
+      }
+      case 0x8b: SPC_OP(8b) { // dec dp
+        spc_dec(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0x8c: SPC_OP(8c) { // dec abs
+        spc_dec(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0x8d: SPC_OP(8d) { // movy imm
+        spc_movy(spc, spc_adrImm(spc));
+        SPC_NEXT;
+      }
+      case 0x8e: SPC_OP(8e) { // popp imp
+        spc_setFlags(spc, spc_pullByte(spc));
+        SPC_NEXT;
+      }
+      case 0x8f: SPC_OP(8f) { // movm dp, imm
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpImm(spc, &src);
+        uint8_t val = spc_read(spc, src);
+        spc_read(spc, dst);
+        spc_write(spc, dst, val);
+        SPC_NEXT;
+      }
+      case 0x90: SPC_OP(90) { // bcc rel
+        spc_doBranch(spc, spc_readOpcode(spc), !spc->c);
+        SPC_NEXT;
+      }
+      case 0x94: SPC_OP(94) { // adc dpx
+        spc_adc(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0x95: SPC_OP(95) { // adc abx
+        spc_adc(spc, spc_adrAbx(spc));
+        SPC_NEXT;
+      }
+      case 0x96: SPC_OP(96) { // adc aby
+        spc_adc(spc, spc_adrAby(spc));
+        SPC_NEXT;
+      }
+      case 0x97: SPC_OP(97) { // adc idy
+        spc_adc(spc, spc_adrIdy(spc));
+        SPC_NEXT;
+      }
+      case 0x98: SPC_OP(98) { // adcm dp, imm
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpImm(spc, &src);
+        spc_adcm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x99: SPC_OP(99) { // adcm ind, ind
+        uint16_t src = 0;
+        uint16_t dst = spc_adrIndInd(spc, &src);
+        spc_adcm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0x9a: SPC_OP(9a) { // subw dp
+        uint16_t low = 0;
+        uint16_t high = spc_adrDpWord(spc, &low);
+        uint16_t value = spc_readWord(spc, low, high) ^ 0xffff;
+        uint16_t ya = spc->a | (spc->y << 8);
+        int result = ya + value + 1;
+        spc->v = (ya & 0x8000) == (value & 0x8000) && (value & 0x8000) != (result & 0x8000);
+        spc->h = ((ya & 0xfff) + (value & 0xfff) + 1) > 0xfff;
+        spc->c = result > 0xffff;
+        spc->z = (result & 0xffff) == 0;
+        spc->n = result & 0x8000;
+        spc->a = result & 0xff;
+        spc->y = result >> 8;
+        SPC_NEXT;
+      }
+      case 0x9b: SPC_OP(9b) { // dec dpx
+        spc_dec(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0x9c: SPC_OP(9c) { // deca imp
+        spc->a--;
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0x9d: SPC_OP(9d) { // movxp imp
+        spc->x = spc->sp;
+        spc_setZN(spc, spc->x);
+        SPC_NEXT;
+      }
+      case 0x9e: SPC_OP(9e) { // div imp
+        // TODO: proper division algorithm
+        uint16_t value = spc->a | (spc->y << 8);
+        int result = 0xffff;
+        int mod = spc->a;
+        if(spc->x != 0) {
+          result = value / spc->x;
+          mod = value % spc->x;
+        }
+        spc->v = result > 0xff;
+        spc->h = (spc->x & 0xf) <= (spc->y & 0xf);
+        spc->a = result;
+        spc->y = mod;
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0x9f: SPC_OP(9f) { // xcn imp
+        spc->a = (spc->a >> 4) | (spc->a << 4);
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0xa0: SPC_OP(a0) { // ei  imp
+        spc->i = true;
+        SPC_NEXT;
+      }
+      case 0xa4: SPC_OP(a4) { // sbc dp
+        spc_sbc(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0xa5: SPC_OP(a5) { // sbc abs
+        spc_sbc(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0xa6: SPC_OP(a6) { // sbc ind
+        spc_sbc(spc, spc_adrInd(spc));
+        SPC_NEXT;
+      }
+      case 0xa7: SPC_OP(a7) { // sbc idx
+        spc_sbc(spc, spc_adrIdx(spc));
+        SPC_NEXT;
+      }
+      case 0xa8: SPC_OP(a8) { // sbc imm
+        spc_sbc(spc, spc_adrImm(spc));
+        SPC_NEXT;
+      }
+      case 0xa9: SPC_OP(a9) { // sbcm dp, dp
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpDp(spc, &src);
+        spc_sbcm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0xaa: SPC_OP(aa) { // mov1 abs.bit
+        uint16_t adr = 0;
+        uint8_t bit = spc_adrAbsBit(spc, &adr);
+        spc->c = (spc_read(spc, adr) >> bit) & 1;
+        SPC_NEXT;
+      }
+      case 0xab: SPC_OP(ab) { // inc dp
+        spc_inc(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0xac: SPC_OP(ac) { // inc abs
+        spc_inc(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0xad: SPC_OP(ad) { // cmpy imm
+        spc_cmpy(spc, spc_adrImm(spc));
+        SPC_NEXT;
+      }
+      case 0xae: SPC_OP(ae) { // popa imp
+        spc->a = spc_pullByte(spc);
+        SPC_NEXT;
+      }
+      case 0xaf: SPC_OP(af) { // movs ind+
+        uint16_t adr = spc_adrIndP(spc);
+        spc_write(spc, adr, spc->a);
+        SPC_NEXT;
+      }
+      case 0xb0: SPC_OP(b0) { // bcs rel
+        spc_doBranch(spc, spc_readOpcode(spc), spc->c);
+        SPC_NEXT;
+      }
+      case 0xb4: SPC_OP(b4) { // sbc dpx
+        spc_sbc(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0xb5: SPC_OP(b5) { // sbc abx
+        spc_sbc(spc, spc_adrAbx(spc));
+        SPC_NEXT;
+      }
+      case 0xb6: SPC_OP(b6) { // sbc aby
+        spc_sbc(spc, spc_adrAby(spc));
+        SPC_NEXT;
+      }
+      case 0xb7: SPC_OP(b7) { // sbc idy
+        spc_sbc(spc, spc_adrIdy(spc));
+        SPC_NEXT;
+      }
+      case 0xb8: SPC_OP(b8) { // sbcm dp, imm
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpImm(spc, &src);
+        spc_sbcm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0xb9: SPC_OP(b9) { // sbcm ind, ind
+        uint16_t src = 0;
+        uint16_t dst = spc_adrIndInd(spc, &src);
+        spc_sbcm(spc, dst, src);
+        SPC_NEXT;
+      }
+      case 0xba: SPC_OP(ba) { // movw dp
+        uint16_t low = 0;
+        uint16_t high = spc_adrDpWord(spc, &low);
+        uint16_t val = spc_readWord(spc, low, high);
+        spc->a = val & 0xff;
+        spc->y = val >> 8;
+        spc->z = val == 0;
+        spc->n = val & 0x8000;
+        SPC_NEXT;
+      }
+      case 0xbb: SPC_OP(bb) { // inc dpx
+        spc_inc(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0xbc: SPC_OP(bc) { // inca imp
+        spc->a++;
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0xbd: SPC_OP(bd) { // movpx imp
+        spc->sp = spc->x;
+        SPC_NEXT;
+      }
+      case 0xbe: SPC_OP(be) { // das imp
+        if(spc->a > 0x99 || !spc->c) {
+          spc->a -= 0x60;
+          spc->c = false;
+        }
+        if((spc->a & 0xf) > 9 || !spc->h) {
+          spc->a -= 6;
+        }
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0xbf: SPC_OP(bf) { // mov ind+
+        uint16_t adr = spc_adrIndP(spc);
+        spc->a = spc_read(spc, adr);
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0xc0: SPC_OP(c0) { // di  imp
+        spc->i = false;
+        SPC_NEXT;
+      }
+      case 0xc4: SPC_OP(c4) { // movs dp
+        spc_movs(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0xc5: SPC_OP(c5) { // movs abs
+        spc_movs(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0xc6: SPC_OP(c6) { // movs ind
+        spc_movs(spc, spc_adrInd(spc));
+        SPC_NEXT;
+      }
+      case 0xc7: SPC_OP(c7) { // movs idx
+        spc_movs(spc, spc_adrIdx(spc));
+        SPC_NEXT;
+      }
+      case 0xc8: SPC_OP(c8) { // cmpx imm
+        spc_cmpx(spc, spc_adrImm(spc));
+        SPC_NEXT;
+      }
+      case 0xc9: SPC_OP(c9) { // movsx abs
+        spc_movsx(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0xca: SPC_OP(ca) { // mov1s abs.bit
+        uint16_t adr = 0;
+        uint8_t bit = spc_adrAbsBit(spc, &adr);
+        uint8_t result = (spc_read(spc, adr) & (~(1 << bit))) | (spc->c << bit);
+        spc_write(spc, adr, result);
+        SPC_NEXT;
+      }
+      case 0xcb: SPC_OP(cb) { // movsy dp
+        spc_movsy(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0xcc: SPC_OP(cc) { // movsy abs
+        spc_movsy(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0xcd: SPC_OP(cd) { // movx imm
+        spc_movx(spc, spc_adrImm(spc));
+        SPC_NEXT;
+      }
+      case 0xce: SPC_OP(ce) { // popx imp
+        spc->x = spc_pullByte(spc);
+        SPC_NEXT;
+      }
+      case 0xcf: SPC_OP(cf) { // mul imp
+        uint16_t result = spc->a * spc->y;
+        spc->a = result & 0xff;
+        spc->y = result >> 8;
+        spc_setZN(spc, spc->y);
+        SPC_NEXT;
+      }
+      case 0xd0: SPC_OP(d0) { // bne rel
+        spc_doBranch(spc, spc_readOpcode(spc), !spc->z);
+        SPC_NEXT;
+      }
+      case 0xd4: SPC_OP(d4) { // movs dpx
+        spc_movs(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0xd5: SPC_OP(d5) { // movs abx
+        spc_movs(spc, spc_adrAbx(spc));
+        SPC_NEXT;
+      }
+      case 0xd6: SPC_OP(d6) { // movs aby
+        spc_movs(spc, spc_adrAby(spc));
+        SPC_NEXT;
+      }
+      case 0xd7: SPC_OP(d7) { // movs idy
+        spc_movs(spc, spc_adrIdy(spc));
+        SPC_NEXT;
+      }
+      case 0xd8: SPC_OP(d8) { // movsx dp
+        spc_movsx(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0xd9: SPC_OP(d9) { // movsx dpy
+        spc_movsx(spc, spc_adrDpy(spc));
+        SPC_NEXT;
+      }
+      case 0xda: SPC_OP(da) { // movws dp
+        uint16_t low = 0;
+        uint16_t high = spc_adrDpWord(spc, &low);
+        spc_read(spc, low);
+        spc_write(spc, low, spc->a);
+        spc_write(spc, high, spc->y);
+        SPC_NEXT;
+      }
+      case 0xdb: SPC_OP(db) { // movsy dpx
+        spc_movsy(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0xdc: SPC_OP(dc) { // decy imp
+        spc->y--;
+        spc_setZN(spc, spc->y);
+        SPC_NEXT;
+      }
+      case 0xdd: SPC_OP(dd) { // movay imp
+        spc->a = spc->y;
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0xde: SPC_OP(de) { // cbne dpx, rel
+        uint8_t val = spc_read(spc, spc_adrDpx(spc)) ^ 0xff;
+        uint8_t result = spc->a + val + 1;
+        spc_doBranch(spc, spc_readOpcode(spc), result != 0);
+        SPC_NEXT;
+      }
+      case 0xdf: SPC_OP(df) { // daa imp
+        if(spc->a > 0x99 || spc->c) {
+          spc->a += 0x60;
+          spc->c = true;
+        }
+        if((spc->a & 0xf) > 9 || spc->h) {
+          spc->a += 6;
+        }
+        spc_setZN(spc, spc->a);
+        SPC_NEXT;
+      }
+      case 0xe0: SPC_OP(e0) { // clrv imp
+        spc->v = false;
+        spc->h = false;
+        SPC_NEXT;
+      }
+      case 0xe4: SPC_OP(e4) { // mov dp
+        spc_mov(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0xe5: SPC_OP(e5) { // mov abs
+        spc_mov(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0xe6: SPC_OP(e6) { // mov ind
+        spc_mov(spc, spc_adrInd(spc));
+        SPC_NEXT;
+      }
+      case 0xe7: SPC_OP(e7) { // mov idx
+        spc_mov(spc, spc_adrIdx(spc));
+        SPC_NEXT;
+      }
+      case 0xe8: SPC_OP(e8) { // mov imm
+        spc_mov(spc, spc_adrImm(spc));
+        SPC_NEXT;
+      }
+      case 0xe9: SPC_OP(e9) { // movx abs
+        spc_movx(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0xea: SPC_OP(ea) { // not1 abs.bit
+        uint16_t adr = 0;
+        uint8_t bit = spc_adrAbsBit(spc, &adr);
+        uint8_t result = spc_read(spc, adr) ^ (1 << bit);
+        spc_write(spc, adr, result);
+        SPC_NEXT;
+      }
+      case 0xeb: SPC_OP(eb) { // movy dp
+        spc_movy(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0xec: SPC_OP(ec) { // movy abs
+        spc_movy(spc, spc_adrAbs(spc));
+        SPC_NEXT;
+      }
+      case 0xed: SPC_OP(ed) { // notc imp
+        spc->c = !spc->c;
+        SPC_NEXT;
+      }
+      case 0xee: SPC_OP(ee) { // popy imp
+        spc->y = spc_pullByte(spc);
+        SPC_NEXT;
+      }
+      case 0xef: SPC_OP(ef) { // sleep imp
+        spc->stopped = true; // no interrupts, so sleeping stops as well
+        SPC_NEXT;
+      }
+      case 0xf0: SPC_OP(f0) { // beq rel
+        spc_doBranch(spc, spc_readOpcode(spc), spc->z);
+        SPC_NEXT;
+      }
+      case 0xf4: SPC_OP(f4) { // mov dpx
+        spc_mov(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0xf5: SPC_OP(f5) { // mov abx
+        spc_mov(spc, spc_adrAbx(spc));
+        SPC_NEXT;
+      }
+      case 0xf6: SPC_OP(f6) { // mov aby
+        spc_mov(spc, spc_adrAby(spc));
+        SPC_NEXT;
+      }
+      case 0xf7: SPC_OP(f7) { // mov idy
+        spc_mov(spc, spc_adrIdy(spc));
+        SPC_NEXT;
+      }
+      case 0xf8: SPC_OP(f8) { // movx dp
+        spc_movx(spc, spc_adrDp(spc));
+        SPC_NEXT;
+      }
+      case 0xf9: SPC_OP(f9) { // movx dpy
+        spc_movx(spc, spc_adrDpy(spc));
+        SPC_NEXT;
+      }
+      case 0xfa: SPC_OP(fa) { // movm dp, dp
+        uint16_t src = 0;
+        uint16_t dst = spc_adrDpDp(spc, &src);
+        uint8_t val = spc_read(spc, src);
+        spc_write(spc, dst, val);
+        SPC_NEXT;
+      }
+      case 0xfb: SPC_OP(fb) { // movy dpx
+        spc_movy(spc, spc_adrDpx(spc));
+        SPC_NEXT;
+      }
+      case 0xfc: SPC_OP(fc) { // incy imp
+        spc->y++;
+        spc_setZN(spc, spc->y);
+        SPC_NEXT;
+      }
+      case 0xfd: SPC_OP(fd) { // movya imp
+        spc->y = spc->a;
+        spc_setZN(spc, spc->y);
+        SPC_NEXT;
+      }
+      case 0xfe: SPC_OP(fe) { // dbnzy rel
+        spc->y--;
+        spc_doBranch(spc, spc_readOpcode(spc), spc->y != 0);
+        SPC_NEXT;
+      }
+      case 0xff: SPC_OP(ff) { // stop imp
+        spc->stopped = true;
+        SPC_NEXT;
       }
-      spc_setZN(spc, spc->a);
-      break;
-    }
-    case 0xe0: { // clrv imp
-      spc->v = false;
-      spc->h = false;
-      break;
-    }
-    case 0xe4: { // mov dp
-      spc_mov(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0xe5: { // mov abs
-      spc_mov(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0xe6: { // mov ind
-      spc_mov(spc, spc_adrInd(spc));
-      break;
-    }
-    case 0xe7: { // mov idx
-      spc_mov(spc, spc_adrIdx(spc));
-      break;
-    }
-    case 0xe8: { // mov imm
-      spc_mov(spc, spc_adrImm(spc));
-      break;
-    }
-    case 0xe9: { // movx abs
-      spc_movx(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0xea: { // not1 abs.bit
-      uint16_t adr = 0;
-      uint8_t bit = spc_adrAbsBit(spc, &adr);
-      uint8_t result = spc_read(spc, adr) ^ (1 << bit);
-      spc_write(spc, adr, result);
-      break;
-    }
-    case 0xeb: { // movy dp
-      spc_movy(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0xec: { // movy abs
-      spc_movy(spc, spc_adrAbs(spc));
-      break;
-    }
-    case 0xed: { // notc imp
-      spc->c = !spc->c;
-      break;
-    }
-    case 0xee: { // popy imp
-      spc->y = spc_pullByte(spc);
-      break;
-    }
-    case 0xef: { // sleep imp
-      spc->stopped = true; // no interrupts, so sleeping stops as well
-      break;
-    }
-    case 0xf0: { // beq rel
-      spc_doBranch(spc, spc_readOpcode(spc), spc->z);
-      break;
-    }
-    case 0xf4: { // mov dpx
-      spc_mov(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0xf5: { // mov abx
-      spc_mov(spc, spc_adrAbx(spc));
-      break;
-    }
-    case 0xf6: { // mov aby
-      spc_mov(spc, spc_adrAby(spc));
-      break;
-    }
-    case 0xf7: { // mov idy
-      spc_mov(spc, spc_adrIdy(spc));
-      break;
-    }
-    case 0xf8: { // movx dp
-      spc_movx(spc, spc_adrDp(spc));
-      break;
-    }
-    case 0xf9: { // movx dpy
-      spc_movx(spc, spc_adrDpy(spc));
-      break;
-    }
-    case 0xfa: { // movm dp, dp
-      uint16_t src = 0;
-      uint16_t dst = spc_adrDpDp(spc, &src);
-      uint8_t val = spc_read(spc, src);
-      spc_write(spc, dst, val);
-      break;
-    }
-    case 0xfb: { // movy dpx
-      spc_movy(spc, spc_adrDpx(spc));
-      break;
-    }
-    case 0xfc: { // incy imp
-      spc->y++;
-      spc_setZN(spc, spc->y);
-      break;
-    }
-    case 0xfd: { // movya imp
-      spc->y = spc->a;
-      spc_setZN(spc, spc->y);
-      break;
-    }
-    case 0xfe: { // dbnzy rel
-      spc->y--;
-      spc_doBranch(spc, spc_readOpcode(spc), spc->y != 0);
-      break;
-    }
-    case 0xff: { // stop imp
-      spc->stopped = true;
-      break;
     }
+    // the switch only falls out here without threading
+    SPC_TICK();
+    SPC_FETCH();
   }
+#undef SPC_TICK
+#undef SPC_FETCH
+#undef SPC_OP
+#undef SPC_NEXT
 }
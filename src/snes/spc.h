@@ -39,6 +39,7 @@ Spc* spc_init(Apu* apu);
 void spc_free(Spc* spc);
 void spc_reset(Spc* spc);
 int spc_runOpcode(Spc* spc);
+int spc_runCycles(Spc* spc, int cycles);
 void spc_saveload(Spc *spc, SaveLoadFunc *func, void *ctx);
 
 #endif
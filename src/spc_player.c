@@ -1566,8 +1566,8 @@ void SpcPlayer_GenerateSamples(SpcPlayer *p) {
 
     p->timer_cycles += n;
 
-    for (int i = 0; i < n; i++)
-      dsp_cycle(p->dsp);
+    // no dsp writes until the next 64 cycle tick
+    dsp_renderBlock(p->dsp, n);
 
     if (p->dsp->sampleOffset == 534)
       break;